@@ -1,17 +1,39 @@
+#ifdef VULKANDEMO_GLFW
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#endif
 
 #include "Application.h"
 #include <iostream>
 #include <stdexcept>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <algorithm>
 #include "SwapChain.h"
+#include "OffscreenTarget.h"
+#include "GpuProfiler.h"
+#include "Tracer.h"
+#include "vulkan/Device.h"
 #include "GraphicsPipeLine.h"
 #include "CommandPool.h"
 #include "CommandBuffer.h"
-#include "commands/Command.h"
-#include "commands/SetViewport.h"
-#include "commands/SetScissor.h"
-#include "commands/Draw.h"
+#include "CommandBufferCache.h"
+#include "ParallelCommandRecorder.h"
+#include "PipelineCache.h"
+#include "AsyncPipelineCompiler.h"
+#include "PipelineRegistry.h"
+#include "StagingUploader.h"
+#include "Mesh.h"
+#include "FrameRingBuffer.h"
+#include "DescriptorAllocator.h"
+#include "IndirectDrawBuilder.h"
+#include "SceneBvh.h"
+#include "RenderGraph.h"
+#include "HashCombine.h"
+#include <cmath>
+#include <cstring>
+#include "commands/CommandStream.h"
 
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
@@ -23,6 +45,24 @@ const std::vector<const char*> validationLayers = {
 	"VK_LAYER_KHRONOS_validation"
 };
 
+// matches FrameUniforms in shader.vert, streamed once per frame
+struct FrameUniforms
+{
+	float rotation[4];
+};
+
+// matches DrawConstants in shader.vert, pushed per draw
+struct DrawConstants
+{
+	float offsetScale[4];
+};
+
+// the view transform every draw uses, scaling the scene around the viewport center
+static DrawConstants getDrawConstants(float viewScale)
+{
+	return DrawConstants{ { 0.0f, 0.0f, viewScale, 0.0f } };
+}
+
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pMessenger)
 {
 	auto func = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
@@ -45,11 +85,38 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance,VkDebugUtilsMessengerEXT
 	}
 }
 
+HelloTriangleApplication::HelloTriangleApplication()
+	:HelloTriangleApplication(Settings())
+{
+}
+
+HelloTriangleApplication::HelloTriangleApplication(const Settings& settings)
+	:m_settings(settings)
+{
+	if (m_settings.framesInFlight < 1)
+	{
+		m_settings.framesInFlight = 1;
+	}
+	// there is no window to close, so a headless run needs a frame budget
+	if (m_settings.headless && m_settings.maxFrames == 0)
+	{
+		m_settings.maxFrames = 100;
+	}
+	Tracer::setEnabled(!m_settings.tracePath.empty());
+}
+
 VkFormat HelloTriangleApplication::getSwapChainImageFormat()
 {
+	if (m_pOffscreenTarget)
+		return m_pOffscreenTarget->getFormat();
 	return m_pSwapChain->getSwapChainImageFormat();
 }
 
+VkPipelineCache HelloTriangleApplication::getPipelineCache()
+{
+	return m_pPipelineCache ? (VkPipelineCache)*m_pPipelineCache : VK_NULL_HANDLE;
+}
+
 VkRenderPass HelloTriangleApplication::getRenderPass()
 {
 	return m_pGraphicsPipeline->getRenderPass();
@@ -57,6 +124,9 @@ VkRenderPass HelloTriangleApplication::getRenderPass()
 
 void HelloTriangleApplication::initVulkan()
 {
+	TRACE_THREAD_NAME("main");
+	TRACE_ZONE("InitVulkan");
+	auto initStart = std::chrono::steady_clock::now();
 	createInstance();
 	setupDebugCallback();
 	createSurface();
@@ -64,32 +134,223 @@ void HelloTriangleApplication::initVulkan()
 	queryQueueFamilyIndices();
 	createDevice();
 	getQueues();
+	createFrameScheduler();
+	createPipelineCache();
+	createPipelineRegistry();
 
 	createSwapChain();
 	createGraphicsPipeline();
 	createFrameBuffers();
 	createCommandPool();
+	createFrameRingBuffer();
+	createDescriptorAllocator();
+	createInstanceBatcher();
+	createMesh();
+	createSceneBvh();
+	createRenderGraph();
+	createGpuProfiler();
 	createSyncObjects();
+
+	std::cout << "vulkan initialized in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - initStart).count() << " ms\n";
 }
 
 void HelloTriangleApplication::mainLoop() {
-	while (!glfwWindowShouldClose(m_pWindow))
+	while (true)
 	{
-		glfwPollEvents();
-		drawFrame();
+#ifdef VULKANDEMO_GLFW
+		if (m_pWindow)
+		{
+			if (glfwWindowShouldClose(m_pWindow))
+				break;
+
+			TRACE_ZONE("PollEvents");
+			glfwPollEvents();
+		}
+#endif
+
+		auto frameStart = std::chrono::steady_clock::now();
+		{
+			TRACE_ZONE("DrawFrame");
+			drawFrame();
+		}
+		m_frameTimings.totalFrameMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+		++m_frameTimings.frameCount;
+
+		if (m_settings.maxFrames != 0 && m_frameTimings.frameCount >= m_settings.maxFrames)
+		{
+			break;
+		}
 	}
 	vkDeviceWaitIdle(m_vkDevice);
+	// the last submission of every frame slot has not been written out yet
+	if (m_pOffscreenTarget)
+	{
+		for (uint32_t i = 0; i < m_frames.size(); ++i)
+		{
+			saveOffscreenFrame(i, m_frames[i].submitIndex);
+		}
+	}
+	reportFrameTimings();
+
+	if (!m_settings.tracePath.empty())
+	{
+#ifndef VULKANDEMO_TRACING
+		std::cout << "tracing was compiled out, configure with ENABLE_TRACING to record zones\n";
+#endif
+		Tracer::writeChromeTrace(m_settings.tracePath);
+	}
+}
+
+void HelloTriangleApplication::reportFrameTimings()
+{
+	if (m_frameTimings.frameCount == 0)
+		return;
+
+	// with enough frames in flight the fence wait should shrink towards zero,
+	// meaning the CPU records the next frame while the GPU is still busy
+	double frameCount = (double)m_frameTimings.frameCount;
+	std::cout << "frames in flight: " << m_frames.size() << ", frames: " << m_frameTimings.frameCount << '\n'
+		<< "\tavg frame:      " << m_frameTimings.totalFrameMs / frameCount << " ms\n"
+		<< "\tavg fence wait: " << m_frameTimings.fenceWaitMs / frameCount << " ms\n"
+		<< "\tavg record:     " << m_frameTimings.recordMs / frameCount << " ms\n";
+	if (m_settings.cacheCommandBuffers)
+	{
+		std::cout << "\tcommand cache:  " << m_pCommandCache->getHits() << " hits, " << m_pCommandCache->getMisses() << " misses\n";
+	}
+	auto& pipelineStats = m_pPipelineRegistry->getStats();
+	std::cout << "\tpipelines:      " << m_pPipelineRegistry->getPipelineCount() << " unique, " << pipelineStats.hits << " hits, "
+		<< pipelineStats.misses << " misses, " << pipelineStats.creationMs << " ms creating\n";
+
+	auto memoryStats = m_pDevice->getAllocator().getStats();
+	std::cout << "\tdevice memory:  " << memoryStats.allocationCnt << " allocations in " << memoryStats.blockCnt << " blocks ("
+		<< memoryStats.blockBytes / (1024 * 1024) << " MiB) + " << memoryStats.dedicatedCnt << " dedicated ("
+		<< memoryStats.dedicatedBytes / (1024 * 1024) << " MiB), utilization " << memoryStats.getUtilization() * 100.0
+		<< "%, fragmentation " << memoryStats.getFragmentation() * 100.0 << "%\n";
+
+	auto& uploadStats = m_pUploader->getStats();
+	std::cout << "\tuploads:        " << uploadStats.bytes / (1024 * 1024) << " MiB in " << uploadStats.copies << " copies, "
+		<< uploadStats.submits << " submits, " << uploadStats.copyMs << " ms writing, " << uploadStats.stallMs << " ms waiting\n";
+
+	auto ringStats = m_pFrameRing->getStats();
+	std::cout << "\tframe ring:     " << ringStats.allocationCnt << " allocations, peak " << ringStats.peakFrameBytes / 1024 << " of "
+		<< m_pFrameRing->getFrameSize() / 1024 << " KiB per frame, " << ringStats.failedCnt << " overflows\n";
+
+	// allocation rate and reset cost only mean something with --descriptor-stress
+	auto& descriptorStats = m_pDescriptorAllocator->getStats();
+	std::cout << "\tdescriptors:    " << descriptorStats.transientSets << " transient sets";
+	if (descriptorStats.transientMs > 0.0)
+	{
+		std::cout << " (" << descriptorStats.transientSets / descriptorStats.transientMs / 1000.0 << " M sets/s)";
+	}
+	std::cout << ", " << descriptorStats.persistentHits << " persistent hits, " << descriptorStats.persistentMisses << " misses, "
+		<< descriptorStats.poolCnt << " pools, avg reset " << (descriptorStats.resetCnt ? descriptorStats.resetMs / descriptorStats.resetCnt : 0.0) << " ms\n";
+
+	if (m_pIndirectDraws)
+	{
+		std::cout << "\tindirect:       " << m_pIndirectDraws->getObjectCount() << " objects in up to " << m_pIndirectDraws->getDrawCount()
+			<< " indirect draws per frame, " << (m_pIndirectDraws->usesMultiDraw() ? "one compacted multi-draw" : "one call per draw") << "\n";
+		auto& cullStats = m_pIndirectDraws->getStats();
+		if (cullStats.frameCnt > 0)
+		{
+			std::cout << "\tgpu culling:    " << cullStats.drawnCnt / cullStats.frameCnt << " drawn, " << cullStats.culledCnt / cullStats.frameCnt
+				<< " culled objects per frame over " << cullStats.frameCnt << " frames\n";
+		}
+	}
+
+	std::cout << "\trendering:      " << (m_dynamicRendering ? "dynamic rendering" : "render pass") << ", "
+		<< m_vkFrameBuffers.size() << " framebuffers\n";
+
+	auto& schedulerStats = m_pScheduler->getStats();
+	std::cout << "\tscheduler:      " << (m_pScheduler->usesTimelineSemaphores() ? "timeline semaphores" : "fences")
+		<< (m_pScheduler->usesSynchronization2() ? " + synchronization2" : "") << ", " << m_pScheduler->getSyncObjectCount()
+		<< " sync objects, " << schedulerStats.submitCnt << " submits, " << schedulerStats.blockingWaitCnt << " blocking waits ("
+		<< schedulerStats.waitMs << " ms)\n";
+
+	auto& deletionStats = m_pDeletionQueue->getStats();
+	std::cout << "\tdeletion queue: " << deletionStats.retiredCnt << " retired, " << deletionStats.destroyedCnt << " destroyed, peak "
+		<< deletionStats.peakPendingCnt << " pending\n";
+
+	auto& graphStats = m_pRenderGraph->getStats();
+	std::cout << "\trender graph:   " << graphStats.passCnt << " passes, " << graphStats.culledPassCnt << " culled, " << graphStats.barrierCnt
+		<< " barriers in " << graphStats.barrierCallCnt << " calls per frame, " << graphStats.transientCnt << " transients in "
+		<< graphStats.heapCnt << " heaps, " << graphStats.transientBytes / 1024 << " KiB, " << graphStats.aliasedBytes / 1024 << " KiB saved by aliasing\n";
+
+	if (m_pSceneBvh)
+	{
+		// the cull throughput counts every box of the scene, including those rejected with their subtree
+		auto& cullStats = m_pSceneBvh->getStats();
+		std::cout << "\tcpu culling:    " << cullStats.visibleCnt / std::max<uint64_t>(cullStats.cullCnt, 1) << " of " << m_instances.size()
+			<< " visible per frame, " << m_pSceneBvh->getNodeCount() << " nodes, " << cullStats.testedCnt / std::max<uint64_t>(cullStats.cullCnt, 1)
+			<< " boxes tested, avg " << cullStats.cullMs / std::max<uint64_t>(cullStats.cullCnt, 1) << " ms, "
+			<< (cullStats.cullMs > 0.0 ? cullStats.boxCnt / cullStats.cullMs / 1000.0 : 0.0) << " M boxes/s on "
+			<< m_pSceneBvh->getThreadCount() + 1 << " threads (" << SceneBvh::getSimdName() << ")\n";
+	}
+
+	// per second of wall time over the whole run, so these are the throughput --instances achieves end to end
+	auto& instanceStats = m_pInstanceBatcher->getStats();
+	double seconds = m_frameTimings.totalFrameMs / 1000.0;
+	std::cout << "\tinstancing:     " << instanceStats.instanceCnt / frameCount << " instances in " << instanceStats.drawCnt / frameCount
+		<< " draws per frame, " << instanceStats.instanceCnt / seconds / 1e6 << " M instances/s, " << instanceStats.drawCnt / seconds
+		<< " draws/s, " << instanceStats.droppedCnt << " dropped\n";
+
+	if (m_pGpuProfiler)
+	{
+		m_pGpuProfiler->report(std::cout);
+		if (m_pGpuProfiler->isSupported() && !m_settings.gpuProfilePath.empty())
+		{
+			m_pGpuProfiler->writeJson(m_settings.gpuProfilePath);
+		}
+	}
 }
 
 void HelloTriangleApplication::cleanup() {
-	
-	vkDestroySemaphore(m_vkDevice, m_imageAvailableSemaphore, nullptr);
-	vkDestroySemaphore(m_vkDevice, m_renderingFinishedSemaphore, nullptr);
-	vkDestroyFence(m_vkDevice, m_inFlightFence, nullptr);
+
+	for (auto& frame : m_frames)
+	{
+		vkDestroySemaphore(m_vkDevice, frame.imageAvailableSemaphore, nullptr);
+		vkDestroySemaphore(m_vkDevice, frame.renderingFinishedSemaphore, nullptr);
+		frame.cmdBuffer.reset();
+	}
+	m_frames.clear();
+	m_imagesInFlight.clear();
+	m_commandStream.reset();
+
+	delete m_pCommandCache;
+	m_pCommandCache = nullptr;
+
+	delete m_pParallelRecorder;
+	m_pParallelRecorder = nullptr;
 
 	delete m_pCommandPool;
 	m_pCommandPool = nullptr;
 
+	delete m_pGpuProfiler;
+	m_pGpuProfiler = nullptr;
+
+	delete m_pIndirectDraws;
+	m_pIndirectDraws = nullptr;
+
+	delete m_pSceneBvh;
+	m_pSceneBvh = nullptr;
+
+	delete m_pRenderGraph;
+	m_pRenderGraph = nullptr;
+
+	delete m_pMesh;
+	m_pMesh = nullptr;
+
+	delete m_pUploader;
+	m_pUploader = nullptr;
+
+	delete m_pFrameRing;
+	m_pFrameRing = nullptr;
+
+	delete m_pDescriptorAllocator;
+	m_pDescriptorAllocator = nullptr;
+
+	delete m_pInstanceBatcher;
+	m_pInstanceBatcher = nullptr;
+
 	for (auto& framebuffer : m_vkFrameBuffers)
 	{
 		vkDestroyFramebuffer(m_vkDevice, framebuffer, nullptr);
@@ -98,34 +359,92 @@ void HelloTriangleApplication::cleanup() {
 	delete m_pSwapChain;
 	m_pSwapChain = nullptr;
 
-	delete m_pGraphicsPipeline;
+	delete m_pOffscreenTarget;
+	m_pOffscreenTarget = nullptr;
+
+	// owned by the registry, which waits for compiles still in flight
 	m_pGraphicsPipeline = nullptr;
+	delete m_pPipelineRegistry;
+	m_pPipelineRegistry = nullptr;
+
+	delete m_pPipelineCompiler;
+	m_pPipelineCompiler = nullptr;
+
+	delete m_pPipelineCache;
+	m_pPipelineCache = nullptr;
+
+	// destroys what the objects above retired to it, then the scheduler's own sync objects
+	delete m_pDeletionQueue;
+	m_pDeletionQueue = nullptr;
+
+	delete m_pScheduler;
+	m_pScheduler = nullptr;
+
+	// frees the allocator's blocks, every resource must have been destroyed by now
+	delete m_pDevice;
+	m_pDevice = nullptr;
 
 	vkDestroyDevice(m_vkDevice, nullptr);
-	vkDestroySurfaceKHR(m_vkInstance, m_surface, nullptr);
+	// a headless run never creates one
+	if (m_surface != VK_NULL_HANDLE)
+	{
+		vkDestroySurfaceKHR(m_vkInstance, m_surface, nullptr);
+	}
 	if (enableValidationLayers)
 	{
 		DestroyDebugUtilsMessengerEXT(m_vkInstance,m_debugMessager,nullptr);
 	}
 	vkDestroyInstance(m_vkInstance, nullptr);
 
-	glfwDestroyWindow(m_pWindow);
-	glfwTerminate();
+#ifdef VULKANDEMO_GLFW
+	if (m_pWindow)
+	{
+		glfwDestroyWindow(m_pWindow);
+		glfwTerminate();
+	}
+#endif
+}
+
+static bool isInstanceExtensionSupported(const char* pExtensionName)
+{
+	uint32_t extensionCnt = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCnt, nullptr);
+	std::vector<VkExtensionProperties> extensions(extensionCnt);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCnt, extensions.data());
+	for (auto& extension : extensions)
+	{
+		if (std::strcmp(extension.extensionName, pExtensionName) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
 }
 
 std::vector<const char*> HelloTriangleApplication::getRequiredExtensions()
 {
 	std::vector<const char*> requiredExtensions;
-	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions;
+#ifdef VULKANDEMO_GLFW
+	if (!m_settings.headless)
+	{
+		uint32_t glfwExtensionCount = 0;
+		const char** glfwExtensions;
 
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-	requiredExtensions.insert(requiredExtensions.end(), glfwExtensions, glfwExtensions + glfwExtensionCount);
+		requiredExtensions.insert(requiredExtensions.end(), glfwExtensions, glfwExtensions + glfwExtensionCount);
+	}
+#endif
 	if (enableValidationLayers)
 	{
 		requiredExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 	}
+	// a device extension of the 1.0 instance dynamic rendering and timeline semaphores depend on
+	if ((m_settings.dynamicRendering || m_settings.timelineSemaphores) &&
+		isInstanceExtensionSupported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
+	{
+		requiredExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	}
 
 	return requiredExtensions;
 }
@@ -152,24 +471,47 @@ void HelloTriangleApplication::setupDebugCallback()
 
 void HelloTriangleApplication::initWindow()
 {
+	m_viewport.width = m_settings.width;
+	m_viewport.height = m_settings.height;
+	if (m_settings.headless)
+		return;
+
+#ifdef VULKANDEMO_GLFW
 	glfwInit();
 
 	// OpenGL
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	// ʱڸıС
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	// resizing recreates the swapchain, see recreateSwapChain()
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
-	m_viewport.width = 1600;
-	m_viewport.height = 1200;
 	m_pWindow = glfwCreateWindow(m_viewport.width, m_viewport.height, "Vulkan Demo", nullptr, nullptr);
+	glfwSetWindowUserPointer(m_pWindow, this);
+	glfwSetFramebufferSizeCallback(m_pWindow, framebufferResizeCallback);
+#else
+	throw std::runtime_error("built without GLFW, only --headless is supported!");
+#endif
+}
+
+#ifdef VULKANDEMO_GLFW
+void HelloTriangleApplication::framebufferResizeCallback(GLFWwindow* pWindow, int width, int height)
+{
+	// not every platform reports VK_ERROR_OUT_OF_DATE_KHR after a resize
+	auto pApp = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(pWindow));
+	pApp->m_framebufferResized = true;
 }
+#endif
 
 void HelloTriangleApplication::createSurface()
 {
+	if (m_settings.headless)
+		return;
+
+#ifdef VULKANDEMO_GLFW
 	if (glfwCreateWindowSurface(m_vkInstance, m_pWindow, nullptr, &m_surface) !=VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create surface!");
 	}
+#endif
 }
 
 void HelloTriangleApplication::createInstance()
@@ -196,7 +538,7 @@ void HelloTriangleApplication::createInstance()
 
 	auto requiredExtensions = getRequiredExtensions();
 	createInfo.enabledExtensionCount = requiredExtensions.size();
-	createInfo.ppEnabledExtensionNames = &requiredExtensions[0];
+	createInfo.ppEnabledExtensionNames = requiredExtensions.data();
 
 	if (enableValidationLayers)
 	{
@@ -298,43 +640,89 @@ void HelloTriangleApplication::queryQueueFamilyIndices()
 		}
 
 		VkBool32 supportKHR = VK_FALSE;
-		if (vkGetPhysicalDeviceSurfaceSupportKHR(m_vkPhysicalDevice, i, m_surface, &supportKHR) == VK_SUCCESS && supportKHR)
+		if (!m_settings.headless && vkGetPhysicalDeviceSurfaceSupportKHR(m_vkPhysicalDevice, i, m_surface, &supportKHR) == VK_SUCCESS && supportKHR)
 		{
 			m_queueFamilyIndices.presentQueueIndex = i;
 		}
 	}
+
+	// nothing is presented, aliasing the graphics family keeps the single queue path
+	if (m_settings.headless)
+	{
+		m_queueFamilyIndices.presentQueueIndex = m_queueFamilyIndices.graphicsQueueIndex;
+	}
+
+	for (std::size_t i = 0; i < queueFamilyCount; ++i)
+	{
+		auto queueFlags = queueFamilyProperties[i].queueFlags;
+		if (queueFlags & VK_QUEUE_GRAPHICS_BIT)
+			continue;
+
+		if (queueFlags & VK_QUEUE_COMPUTE_BIT)
+		{
+			if (!m_queueFamilyIndices.computeQueueIndex.has_value())
+				m_queueFamilyIndices.computeQueueIndex = i;
+		}
+		else if ((queueFlags & VK_QUEUE_TRANSFER_BIT) && !m_queueFamilyIndices.transferQueueIndex.has_value())
+		{
+			m_queueFamilyIndices.transferQueueIndex = i;
+		}
+	}
+
+	// a transfer only family is usually backed by the copy engines, failing that an
+	// async compute family still keeps the copies off the graphics queue
+	if (!m_queueFamilyIndices.transferQueueIndex.has_value())
+	{
+		m_queueFamilyIndices.transferQueueIndex = m_queueFamilyIndices.computeQueueIndex.has_value() ?
+			m_queueFamilyIndices.computeQueueIndex : m_queueFamilyIndices.graphicsQueueIndex;
+	}
+	if (!m_queueFamilyIndices.computeQueueIndex.has_value())
+	{
+		m_queueFamilyIndices.computeQueueIndex = m_queueFamilyIndices.graphicsQueueIndex;
+	}
+}
+
+static bool isDeviceExtensionSupported(VkPhysicalDevice physicalDevice, const char* pExtensionName)
+{
+	uint32_t extensionCnt = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCnt, nullptr);
+	std::vector<VkExtensionProperties> extensions(extensionCnt);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCnt, extensions.data());
+	for (auto& extension : extensions)
+	{
+		if (std::strcmp(extension.extensionName, pExtensionName) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
 }
 
 void HelloTriangleApplication::createDevice()
 {
 	float priorities = 1.0f;
-	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	if (m_queueFamilyIndices.graphicsQueueIndex.value() == m_queueFamilyIndices.presentQueueIndex.value())
-	{
-		VkDeviceQueueCreateInfo queueCreateInfo;
-		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		queueCreateInfo.pNext = nullptr;
-		queueCreateInfo.queueCount = 1;
-		queueCreateInfo.queueFamilyIndex = m_queueFamilyIndices.graphicsQueueIndex.value();
-		queueCreateInfo.pQueuePriorities = &priorities;
-		queueCreateInfo.flags = 0;
+	// one queue per distinct family, families shared by several roles share the queue
+	std::vector<uint32_t> queueFamilies{
+		m_queueFamilyIndices.graphicsQueueIndex.value(),
+		m_queueFamilyIndices.presentQueueIndex.value(),
+		m_queueFamilyIndices.transferQueueIndex.value(),
+		m_queueFamilyIndices.computeQueueIndex.value()
+	};
+	std::sort(queueFamilies.begin(), queueFamilies.end());
+	queueFamilies.erase(std::unique(queueFamilies.begin(), queueFamilies.end()), queueFamilies.end());
 
-		queueCreateInfos.push_back(std::move(queueCreateInfo));
-	}
-	else
+	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+	for (auto queueFamily : queueFamilies)
 	{
 		VkDeviceQueueCreateInfo queueCreateInfo;
 		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 		queueCreateInfo.pNext = nullptr;
 		queueCreateInfo.queueCount = 1;
-		queueCreateInfo.queueFamilyIndex = m_queueFamilyIndices.graphicsQueueIndex.value();
+		queueCreateInfo.queueFamilyIndex = queueFamily;
 		queueCreateInfo.pQueuePriorities = &priorities;
 		queueCreateInfo.flags = 0;
 
 		queueCreateInfos.push_back(queueCreateInfo);
-
-		queueCreateInfo.queueFamilyIndex = m_queueFamilyIndices.presentQueueIndex.value();
-		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
 
@@ -344,40 +732,228 @@ void HelloTriangleApplication::createDevice()
 	deviceCreateInfo.pQueueCreateInfos = &queueCreateInfos[0];
 	deviceCreateInfo.queueCreateInfoCount = queueCreateInfos.size();
 
-	deviceCreateInfo.pEnabledFeatures = nullptr;
+	// optional, indirect draws of several sub meshes are issued by one multi-draw with them
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_vkPhysicalDevice, &supportedFeatures);
+	VkPhysicalDeviceFeatures enabledFeatures{};
+	enabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	enabledFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+	deviceCreateInfo.pEnabledFeatures = &enabledFeatures;
+
+	std::vector<const char*> extensionNames;
+	if (!m_settings.headless)
+	{
+		extensionNames.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	}
+	// optional, without it indirect draws skip the device written draw count
+	if (isDeviceExtensionSupported(m_vkPhysicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+	{
+		extensionNames.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+	}
 
-	std::vector<const char*> extensionNames{VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+	// on a 1.0 instance dynamic rendering needs the extensions it was promoted together with as well,
+	// the feature is guaranteed by any device exposing the extension
+	const char* dynamicRenderingExtensions[]{
+		VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+		VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+		VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,
+		VK_KHR_MULTIVIEW_EXTENSION_NAME,
+		VK_KHR_MAINTENANCE_2_EXTENSION_NAME
+	};
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+	dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+	dynamicRenderingFeatures.pNext = nullptr;
+	dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+	if (m_settings.dynamicRendering)
+	{
+		m_dynamicRendering = isInstanceExtensionSupported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+		for (auto pExtensionName : dynamicRenderingExtensions)
+		{
+			m_dynamicRendering = m_dynamicRendering && isDeviceExtensionSupported(m_vkPhysicalDevice, pExtensionName);
+		}
+		if (m_dynamicRendering)
+		{
+			extensionNames.insert(extensionNames.end(), std::begin(dynamicRenderingExtensions), std::end(dynamicRenderingExtensions));
+			dynamicRenderingFeatures.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+			deviceCreateInfo.pNext = &dynamicRenderingFeatures;
+		}
+		else
+		{
+			std::cout << VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME << " isn't supported, rendering with a render pass\n";
+		}
+	}
+
+	// the frame scheduler tracks every queue with a single timeline semaphore and submits
+	// through vkQueueSubmit2KHR when synchronization2 is there as well
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures{};
+	timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	timelineSemaphoreFeatures.pNext = nullptr;
+	timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+	VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+	synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+	synchronization2Features.pNext = nullptr;
+	synchronization2Features.synchronization2 = VK_TRUE;
+	if (m_settings.timelineSemaphores)
+	{
+		if (isInstanceExtensionSupported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) &&
+			isDeviceExtensionSupported(m_vkPhysicalDevice, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+		{
+			extensionNames.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+			timelineSemaphoreFeatures.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+			deviceCreateInfo.pNext = &timelineSemaphoreFeatures;
+			if (isDeviceExtensionSupported(m_vkPhysicalDevice, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME))
+			{
+				extensionNames.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+				synchronization2Features.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+				deviceCreateInfo.pNext = &synchronization2Features;
+			}
+		}
+		else
+		{
+			std::cout << VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME << " isn't supported, tracking frames with fences\n";
+		}
+	}
 	deviceCreateInfo.enabledExtensionCount = extensionNames.size();
-	deviceCreateInfo.ppEnabledExtensionNames = &extensionNames[0];
+	deviceCreateInfo.ppEnabledExtensionNames = extensionNames.data();
 
 	deviceCreateInfo.enabledLayerCount = 0;
 	deviceCreateInfo.ppEnabledLayerNames = nullptr;
 
 	deviceCreateInfo.flags = 0;
 	vkCreateDevice(m_vkPhysicalDevice, &deviceCreateInfo, nullptr, &m_vkDevice);
+
+	m_pDevice = new Device(m_vkDevice, m_vkPhysicalDevice, extensionNames, &enabledFeatures);
 }
 
 void HelloTriangleApplication::getQueues()
 {
 	vkGetDeviceQueue(m_vkDevice, m_queueFamilyIndices.graphicsQueueIndex.value(), 0, &m_graphicsQueue);
 	vkGetDeviceQueue(m_vkDevice, m_queueFamilyIndices.presentQueueIndex.value(), 0, &m_presentQueue);
+	vkGetDeviceQueue(m_vkDevice, m_queueFamilyIndices.transferQueueIndex.value(), 0, &m_transferQueue);
+	vkGetDeviceQueue(m_vkDevice, m_queueFamilyIndices.computeQueueIndex.value(), 0, &m_computeQueue);
+}
+
+void HelloTriangleApplication::createFrameScheduler()
+{
+	m_pScheduler = new FrameScheduler(*m_pDevice);
+	m_graphicsQueueId = m_pScheduler->addQueue(m_graphicsQueue);
+	m_pDeletionQueue = new DeletionQueue(m_vkDevice, *m_pScheduler);
+}
+
+void HelloTriangleApplication::createPipelineCache()
+{
+	m_pPipelineCache = new PipelineCache(m_vkDevice, m_vkPhysicalDevice, m_settings.pipelineCachePath);
+}
+
+void HelloTriangleApplication::createPipelineRegistry()
+{
+	if (m_settings.pipelineCompileThreads > 0)
+	{
+		m_pPipelineCompiler = new AsyncPipelineCompiler(m_settings.pipelineCompileThreads);
+	}
+	m_pPipelineRegistry = new PipelineRegistry(this, m_pPipelineCompiler);
 }
 
 void HelloTriangleApplication::createSwapChain()
 {
+	if (m_settings.headless)
+	{
+		// one image per frame in flight, each frame renders into its own
+		m_pOffscreenTarget = new OffscreenTarget(*m_pDevice, m_viewport, VK_FORMAT_R8G8B8A8_UNORM, m_settings.framesInFlight);
+		if (!m_settings.outputDir.empty())
+		{
+			std::filesystem::create_directories(m_settings.outputDir);
+		}
+		return;
+	}
+
 	m_pSwapChain = new SwapChain(this);
+	// the surface may not allow the exact window size
+	m_viewport = m_pSwapChain->getExtent();
+}
+
+bool HelloTriangleApplication::recreateSwapChain()
+{
+	TRACE_ZONE("RecreateSwapChain");
+	int width = 0, height = 0;
+#ifdef VULKANDEMO_GLFW
+	glfwGetFramebufferSize(m_pWindow, &width, &height);
+#endif
+	if (width == 0 || height == 0)
+	{
+#ifdef VULKANDEMO_GLFW
+		// minimized, nothing can be presented until the window is restored
+		glfwWaitEvents();
+#endif
+		return false;
+	}
+	m_viewport.width = (uint32_t)width;
+	m_viewport.height = (uint32_t)height;
+
+	// frames still in flight may use the old framebuffers and image views, the deletion
+	// queue destroys them once everything submitted so far has completed, so the device
+	// is never idled. The pipeline is kept as viewport and scissor are dynamic state.
+	for (auto& framebuffer : m_vkFrameBuffers)
+	{
+		m_pDeletionQueue->retire(framebuffer, vkDestroyFramebuffer);
+	}
+	m_vkFrameBuffers.clear();
+	// cached commands recorded for the old views are never replayed, and the handles may be reused by the
+	// new ones. Frames in flight may still execute them, so they are freed through the deletion queue as well
+	if (m_pCommandCache)
+	{
+		for (auto& imageView : m_pSwapChain->getImageViews())
+		{
+			m_pCommandCache->erase(imageView, *m_pDeletionQueue);
+		}
+	}
+	m_pSwapChain->recreate();
+
+	m_viewport = m_pSwapChain->getExtent();
+	createFrameBuffers();
+	// none of the new images has been rendered to yet
+	m_imagesInFlight.assign(getColorTargetViews().size(), 0);
+	m_swapChainOutOfDate = false;
+	return true;
 }
 
 void HelloTriangleApplication::createGraphicsPipeline()
 {
-	std::string vsPath = "D:/VulkanTutorial/VulkanDemo/out/build/x64-debug/shaders/vert.spv";
-	std::string fsPath = "D:/VulkanTutorial/VulkanDemo/out/build/x64-debug/shaders/frag.spv";
-	m_pGraphicsPipeline = new GraphicsPipeLine(this,vsPath,fsPath);
+	PipelineStateDesc desc;
+	desc.vsPath = m_settings.shaderDir + "/vert.spv";
+	desc.fsPath = m_settings.shaderDir + "/frag.spv";
+	desc.vertexLayout = Mesh::getVertexLayout();
+	InstanceBatcher::addInstanceAttributes(desc.vertexLayout, 2);
+	// set 0 holds the per-frame uniforms, streamed through the frame ring buffer
+	desc.descriptorSetLayouts.push_back(DescriptorSetLayoutDesc().addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT));
+	desc.pushConstantRanges.push_back({ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawConstants) });
+	// the render graph transitions the image for presenting or the readback after the pass
+	desc.colorFinalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	desc.dynamicRendering = m_dynamicRendering;
+	// with an async compiler, frames are drawn without the pipeline until pollPipelineCompilation() sees it finish
+	m_pGraphicsPipeline = m_pPipelineRegistry->acquire(desc);
+	if (m_pGraphicsPipeline->isReady())
+	{
+		reportPipelineCreation();
+	}
+	if (m_pCommandCache)
+	{
+		m_pCommandCache->invalidate();
+	}
 }
 
 void HelloTriangleApplication::createFrameBuffers()
 {
-	auto&imageViews = m_pSwapChain->getImageViews();
+	if (m_pCommandCache)
+	{
+		m_pCommandCache->invalidate();
+	}
+
+	// dynamic rendering begins on the image views themselves
+	if (m_dynamicRendering)
+		return;
+
+	auto& imageViews = getColorTargetViews();
 	m_vkFrameBuffers.resize(imageViews.size());
 	for (std::size_t i = 0; i < imageViews.size(); ++i)
 	{
@@ -400,26 +976,451 @@ void HelloTriangleApplication::createFrameBuffers()
 	}
 }
 
+std::vector<VkImageView>& HelloTriangleApplication::getColorTargetViews()
+{
+	return m_pOffscreenTarget ? m_pOffscreenTarget->getImageViews() : m_pSwapChain->getImageViews();
+}
+
 void HelloTriangleApplication::createCommandPool()
 {
-	m_pCommandPool = new CommandPool(m_vkDevice,m_queueFamilyIndices.graphicsQueueIndex.value());
-	m_cmdBuffer = m_pCommandPool->allocate();
+	m_pCommandPool = new CommandPool(m_vkDevice,m_queueFamilyIndices.graphicsQueueIndex.value(),
+		VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, m_pDeletionQueue);
+	m_frames.resize(m_settings.framesInFlight);
+	for (auto& frame : m_frames)
+	{
+		frame.cmdBuffer = m_pCommandPool->allocate();
+	}
+	m_pCommandCache = new CommandBufferCache(m_pCommandPool);
+
+	if (m_settings.recordThreads > 0)
+	{
+		m_pParallelRecorder = new ParallelCommandRecorder(m_vkDevice, m_queueFamilyIndices.graphicsQueueIndex.value(), m_settings.recordThreads, m_settings.framesInFlight);
+	}
+}
+
+void HelloTriangleApplication::reportPipelineCreation()
+{
+	std::cout << "graphics pipeline created in " << m_pGraphicsPipeline->getCreationTime() << " ms ("
+		<< (m_pPipelineCache->isWarm() ? "warm" : "cold") << " pipeline cache"
+		<< (m_pPipelineCompiler ? ", async" : "") << ")\n";
+}
+
+void HelloTriangleApplication::pollPipelineCompilation()
+{
+	// rethrows whatever a worker failed with
+	if (m_pPipelineRegistry->poll() > 0 && m_pGraphicsPipeline->isReady())
+	{
+		reportPipelineCreation();
+	}
+}
+
+void HelloTriangleApplication::createGpuProfiler()
+{
+	if (m_settings.profileGpu)
+	{
+		m_pGpuProfiler = new GpuProfiler(m_vkDevice, m_vkPhysicalDevice, m_queueFamilyIndices.graphicsQueueIndex.value(), m_settings.framesInFlight);
+	}
+}
+
+void HelloTriangleApplication::createMesh()
+{
+	TRACE_ZONE("CreateMesh");
+	m_pUploader = new StagingUploader(*m_pDevice, *m_pScheduler, m_transferQueue, m_queueFamilyIndices.transferQueueIndex.value(),
+		m_graphicsQueue, m_queueFamilyIndices.graphicsQueueIndex.value());
+
+	std::vector<Mesh::Vertex> vertices;
+	std::vector<uint32_t> indices;
+	if (m_settings.meshGridSize > 0)
+	{
+		Mesh::createGrid(m_settings.meshGridSize, vertices, indices);
+	}
+	else
+	{
+		Mesh::createTriangle(vertices, indices);
+	}
+
+	std::vector<Mesh::SubMesh> subMeshes;
+	if (m_settings.gpuDriven)
+	{
+		// the triangle is packed in as a second sub mesh, so the objects are spread over two draws
+		std::vector<Mesh::Vertex> subVertices;
+		std::vector<uint32_t> subIndices;
+		subVertices.swap(vertices);
+		subIndices.swap(indices);
+		subMeshes.push_back(Mesh::append(vertices, indices, subVertices, subIndices));
+		Mesh::createTriangle(subVertices, subIndices);
+		subMeshes.push_back(Mesh::append(vertices, indices, subVertices, subIndices));
+	}
+
+	// frames are drawn without the mesh until pollMeshUpload() sees the copies complete
+	m_meshUploadStart = std::chrono::steady_clock::now();
+	m_pMesh = new Mesh(*m_pDevice, *m_pUploader, vertices, indices, subMeshes);
+	if (m_settings.gpuDriven)
+	{
+		// every instance of the grid becomes an object, every other one drawn as the triangle
+		std::vector<IndirectObject> objects(m_instances.size());
+		for (std::size_t i = 0; i < objects.size(); ++i)
+		{
+			objects[i].instance = m_instances[i];
+			objects[i].drawIndex = (uint32_t)(i % subMeshes.size());
+		}
+		m_pIndirectDraws = new IndirectDrawBuilder(*m_pDevice, *m_pUploader, *m_pDescriptorAllocator, getPipelineCache(),
+			m_settings.shaderDir + "/indirect.spv", m_settings.framesInFlight, *m_pMesh, objects);
+	}
+	m_pUploader->flush();
+	pollMeshUpload();
+}
+
+void HelloTriangleApplication::pollMeshUpload()
+{
+	m_pUploader->poll();
+	if (m_meshUploaded || !m_pUploader->isComplete(m_pMesh->getUploadTicket()))
+		return;
+	if (m_pIndirectDraws && !m_pUploader->isComplete(m_pIndirectDraws->getUploadTicket()))
+		return;
+
+	// measured on the CPU up to the frame noticing completion, so it includes up to a frame of latency
+	m_meshUploaded = true;
+	double uploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_meshUploadStart).count();
+	std::cout << "mesh uploaded: " << m_pMesh->getIndexCount() / 3 << " triangles, " << m_pMesh->getByteSize() / 1024 << " KiB in "
+		<< uploadMs << " ms (" << (m_pMesh->getByteSize() / (1024.0 * 1024.0)) / (uploadMs / 1000.0) << " MiB/s, "
+		<< (m_pUploader->hasTransferQueue() ? "transfer queue" : "graphics queue") << ")\n";
+}
+
+void HelloTriangleApplication::createFrameRingBuffer()
+{
+	// the instance data is streamed every frame on top of the configured size
+	VkDeviceSize frameSize = m_settings.frameRingSize + sizeof(InstanceData) * (VkDeviceSize)m_settings.instanceCount;
+	m_pFrameRing = new FrameRingBuffer(*m_pDevice, m_settings.framesInFlight, frameSize);
+}
+
+void HelloTriangleApplication::createDescriptorAllocator()
+{
+	m_pDescriptorAllocator = new DescriptorAllocator(m_vkDevice, m_settings.framesInFlight);
+	m_stressSets.resize(m_settings.descriptorStressSets);
+}
+
+void HelloTriangleApplication::createInstanceBatcher()
+{
+	m_pInstanceBatcher = new InstanceBatcher(*m_pFrameRing);
+
+	// a square grid of cells with one scaled down mesh in each, a single instance covers the viewport as before
+	uint32_t instanceCnt = std::max(m_settings.instanceCount, 1u);
+	uint32_t side = (uint32_t)std::ceil(std::sqrt((double)instanceCnt));
+	float scale = 1.0f / side;
+	m_instances.resize(instanceCnt);
+	for (uint32_t i = 0; i < instanceCnt; ++i)
+	{
+		float x = side > 1 ? -1.0f + (2.0f * (i % side) + 1.0f) * scale : 0.0f;
+		float y = side > 1 ? -1.0f + (2.0f * (i / side) + 1.0f) * scale : 0.0f;
+		m_instances[i] = InstanceData{ { x, y, scale, 0.0f } };
+	}
+}
+
+void HelloTriangleApplication::createSceneBvh()
+{
+	// the gpu driven path culls in its pre-pass
+	if (!m_settings.cpuCulling || m_settings.gpuDriven)
+		return;
+
+	// a circle around each instance's origin, the mesh rotates around it
+	std::vector<Aabb2D> bounds(m_instances.size());
+	for (std::size_t i = 0; i < bounds.size(); ++i)
+	{
+		auto& offsetScale = m_instances[i].offsetScale;
+		float radius = m_pMesh->getBoundingRadius() * offsetScale[2];
+		bounds[i] = Aabb2D{ { offsetScale[0] - radius, offsetScale[1] - radius }, { offsetScale[0] + radius, offsetScale[1] + radius } };
+	}
+	m_pSceneBvh = new SceneBvh(bounds, m_settings.cullThreads);
+}
+
+void HelloTriangleApplication::createRenderGraph()
+{
+	m_pRenderGraph = new RenderGraph(*m_pDevice);
+
+	// the swapchain and offscreen images are set per command buffer by recordCommandBuffer(). The acquire semaphore
+	// is waited for at the color attachment stage, an offscreen image was last read by the previous readback
+	ResourceAccess backbufferInitial{};
+	backbufferInitial.stages = m_pOffscreenTarget ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	backbufferInitial.access = m_pOffscreenTarget ? VK_ACCESS_TRANSFER_READ_BIT : 0;
+	auto backbuffer = m_pRenderGraph->importImage("Backbuffer", VK_NULL_HANDLE, VK_IMAGE_ASPECT_COLOR_BIT, backbufferInitial);
+	m_backbufferResource = backbuffer;
+
+	// the previous frame's draws read the buffers the pre-pass rewrites
+	ResourceAccess drawRead{ VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT };
+	ResourceAccess instanceRead{ VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT };
+	std::vector<std::pair<RenderGraphResource, ResourceAccess>> drawInputs;
+	if (m_pIndirectDraws)
+	{
+		ResourceAccess prePassWrite{ VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+		drawInputs.push_back({ m_pRenderGraph->importBuffer("IndirectDraws", m_pIndirectDraws->getDrawBuffer(), drawRead), drawRead });
+		drawInputs.push_back({ m_pRenderGraph->importBuffer("IndirectDrawCounts", m_pIndirectDraws->getDrawCountBuffer(), drawRead), drawRead });
+		drawInputs.push_back({ m_pRenderGraph->importBuffer("IndirectInstances", m_pIndirectDraws->getInstanceBuffer(), instanceRead), instanceRead });
+		// each frame slot has counters of its own, read by beginFrame() once the slot comes around again
+		auto counters = m_pRenderGraph->importBuffer("CullCounters", m_pIndirectDraws->getCounterBuffer());
+		m_pRenderGraph->markOutput(counters, { VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT });
+
+		m_pRenderGraph->addPass("IndirectPrePass", [&](RenderGraph::PassBuilder& builder) {
+			for (auto& input : drawInputs)
+			{
+				builder.write(input.first, prePassWrite);
+			}
+			builder.write(counters, { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT });
+		}, [this](CommandBuffer& cmdBuffer) {
+			if (!m_meshUploaded)
+				return;
+
+			// culls against the same view transform buildCommands() pushes for the draws
+			m_pIndirectDraws->recordPrePass(cmdBuffer, m_currentFrame, getDrawConstants(m_settings.viewScale).offsetScale);
+		});
+	}
+
+	m_pRenderGraph->addPass("RenderPass", [&](RenderGraph::PassBuilder& builder) {
+		for (auto& input : drawInputs)
+		{
+			builder.read(input.first, input.second);
+		}
+		// cleared by the render pass, which leaves the image as a color attachment. Dynamic
+		// rendering has no layout transitions of its own, the graph does it from UNDEFINED
+		builder.write(backbuffer, { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			m_dynamicRendering ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+	}, [this](CommandBuffer& cmdBuffer) {
+		recordRenderPass(cmdBuffer, m_recordImageIndex);
+	});
+
+	if (m_pOffscreenTarget)
+	{
+		auto readback = m_pRenderGraph->importBuffer("Readback", VK_NULL_HANDLE);
+		m_readbackResource = readback;
+		m_pRenderGraph->markOutput(readback, { VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT });
+		m_pRenderGraph->addPass("Readback", [&](RenderGraph::PassBuilder& builder) {
+			builder.read(backbuffer, { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL });
+			builder.write(readback, { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT });
+		}, [this](CommandBuffer& cmdBuffer) {
+			m_pOffscreenTarget->recordReadback(cmdBuffer, m_recordImageIndex);
+		});
+	}
+	else
+	{
+		m_pRenderGraph->markOutput(backbuffer, { 0, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR });
+	}
+
+	m_pRenderGraph->compile();
+}
+
+void HelloTriangleApplication::buildCommands()
+{
+	m_commandStream.reset();
+	pollPipelineCompilation();
+	pollMeshUpload();
+	// until the pipeline is compiled the frame only clears, the pipeline handle is part
+	// of the cache key so these buffers are re-recorded once it becomes available
+	if (!m_pGraphicsPipeline->isReady())
+		return;
+
+	m_commandStream.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, m_pGraphicsPipeline->getPipeline());
+	VkViewport viewport{ 0.0f,0.0f,(float)m_viewport.width,(float)m_viewport.height,0.0f,1.0f };
+	VkRect2D   scissor{ {0,0},{m_viewport.width,m_viewport.height} };
+	m_commandStream.setViewport(&viewport, 1);
+	m_commandStream.setScissor(&scissor, 1);
+
+	if (!m_stressSets.empty())
+	{
+		TRACE_ZONE("DescriptorStress");
+		m_pDescriptorAllocator->allocateTransient(m_pGraphicsPipeline->getDescriptorSetLayout(0), (uint32_t)m_stressSets.size(), m_stressSets.data());
+	}
+
+	if (!m_meshUploaded)
+		return;
+
+	// a rotation by a fixed step per frame, so headless output is reproducible
+	float angle = (float)(m_submittedFrames % 3600) * 0.1f * 3.14159265f / 180.0f;
+	auto uniforms = m_pFrameRing->push(FrameUniforms{ { std::cos(angle), std::sin(angle), 0.0f, 0.0f } });
+	if (!uniforms)
+		return;
+
+	// the set always points at the start of the ring, the dynamic offset picks this frame's uniforms,
+	// so it is only written once and the cached command buffers of a frame slot stay valid
+	auto uniformWrite = DescriptorWrite::makeBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, m_pFrameRing->getBuffer(), 0, sizeof(FrameUniforms));
+	VkDescriptorSet uniformSet = m_pDescriptorAllocator->getPersistent(m_pGraphicsPipeline->getDescriptorSetLayout(0), { uniformWrite });
+	uint32_t dynamicOffset = (uint32_t)uniforms.offset;
+	m_commandStream.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, m_pGraphicsPipeline->getPipelineLayout(), 0, &uniformSet, 1, &dynamicOffset, 1);
+	m_commandStream.pushConstants(m_pGraphicsPipeline->getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, getDrawConstants(m_settings.viewScale));
+	if (m_pIndirectDraws)
+	{
+		// the pre-pass recorded by recordCommandBuffer() wrote the draws, the stream is the same for any object count
+		m_pIndirectDraws->draw(m_commandStream);
+		return;
+	}
+	if (m_pSceneBvh)
+	{
+		// clip space brought back through the view transform, into the space the instances are placed in
+		auto drawConstants = getDrawConstants(m_settings.viewScale);
+		float* pOffsetScale = drawConstants.offsetScale;
+		Aabb2D view{ { (-1.0f - pOffsetScale[0]) / pOffsetScale[2], (-1.0f - pOffsetScale[1]) / pOffsetScale[2] },
+			{ (1.0f - pOffsetScale[0]) / pOffsetScale[2], (1.0f - pOffsetScale[1]) / pOffsetScale[2] } };
+		m_pSceneBvh->cull(view, m_visibleIndices);
+
+		m_visibleInstances.resize(m_visibleIndices.size());
+		for (std::size_t i = 0; i < m_visibleIndices.size(); ++i)
+		{
+			m_visibleInstances[i] = m_instances[m_visibleIndices[i]];
+		}
+		m_pInstanceBatcher->add(*m_pMesh, m_visibleInstances.data(), (uint32_t)m_visibleInstances.size());
+	}
+	else
+	{
+		m_pInstanceBatcher->add(*m_pMesh, m_instances.data(), (uint32_t)m_instances.size());
+	}
+	m_pInstanceBatcher->flush(m_commandStream);
+}
+
+std::size_t HelloTriangleApplication::hashCommands(uint32_t imageIndex)
+{
+	// everything recordCommandBuffer() bakes into the command buffer
+	std::size_t seed = std::hash<VkImageView>()(getColorTargetViews()[imageIndex]);
+	if (!m_dynamicRendering)
+	{
+		hashCombine(seed, m_vkFrameBuffers[imageIndex]);
+	}
+	hashCombine(seed, m_pGraphicsPipeline->getRenderPass());
+	hashCombine(seed, m_pGraphicsPipeline->getPipeline());
+	hashCombine(seed, m_viewport.width);
+	hashCombine(seed, m_viewport.height);
+	hashCombine(seed, m_commandStream.hash());
+	return seed;
 }
 
-void HelloTriangleApplication::recordCommandBuffer(uint32_t imageIndex)
+CommandBuffer& HelloTriangleApplication::prepareCommandBuffer(FrameData& frame, uint32_t imageIndex)
 {
-	m_cmdBuffer->reset();
+	TRACE_ZONE("RecordCommandBuffer");
+	buildCommands();
+	// secondaries are re-recorded every frame, so a primary executing them can't be cached,
+	// neither can one writing timestamps into the query pool of the frame slot it was recorded for
+	if (!m_settings.cacheCommandBuffers || m_pParallelRecorder || m_pGpuProfiler)
+	{
+		recordCommandBuffer(*frame.cmdBuffer, imageIndex);
+		return *frame.cmdBuffer;
+	}
+
+	// drawFrame() has already waited on this frame slot's fence, so the buffers
+	// cached for the slot are no longer pending
+	auto target = getColorTargetViews()[imageIndex];
+	auto key = hashCommands(imageIndex);
+	auto cmdBuffer = m_pCommandCache->find(target, m_currentFrame, key);
+	if (!cmdBuffer)
+	{
+		cmdBuffer = m_pCommandCache->prepare(target, m_currentFrame, key);
+		recordCommandBuffer(*cmdBuffer, imageIndex);
+	}
+	return *cmdBuffer;
+}
+
+void HelloTriangleApplication::recordCommandBuffer(CommandBuffer& cmdBuffer, uint32_t imageIndex)
+{
+	cmdBuffer.reset();
 	VkCommandBufferBeginInfo cmdBufferBeginInfo{};
 	cmdBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	cmdBufferBeginInfo.pNext = nullptr;
 	cmdBufferBeginInfo.pInheritanceInfo = nullptr;
 	cmdBufferBeginInfo.flags = 0;
-	if (vkBeginCommandBuffer(*m_cmdBuffer,&cmdBufferBeginInfo) != VK_SUCCESS)
+	if (vkBeginCommandBuffer(cmdBuffer,&cmdBufferBeginInfo) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to begin command buffer!");
 	}
 
+	if (m_pGpuProfiler)
+	{
+		m_pGpuProfiler->recordReset(cmdBuffer);
+	}
+
+	// the graph scopes every pass with the profiler and records the barriers between them
+	m_recordImageIndex = imageIndex;
+	if (m_pOffscreenTarget)
+	{
+		m_pRenderGraph->setImage(m_backbufferResource, m_pOffscreenTarget->getImage(imageIndex));
+		m_pRenderGraph->setBuffer(m_readbackResource, m_pOffscreenTarget->getReadbackBuffer(imageIndex));
+	}
+	else
+	{
+		m_pRenderGraph->setImage(m_backbufferResource, m_pSwapChain->getImage(imageIndex));
+	}
+	m_pRenderGraph->execute(cmdBuffer, m_pGpuProfiler);
+
+	if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed end command buffer!");
+	}
+}
+
+void HelloTriangleApplication::recordRenderPass(CommandBuffer& cmdBuffer, uint32_t imageIndex)
+{
 	VkClearValue clearValue{ {{0.0f,0.0f,0.0f,1.0f}} };
+	if (m_dynamicRendering)
+	{
+		// the render graph has already transitioned the image to COLOR_ATTACHMENT_OPTIMAL
+		VkRenderingAttachmentInfoKHR colorAttachment{};
+		colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		colorAttachment.pNext = nullptr;
+		colorAttachment.imageView = getColorTargetViews()[imageIndex];
+		colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		colorAttachment.resolveMode = VK_RESOLVE_MODE_NONE_KHR;
+		colorAttachment.resolveImageView = VK_NULL_HANDLE;
+		colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		colorAttachment.clearValue = clearValue;
+
+		VkRenderingInfoKHR renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		renderingInfo.pNext = nullptr;
+		renderingInfo.flags = m_pParallelRecorder ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0;
+		renderingInfo.renderArea.offset = { 0,0 };
+		renderingInfo.renderArea.extent = { m_viewport.width,m_viewport.height };
+		renderingInfo.layerCount = 1;
+		renderingInfo.viewMask = 0;
+		renderingInfo.colorAttachmentCount = 1;
+		renderingInfo.pColorAttachments = &colorAttachment;
+		renderingInfo.pDepthAttachment = nullptr;
+		renderingInfo.pStencilAttachment = nullptr;
+		m_pDevice->getCmdBeginRendering()(cmdBuffer, &renderingInfo);
+
+		if (m_pParallelRecorder)
+		{
+			// secondaries inherit the attachment formats instead of a render pass and framebuffer
+			VkFormat colorFormat = getSwapChainImageFormat();
+			VkCommandBufferInheritanceRenderingInfoKHR renderingInheritanceInfo{};
+			renderingInheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+			renderingInheritanceInfo.pNext = nullptr;
+			renderingInheritanceInfo.flags = 0;
+			renderingInheritanceInfo.viewMask = 0;
+			renderingInheritanceInfo.colorAttachmentCount = 1;
+			renderingInheritanceInfo.pColorAttachmentFormats = &colorFormat;
+			renderingInheritanceInfo.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+			renderingInheritanceInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+			renderingInheritanceInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+			VkCommandBufferInheritanceInfo inheritanceInfo{};
+			inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+			inheritanceInfo.pNext = &renderingInheritanceInfo;
+			inheritanceInfo.renderPass = VK_NULL_HANDLE;
+			inheritanceInfo.subpass = 0;
+			inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+			inheritanceInfo.occlusionQueryEnable = VK_FALSE;
+			inheritanceInfo.queryFlags = 0;
+			inheritanceInfo.pipelineStatistics = 0;
+			m_pParallelRecorder->record(cmdBuffer, m_commandStream, inheritanceInfo);
+		}
+		else
+		{
+			m_commandStream.record(cmdBuffer, m_pGpuProfiler);
+		}
+
+		m_pDevice->getCmdEndRendering()(cmdBuffer);
+		return;
+	}
+
 	VkRenderPassBeginInfo renderPassBeginInfo;
 	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	renderPassBeginInfo.pNext = nullptr;
@@ -430,25 +1431,28 @@ void HelloTriangleApplication::recordCommandBuffer(uint32_t imageIndex)
 	renderPassBeginInfo.renderArea.extent = {m_viewport.width,m_viewport.height};
 	renderPassBeginInfo.framebuffer = m_vkFrameBuffers[imageIndex];
 
-	vkCmdBeginRenderPass(*m_cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(*m_cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,m_pGraphicsPipeline->getPipeline());
-	std::vector<std::shared_ptr<Command>> cmds;
-	std::vector<VkViewport> viewports{ {0.0f,0.0f,(float)m_viewport.width,(float)m_viewport.height,0.0f,1.0f} };
-	std::vector<VkRect2D>   scissors{ {{0,0},{m_viewport.width,m_viewport.height}} };
-	cmds.push_back(std::make_shared<SetViewport>(viewports));
-	cmds.push_back(std::make_shared<SetScissor>(scissors));
-	cmds.push_back(std::make_shared<Draw>(3));
-	for (auto& cmd : cmds)
+	if (m_pParallelRecorder)
 	{
-		cmd->record(*m_cmdBuffer);
+		VkCommandBufferInheritanceInfo inheritanceInfo{};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.pNext = nullptr;
+		inheritanceInfo.renderPass = m_pGraphicsPipeline->getRenderPass();
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = m_vkFrameBuffers[imageIndex];
+		inheritanceInfo.occlusionQueryEnable = VK_FALSE;
+		inheritanceInfo.queryFlags = 0;
+		inheritanceInfo.pipelineStatistics = 0;
+
+		vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		m_pParallelRecorder->record(cmdBuffer, m_commandStream, inheritanceInfo);
 	}
-
-	vkCmdEndRenderPass(*m_cmdBuffer);
-
-	if (vkEndCommandBuffer(*m_cmdBuffer) != VK_SUCCESS)
+	else
 	{
-		throw std::runtime_error("failed end command buffer!");
+		vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		m_commandStream.record(cmdBuffer, m_pGpuProfiler);
 	}
+
+	vkCmdEndRenderPass(cmdBuffer);
 }
 
 void HelloTriangleApplication::createSyncObjects()
@@ -463,59 +1467,190 @@ void HelloTriangleApplication::createSyncObjects()
 	renderingFinishedSemaphoreCreateInfo.flags = 0;
 	renderingFinishedSemaphoreCreateInfo.pNext = nullptr;
 
-	VkFenceCreateInfo inFlightFenceCreateInfo{};
-	inFlightFenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	inFlightFenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-	inFlightFenceCreateInfo.pNext = nullptr;
+	for (auto& frame : m_frames)
+	{
+		if (vkCreateSemaphore(m_vkDevice, &imageAvailableSemaphoreCreateInfo, nullptr, &frame.imageAvailableSemaphore) != VK_SUCCESS
+			|| vkCreateSemaphore(m_vkDevice, &renderingFinishedSemaphoreCreateInfo, nullptr, &frame.renderingFinishedSemaphore) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create sync objects!");
+		}
+	}
+
+	m_imagesInFlight.assign(getColorTargetViews().size(), 0);
+}
 
-	if (vkCreateSemaphore(m_vkDevice, &imageAvailableSemaphoreCreateInfo, nullptr, &m_imageAvailableSemaphore) != VK_SUCCESS
-		|| vkCreateSemaphore(m_vkDevice, &renderingFinishedSemaphoreCreateInfo, nullptr, &m_renderingFinishedSemaphore) != VK_SUCCESS ||
-		vkCreateFence(m_vkDevice, &inFlightFenceCreateInfo, nullptr, &m_inFlightFence) != VK_SUCCESS)
+void HelloTriangleApplication::drawOffscreenFrame()
+{
+	FrameData& frame = m_frames[m_currentFrame];
+	// every frame slot renders into its own image, so there is nothing to acquire
+	uint32_t imageIndex = m_currentFrame;
+
+	auto waitStart = std::chrono::steady_clock::now();
+	{
+		TRACE_ZONE("WaitForFrame");
+		m_pScheduler->wait(m_graphicsQueueId, frame.timelineValue);
+	}
+	m_pDeletionQueue->collect();
+	saveOffscreenFrame(imageIndex, frame.submitIndex);
+	if (m_pGpuProfiler)
 	{
-		throw std::runtime_error("failed to create sync objects!");
+		m_pGpuProfiler->beginFrame(m_currentFrame);
 	}
+	m_pFrameRing->beginFrame(m_currentFrame);
+	m_pDescriptorAllocator->beginFrame(m_currentFrame);
+	if (m_pIndirectDraws)
+	{
+		m_pIndirectDraws->beginFrame(m_currentFrame);
+	}
+	if (m_pParallelRecorder)
+	{
+		m_pParallelRecorder->beginFrame(m_currentFrame);
+	}
+	auto recordStart = std::chrono::steady_clock::now();
+	m_frameTimings.fenceWaitMs += std::chrono::duration<double, std::milli>(recordStart - waitStart).count();
+
+	VkCommandBuffer cmdBuffer = prepareCommandBuffer(frame, imageIndex);
+	m_pFrameRing->flush();
+	m_frameTimings.recordMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
+
+	FrameScheduler::Submit submit;
+	submit.pCmdBuffers = &cmdBuffer;
+	submit.cmdBufferCnt = 1;
+	{
+		TRACE_ZONE("QueueSubmit");
+		frame.timelineValue = m_pScheduler->submit(m_graphicsQueueId, submit);
+	}
+	frame.submitIndex = ++m_submittedFrames;
+
+	m_currentFrame = (m_currentFrame + 1) % m_frames.size();
+}
+
+void HelloTriangleApplication::saveOffscreenFrame(uint32_t imageIndex, uint64_t frameIndex)
+{
+	// frame 0 was never submitted
+	if (m_settings.outputDir.empty() || frameIndex == 0)
+		return;
+
+	TRACE_ZONE("SaveFrame");
+	char fileName[32];
+	std::snprintf(fileName, sizeof(fileName), "frame_%05llu.ppm", (unsigned long long)frameIndex);
+	m_pOffscreenTarget->writePPM(imageIndex, (std::filesystem::path(m_settings.outputDir) / fileName).string());
 }
 
 void HelloTriangleApplication::drawFrame()
 {
-	vkWaitForFences(m_vkDevice,1,&m_inFlightFence,true,UINT64_MAX);
-	vkResetFences(m_vkDevice, 1, &m_inFlightFence);
-	uint32_t imageIndex = 0;
-	vkAcquireNextImageKHR(m_vkDevice, *m_pSwapChain, UINT64_MAX, m_imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
-	recordCommandBuffer(imageIndex);
+	if (m_pOffscreenTarget)
+	{
+		drawOffscreenFrame();
+		return;
+	}
 
-	VkCommandBuffer cmdBuffer = *m_cmdBuffer;
-	VkPipelineStageFlags pipelineStateMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.pNext = nullptr;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &cmdBuffer;
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = &m_imageAvailableSemaphore;
-	submitInfo.pWaitDstStageMask=&pipelineStateMask;
+	FrameData& frame = m_frames[m_currentFrame];
+	if (m_swapChainOutOfDate && !recreateSwapChain())
+		return;
 
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = &m_renderingFinishedSemaphore;
+	auto waitStart = std::chrono::steady_clock::now();
+	{
+		TRACE_ZONE("WaitForFrame");
+		m_pScheduler->wait(m_graphicsQueueId, frame.timelineValue);
+	}
+	// destroys retired swapchains, framebuffers and pipelines the GPU has finished with
+	m_pDeletionQueue->collect();
+	if (m_pGpuProfiler)
+	{
+		m_pGpuProfiler->beginFrame(m_currentFrame);
+	}
+	m_pFrameRing->beginFrame(m_currentFrame);
+	m_pDescriptorAllocator->beginFrame(m_currentFrame);
+	if (m_pIndirectDraws)
+	{
+		m_pIndirectDraws->beginFrame(m_currentFrame);
+	}
+	if (m_pParallelRecorder)
+	{
+		m_pParallelRecorder->beginFrame(m_currentFrame);
+	}
+
+	uint32_t imageIndex = 0;
+	VkResult acquireResult;
+	{
+		TRACE_ZONE("AcquireNextImage");
+		acquireResult = vkAcquireNextImageKHR(m_vkDevice, *m_pSwapChain, UINT64_MAX, frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+	}
+	if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		// nothing was submitted for the frame slot, so it can simply be retried
+		m_swapChainOutOfDate = true;
+		return;
+	}
+	if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR)
+	{
+		throw std::runtime_error("failed to acquire swapchain image!");
+	}
+	// a suboptimal image is still acquired and signals the semaphore, render it and recreate afterwards
+	if (acquireResult == VK_SUBOPTIMAL_KHR)
+	{
+		m_swapChainOutOfDate = true;
+	}
 
-	if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_inFlightFence) != VK_SUCCESS)
+	// the swapchain may hand out images out of order, so the acquired image can
+	// still be rendered to by another frame slot
+	if (!m_pScheduler->isComplete(m_graphicsQueueId, m_imagesInFlight[imageIndex]))
 	{
-		throw std::runtime_error("failed to submit qeueue!");
+		TRACE_ZONE("WaitForImage");
+		m_pScheduler->wait(m_graphicsQueueId, m_imagesInFlight[imageIndex]);
 	}
+	auto recordStart = std::chrono::steady_clock::now();
+	m_frameTimings.fenceWaitMs += std::chrono::duration<double, std::milli>(recordStart - waitStart).count();
+
+	VkCommandBuffer cmdBuffer = prepareCommandBuffer(frame, imageIndex);
+	m_pFrameRing->flush();
+	m_frameTimings.recordMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
+
+	// acquire and present only work with binary semaphores, the frame itself is tracked by the queue's value
+	FrameScheduler::SemaphoreWait imageAvailableWait{ frame.imageAvailableSemaphore, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	FrameScheduler::Submit submit;
+	submit.pCmdBuffers = &cmdBuffer;
+	submit.cmdBufferCnt = 1;
+	submit.pSemaphoreWaits = &imageAvailableWait;
+	submit.semaphoreWaitCnt = 1;
+	submit.pSignalSemaphores = &frame.renderingFinishedSemaphore;
+	submit.signalSemaphoreCnt = 1;
+	{
+		TRACE_ZONE("QueueSubmit");
+		frame.timelineValue = m_pScheduler->submit(m_graphicsQueueId, submit);
+	}
+	m_imagesInFlight[imageIndex] = frame.timelineValue;
+	frame.submitIndex = ++m_submittedFrames;
 
 
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
 	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = &m_renderingFinishedSemaphore;
+	presentInfo.pWaitSemaphores = &frame.renderingFinishedSemaphore;
 
 	VkSwapchainKHR swapChains[] = { *m_pSwapChain };
 	presentInfo.swapchainCount = 1;
 	presentInfo.pSwapchains = swapChains;
 	presentInfo.pImageIndices = &imageIndex;
 
-	vkQueuePresentKHR(m_presentQueue, &presentInfo);
+	VkResult presentResult;
+	{
+		TRACE_ZONE("QueuePresent");
+		presentResult = vkQueuePresentKHR(m_presentQueue, &presentInfo);
+	}
+	if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR || m_framebufferResized)
+	{
+		m_framebufferResized = false;
+		m_swapChainOutOfDate = true;
+	}
+	else if (presentResult != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to present swapchain image!");
+	}
+
+	m_currentFrame = (m_currentFrame + 1) % m_frames.size();
 }
 
 VKAPI_ATTR VkBool32 VKAPI_CALL HelloTriangleApplication::debugCallback(
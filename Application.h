@@ -5,21 +5,133 @@
 #include <optional>
 #include <vulkan/vulkan.h>
 #include <memory>
+#include <string>
+#include <deque>
+#include <chrono>
+#include "commands/CommandStream.h"
+#include "SwapChain.h"
+#include "InstanceBatcher.h"
+#include "FrameScheduler.h"
+#include "DeletionQueue.h"
 
 class GLFWwindow;
-class SwapChain;
+
+#ifndef VULKANDEMO_SHADER_DIR
+#define VULKANDEMO_SHADER_DIR "shaders"
+#endif
+
 class GraphicsPipeLine;
 class CommandPool;
 class CommandBuffer;
+class CommandBufferCache;
+class ParallelCommandRecorder;
+class PipelineCache;
+class AsyncPipelineCompiler;
+class PipelineRegistry;
+class OffscreenTarget;
+class GpuProfiler;
+class Device;
+class StagingUploader;
+class Mesh;
+class FrameRingBuffer;
+class DescriptorAllocator;
+class IndirectDrawBuilder;
+class SceneBvh;
+class RenderGraph;
 class HelloTriangleApplication {
 public:
 	struct QueueFamilyIndices final
 	{
 		std::optional<uint32_t> graphicsQueueIndex;
 		std::optional<uint32_t> presentQueueIndex;
+		// families without graphics support, so their work runs beside rendering.
+		// Both fall back to the graphics family when the device has none.
+		std::optional<uint32_t> transferQueueIndex;
+		std::optional<uint32_t> computeQueueIndex;
+	};
+
+	struct Settings final
+	{
+		// number of frames the CPU may record ahead of the GPU
+		uint32_t framesInFlight = 2;
+		// stop after this many frames, 0 runs until the window is closed
+		uint64_t maxFrames = 0;
+		// resubmit the previously recorded command buffer when nothing changed
+		bool     cacheCommandBuffers = true;
+		// record draws into secondary command buffers on this many worker
+		// threads, 0 records everything inline on the main thread
+		uint32_t recordThreads = 0;
+		// where the pipeline cache is loaded from and saved to
+		std::string pipelineCachePath = "pipeline_cache.bin";
+		// compile pipelines on this many worker threads while frames keep
+		// presenting, 0 compiles them on the main thread during startup
+		uint32_t pipelineCompileThreads = 1;
+		// render into offscreen images without a window, surface or swapchain
+		bool     headless = false;
+		// headless only, every rendered frame is written here as a PPM file when set
+		std::string outputDir;
+		// where vert.spv and frag.spv are loaded from, defaults to where the build compiled them
+		std::string shaderDir = VULKANDEMO_SHADER_DIR;
+		// window size, or the offscreen image size when headless
+		uint32_t width = 1600;
+		uint32_t height = 1200;
+		// time the render pass and every command with timestamp queries,
+		// bypasses the command buffer cache
+		bool     profileGpu = false;
+		// where the GPU profile is dumped as JSON on exit, empty skips the dump
+		std::string gpuProfilePath = "gpu_profile.json";
+		// record CPU zones and write them here as a Chrome trace on exit, empty disables tracing
+		std::string tracePath;
+		// 0 draws the triangle, otherwise a grid of meshGridSize^2 quads is uploaded
+		// and drawn to load the vertex path with millions of triangles
+		uint32_t meshGridSize = 0;
+		// bytes of uniforms, transforms and instance data each frame in flight can stream
+		uint32_t frameRingSize = 4 * 1024 * 1024;
+		// allocate this many throwaway transient descriptor sets every frame to
+		// measure the descriptor allocator, 0 disables the stress test
+		uint32_t descriptorStressSets = 0;
+		// the mesh is drawn this many times in a grid, batched into one instanced draw
+		uint32_t instanceCount = 1;
+		// draw the instances through a compute pre-pass writing indirect draws instead of the instance batcher
+		bool gpuDriven = false;
+		// scale of the whole scene around the viewport center, above 1 moves instances out of view for culling to skip
+		float viewScale = 1.0f;
+		// reject instances outside of the view with a BVH on the CPU before they reach the instance batcher
+		bool cpuCulling = false;
+		// threads helping the main thread cull, only pays off when a large part of the scene is visible
+		uint32_t cullThreads = 0;
+		// begin rendering on the image views with VK_KHR_dynamic_rendering instead of a render pass and framebuffers,
+		// the render pass path is kept when the device doesn't support it
+		bool dynamicRendering = false;
+		// track queue progress with one VK_KHR_timeline_semaphore per queue, falls back to
+		// recycled fences when the device doesn't support it
+		bool timelineSemaphores = true;
+	};
+
+	// per frame-in-flight resources, used round-robin by drawFrame()
+	struct FrameData final
+	{
+		std::shared_ptr<CommandBuffer> cmdBuffer;
+		VkSemaphore                    imageAvailableSemaphore = VK_NULL_HANDLE;
+		VkSemaphore                    renderingFinishedSemaphore = VK_NULL_HANDLE;
+		// graphics queue value of the last submission of this slot
+		uint64_t                       timelineValue = 0;
+		// value of m_submittedFrames when this slot was last submitted
+		uint64_t                       submitIndex = 0;
+	};
+
+	struct FrameTimings final
+	{
+		uint64_t frameCount = 0;
+		double   totalFrameMs = 0.0;
+		double   fenceWaitMs = 0.0;
+		double   recordMs = 0.0;
 	};
 
 public:
+	HelloTriangleApplication();
+	explicit HelloTriangleApplication(const Settings& settings);
+
 	void run() {
 		initWindow();
 		initVulkan();
@@ -32,6 +144,18 @@ public:
 		return m_vkDevice;
 	}
 
+	// wrapper owning the device memory allocator
+	Device& getLogicalDevice()
+	{
+		return *m_pDevice;
+	}
+
+	// destroys objects replaced at runtime once the frames using them have finished
+	DeletionQueue& getDeletionQueue()
+	{
+		return *m_pDeletionQueue;
+	}
+
 	VkPhysicalDevice getPhysicalDevice()
 	{
 		return m_vkPhysicalDevice;
@@ -42,6 +166,8 @@ public:
 		return m_surface;
 	}
 
+	VkPipelineCache getPipelineCache();
+
 	VkFormat getSwapChainImageFormat();
 	VkRenderPass getRenderPass();
 
@@ -84,36 +210,100 @@ private:
 	void queryQueueFamilyIndices();
 	void createDevice();
 	void getQueues();
+	void createFrameScheduler();
+	void createPipelineCache();
+	void createPipelineRegistry();
 	void createSwapChain();
+	bool recreateSwapChain();
 	void createGraphicsPipeline();
 	void createFrameBuffers();
+	std::vector<VkImageView>& getColorTargetViews();
 	void createCommandPool();
-	void recordCommandBuffer(uint32_t imageIndex);
+	void createGpuProfiler();
+	void createMesh();
+	void createFrameRingBuffer();
+	void createDescriptorAllocator();
+	void createInstanceBatcher();
+	void createSceneBvh();
+	void createRenderGraph();
+	void pollMeshUpload();
+	void reportPipelineCreation();
+	void pollPipelineCompilation();
+	void buildCommands();
+	std::size_t hashCommands(uint32_t imageIndex);
+	CommandBuffer& prepareCommandBuffer(FrameData& frame, uint32_t imageIndex);
+	void recordCommandBuffer(CommandBuffer& cmdBuffer, uint32_t imageIndex);
+	void recordRenderPass(CommandBuffer& cmdBuffer, uint32_t imageIndex);
 	void createSyncObjects();
 	void drawFrame();
+	void drawOffscreenFrame();
+	void saveOffscreenFrame(uint32_t imageIndex, uint64_t frameIndex);
+	void reportFrameTimings();
 
+	static void framebufferResizeCallback(GLFWwindow* pWindow, int width, int height);
 	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
 		VkDebugUtilsMessageSeverityFlagBitsEXT           messageSeverity,
 		VkDebugUtilsMessageTypeFlagsEXT                  messageTypes,
 		const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData,
 		void* pUserData);
 private:
-	GLFWwindow* m_pWindow;
+	Settings                      m_settings;
+	GLFWwindow* m_pWindow = nullptr;
 	VkInstance                    m_vkInstance;
 	VkPhysicalDevice              m_vkPhysicalDevice;
 	VkDevice                      m_vkDevice;
+	Device*                       m_pDevice = nullptr;
 	VkQueue                       m_graphicsQueue;
 	VkQueue                       m_presentQueue;
-	VkSurfaceKHR                  m_surface;
+	VkQueue                       m_transferQueue = VK_NULL_HANDLE;
+	VkQueue                       m_computeQueue = VK_NULL_HANDLE;
+	FrameScheduler*               m_pScheduler = nullptr;
+	FrameScheduler::QueueId       m_graphicsQueueId = 0;
+	DeletionQueue*                m_pDeletionQueue = nullptr;
+	VkSurfaceKHR                  m_surface = VK_NULL_HANDLE;
 	VkExtent2D                    m_viewport;
-	SwapChain* m_pSwapChain;
+	SwapChain* m_pSwapChain = nullptr;
+	OffscreenTarget*              m_pOffscreenTarget = nullptr;
 	GraphicsPipeLine* m_pGraphicsPipeline;
+	PipelineCache*                m_pPipelineCache = nullptr;
+	AsyncPipelineCompiler*        m_pPipelineCompiler = nullptr;
+	PipelineRegistry*             m_pPipelineRegistry = nullptr;
 	VkDebugUtilsMessengerEXT      m_debugMessager;
+	// empty with dynamic rendering
 	std::vector<VkFramebuffer>    m_vkFrameBuffers;
+	// VK_KHR_dynamic_rendering was requested and is enabled on the device
+	bool                          m_dynamicRendering = false;
 	CommandPool* m_pCommandPool;
-	std::shared_ptr<CommandBuffer> m_cmdBuffer;
+	CommandBufferCache*           m_pCommandCache = nullptr;
+	CommandStream                 m_commandStream;
+	ParallelCommandRecorder*      m_pParallelRecorder = nullptr;
+	GpuProfiler*                  m_pGpuProfiler = nullptr;
+	StagingUploader*              m_pUploader = nullptr;
+	Mesh*                         m_pMesh = nullptr;
+	FrameRingBuffer*              m_pFrameRing = nullptr;
+	DescriptorAllocator*          m_pDescriptorAllocator = nullptr;
+	std::vector<VkDescriptorSet>  m_stressSets;
+	InstanceBatcher*              m_pInstanceBatcher = nullptr;
+	std::vector<InstanceData>     m_instances;
+	IndirectDrawBuilder*          m_pIndirectDraws = nullptr;
+	SceneBvh*                     m_pSceneBvh = nullptr;
+	std::vector<uint32_t>         m_visibleIndices;
+	std::vector<InstanceData>     m_visibleInstances;
+	RenderGraph*                  m_pRenderGraph = nullptr;
+	uint32_t                      m_backbufferResource = 0;
+	uint32_t                      m_readbackResource = 0;
+	// the image the passes of the graph record for, set by recordCommandBuffer()
+	uint32_t                      m_recordImageIndex = 0;
+	bool                          m_meshUploaded = false;
+	std::chrono::steady_clock::time_point m_meshUploadStart;
+
+	std::vector<FrameData>        m_frames;
+	uint32_t                      m_currentFrame = 0;
+	// graphics queue value of the frame that last rendered into each swapchain image
+	std::vector<uint64_t>         m_imagesInFlight;
+	FrameTimings                  m_frameTimings;
+	uint64_t                      m_submittedFrames = 0;
 
-	VkSemaphore                   m_imageAvailableSemaphore;
-	VkSemaphore                   m_renderingFinishedSemaphore;
-	VkFence                       m_inFlightFence;
+	bool                          m_framebufferResized = false;
+	bool                          m_swapChainOutOfDate = false;
 };
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "AsyncPipelineCompiler.h"
+#include "GraphicsPipeLine.h"
+#include "Tracer.h"
+#include <algorithm>
+
+AsyncPipelineCompiler::AsyncPipelineCompiler(uint32_t threadCnt)
+{
+	threadCnt = std::max(threadCnt, 1u);
+	for (uint32_t i = 0; i < threadCnt; ++i)
+	{
+		m_workers.emplace_back(&AsyncPipelineCompiler::workerLoop, this);
+	}
+}
+
+AsyncPipelineCompiler::~AsyncPipelineCompiler()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_jobAvailable.notify_all();
+
+	for (auto& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+std::shared_future<VkPipeline> AsyncPipelineCompiler::request(GraphicsPipeLine* pPipeline)
+{
+	Job job;
+	job.pPipeline = pPipeline;
+	std::shared_future<VkPipeline> future = job.promise.get_future().share();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(std::move(job));
+	}
+	m_jobAvailable.notify_one();
+	return future;
+}
+
+void AsyncPipelineCompiler::waitIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this] { return m_jobs.empty() && m_busyWorkers == 0; });
+}
+
+void AsyncPipelineCompiler::workerLoop()
+{
+	TRACE_THREAD_NAME("pipeline compiler");
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobAvailable.wait(lock, [this] { return m_quit || !m_jobs.empty(); });
+			// drain the queue even when quitting, nobody may be left waiting on a broken promise
+			if (m_jobs.empty())
+				return;
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+			++m_busyWorkers;
+		}
+
+		try
+		{
+			TRACE_ZONE("CompilePipeline");
+			job.promise.set_value(job.pPipeline->compile());
+		}
+		catch (...)
+		{
+			job.promise.set_exception(std::current_exception());
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			--m_busyWorkers;
+		}
+		m_idle.notify_all();
+	}
+}
\ No newline at end of file
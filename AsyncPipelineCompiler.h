@@ -0,0 +1,50 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+class GraphicsPipeLine;
+
+// Compiles graphics pipelines on a small pool of worker threads so that
+// vkCreateGraphicsPipelines never stalls the render loop. The returned future
+// becomes ready once the pipeline can be bound and rethrows compile errors.
+class AsyncPipelineCompiler
+{
+public:
+	explicit AsyncPipelineCompiler(uint32_t threadCnt);
+	// finishes the queued requests before joining the workers
+	~AsyncPipelineCompiler();
+
+	// pPipeline must stay alive until the returned future is ready
+	std::shared_future<VkPipeline> request(GraphicsPipeLine* pPipeline);
+
+	// blocks until every queued request has been compiled
+	void waitIdle();
+
+	uint32_t getThreadCount()const
+	{
+		return (uint32_t)m_workers.size();
+	}
+
+private:
+	struct Job
+	{
+		GraphicsPipeLine*        pPipeline = nullptr;
+		std::promise<VkPipeline> promise;
+	};
+
+	void workerLoop();
+
+private:
+	std::vector<std::thread> m_workers;
+	std::deque<Job>          m_jobs;
+	uint32_t                 m_busyWorkers = 0;
+
+	std::mutex               m_mutex;
+	std::condition_variable  m_jobAvailable;
+	std::condition_variable  m_idle;
+	bool                     m_quit = false;
+};
\ No newline at end of file
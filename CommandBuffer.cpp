@@ -3,7 +3,7 @@
 #include <stdexcept>
 
 CommandBuffer::CommandBuffer(CommandPool* pCmdPool,VkCommandBufferLevel level)
-	:m_level(level)
+	:m_device(pCmdPool->getDevice()), m_vkCommandPool(*pCmdPool), m_level(level)
 {
 	VkCommandBufferAllocateInfo cmdBufferAllocateInfo{};
 	cmdBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -20,7 +20,7 @@ CommandBuffer::CommandBuffer(CommandPool* pCmdPool,VkCommandBufferLevel level)
 
 CommandBuffer::~CommandBuffer()
 {
-
+	vkFreeCommandBuffers(m_device, m_vkCommandPool, 1, &m_vkCommandBuffer);
 }
 
 void CommandBuffer::reset()
@@ -1,6 +1,8 @@
 #pragma once
 #include "vulkan/vulkan.h"
 class CommandPool;
+// Freed back to its pool when destroyed, so it must not be pending execution by
+// then and the pool must still exist
 class CommandBuffer
 {
 public:
@@ -15,6 +17,8 @@ public:
 
 	void reset();
 private:
+	VkDevice        m_device;
+	VkCommandPool   m_vkCommandPool;
 	VkCommandBuffer m_vkCommandBuffer;
 	VkCommandBufferLevel m_level;
 };
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "CommandBufferCache.h"
+#include "CommandPool.h"
+#include "CommandBuffer.h"
+#include "DeletionQueue.h"
+
+CommandBufferCache::CommandBufferCache(CommandPool* pCmdPool) :m_pCmdPool(pCmdPool)
+{
+
+}
+
+CommandBufferCache::~CommandBufferCache()
+{
+
+}
+
+std::shared_ptr<CommandBuffer> CommandBufferCache::find(VkImageView target, uint32_t frameIndex, std::size_t key)
+{
+	auto it = m_entries.find(target);
+	if (it != m_entries.end() && frameIndex < it->second.size())
+	{
+		auto& entry = it->second[frameIndex];
+		if (entry.valid && entry.key == key)
+		{
+			++m_hits;
+			return entry.cmdBuffer;
+		}
+	}
+
+	++m_misses;
+	return nullptr;
+}
+
+std::shared_ptr<CommandBuffer> CommandBufferCache::prepare(VkImageView target, uint32_t frameIndex, std::size_t key)
+{
+	auto& entries = m_entries[target];
+	if (frameIndex >= entries.size())
+	{
+		entries.resize(frameIndex + 1);
+	}
+	auto& entry = entries[frameIndex];
+	if (!entry.cmdBuffer)
+	{
+		entry.cmdBuffer = m_pCmdPool->allocate();
+	}
+
+	entry.key = key;
+	entry.valid = true;
+	return entry.cmdBuffer;
+}
+
+void CommandBufferCache::invalidate()
+{
+	for (auto& entries : m_entries)
+	{
+		for (auto& entry : entries.second)
+		{
+			entry.valid = false;
+		}
+	}
+}
+
+void CommandBufferCache::invalidate(VkImageView target)
+{
+	auto it = m_entries.find(target);
+	if (it != m_entries.end())
+	{
+		for (auto& entry : it->second)
+		{
+			entry.valid = false;
+		}
+	}
+}
+
+
+void CommandBufferCache::erase(VkImageView target, DeletionQueue& deletionQueue)
+{
+	auto it = m_entries.find(target);
+	if (it == m_entries.end())
+		return;
+
+	std::vector<std::shared_ptr<CommandBuffer>> cmdBuffers;
+	for (auto& entry : it->second)
+	{
+		if (entry.cmdBuffer)
+		{
+			cmdBuffers.push_back(std::move(entry.cmdBuffer));
+		}
+	}
+	m_entries.erase(it);
+	// the last reference going away frees the buffers back to the pool
+	deletionQueue.retire([cmdBuffers = std::move(cmdBuffers)]() mutable { cmdBuffers.clear(); });
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+class CommandPool;
+class CommandBuffer;
+class DeletionQueue;
+
+// Keeps one recorded primary command buffer per render target and frame slot
+// together with the key it was recorded for. When a frame produces the same
+// key again the buffer is resubmitted as-is instead of being reset and
+// re-recorded. Keying on the frame slot as well lets buffers that reference
+// per-frame data, like offsets into the frame ring buffer, still be reused.
+//
+// The caller must guarantee a cached buffer is no longer pending execution
+// before it is resubmitted or re-recorded (drawFrame() does this by waiting
+// on the fence of the frame slot, which last submitted the buffer).
+class CommandBufferCache
+{
+public:
+	CommandBufferCache(CommandPool* pCmdPool);
+	~CommandBufferCache();
+
+	// target is the color attachment's image view, which stands for the framebuffer
+	// built on it as well, since dynamic rendering has no framebuffer to key on.
+	// Returns the buffer recorded for target with the same key, nullptr on a miss
+	std::shared_ptr<CommandBuffer> find(VkImageView target, uint32_t frameIndex, std::size_t key);
+
+	// returns the buffer to re-record for target and remembers key for it;
+	// the caller has to record the buffer before it is found again
+	std::shared_ptr<CommandBuffer> prepare(VkImageView target, uint32_t frameIndex, std::size_t key);
+
+	// forget what was recorded, e.g. when the pipeline or swapchain changes
+	void invalidate();
+	void invalidate(VkImageView target);
+
+	// drops the buffers of a destroyed image view, deletionQueue frees them once
+	// everything submitted so far, which may still execute them, has completed
+	void erase(VkImageView target, DeletionQueue& deletionQueue);
+
+	uint64_t getHits()const
+	{
+		return m_hits;
+	}
+
+	uint64_t getMisses()const
+	{
+		return m_misses;
+	}
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<CommandBuffer> cmdBuffer;
+		std::size_t                    key = 0;
+		bool                           valid = false;
+	};
+
+	CommandPool*                                 m_pCmdPool;
+	// indexed by frame slot
+	std::unordered_map<VkImageView, std::vector<Entry>> m_entries;
+	uint64_t                                     m_hits = 0;
+	uint64_t                                     m_misses = 0;
+};
\ No newline at end of file
@@ -1,14 +1,16 @@
 #include "CommandPool.h"
 #include <stdexcept>
 #include "CommandBuffer.h"
+#include "DeletionQueue.h"
 
-CommandPool::CommandPool(VkDevice device, uint32_t queueFamilyIndex):m_device(device)
+CommandPool::CommandPool(VkDevice device, uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags, DeletionQueue* pDeletionQueue)
+	:m_device(device), m_pDeletionQueue(pDeletionQueue)
 {
 	VkCommandPoolCreateInfo commandPoolCreateInfo{};
 	commandPoolCreateInfo.pNext = nullptr;
 	commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
 	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	commandPoolCreateInfo.flags = flags;
 
 	if (vkCreateCommandPool(m_device, &commandPoolCreateInfo, nullptr, &m_vkCommandPool) != VK_SUCCESS)
 	{
@@ -21,7 +23,17 @@ std::shared_ptr<CommandBuffer> CommandPool::allocate(VkCommandBufferLevel level)
 	return std::make_shared<CommandBuffer>(this, level);
 }
 
+void CommandPool::reset()
+{
+	vkResetCommandPool(m_device, m_vkCommandPool, 0);
+}
+
 CommandPool::~CommandPool()
 {
+	if (m_pDeletionQueue)
+	{
+		m_pDeletionQueue->retire(m_vkCommandPool, vkDestroyCommandPool);
+		return;
+	}
 	vkDestroyCommandPool(m_device, m_vkCommandPool, nullptr);
 }
\ No newline at end of file
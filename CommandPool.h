@@ -2,10 +2,14 @@
 #include "vulkan/vulkan.h"
 #include <memory>
 class CommandBuffer;
+class DeletionQueue;
 class CommandPool
 {
 public:
-	CommandPool(VkDevice device, uint32_t queueFamilyIndex);
+	// given a deletion queue the pool is retired to it when destroyed, so it may be
+	// released while command buffers allocated from it are still executing
+	CommandPool(VkDevice device, uint32_t queueFamilyIndex, VkCommandPoolCreateFlags flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		DeletionQueue* pDeletionQueue = nullptr);
 	~CommandPool();
 public:
 	operator VkCommandPool()const
@@ -19,7 +23,11 @@ public:
 	}
 
 	std::shared_ptr<CommandBuffer> allocate(VkCommandBufferLevel level= VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+	// recycles every command buffer allocated from this pool at once
+	void reset();
 private:
 	VkCommandPool m_vkCommandPool;
 	VkDevice      m_device;
+	DeletionQueue* m_pDeletionQueue;
 };
\ No newline at end of file
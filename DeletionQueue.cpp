@@ -0,0 +1,61 @@
+#include "DeletionQueue.h"
+#include <algorithm>
+
+DeletionQueue::DeletionQueue(VkDevice device, FrameScheduler& scheduler)
+	:m_device(device), m_scheduler(scheduler)
+{
+}
+
+DeletionQueue::~DeletionQueue()
+{
+	flush();
+}
+
+void DeletionQueue::retire(std::function<void()> destroy)
+{
+	Entry entry;
+	entry.values.resize(m_scheduler.getQueueCount());
+	for (FrameScheduler::QueueId queue = 0; queue < entry.values.size(); ++queue)
+	{
+		entry.values[queue] = m_scheduler.getSubmittedValue(queue);
+	}
+	entry.destroy = std::move(destroy);
+	m_entries.push_back(std::move(entry));
+
+	++m_stats.retiredCnt;
+	m_stats.peakPendingCnt = std::max<uint64_t>(m_stats.peakPendingCnt, m_entries.size());
+}
+
+bool DeletionQueue::isComplete(const Entry& entry)
+{
+	for (FrameScheduler::QueueId queue = 0; queue < entry.values.size(); ++queue)
+	{
+		if (!m_scheduler.isComplete(queue, entry.values[queue]))
+			return false;
+	}
+	return true;
+}
+
+void DeletionQueue::collect()
+{
+	while (!m_entries.empty() && isComplete(m_entries.front()))
+	{
+		m_entries.front().destroy();
+		m_entries.pop_front();
+		++m_stats.destroyedCnt;
+	}
+}
+
+void DeletionQueue::flush()
+{
+	if (m_entries.empty())
+		return;
+
+	m_scheduler.waitIdle();
+	for (auto& entry : m_entries)
+	{
+		entry.destroy();
+		++m_stats.destroyedCnt;
+	}
+	m_entries.clear();
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "FrameScheduler.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+// Destroys Vulkan objects once the GPU is done with them instead of idling the
+// device. An object retired now may still be referenced by anything submitted
+// so far, so retire() records the submitted value of every queue of the
+// scheduler and collect() destroys the entries whose values all queues have
+// completed. Entries are recorded in submission order, so collect() stops at
+// the first one still in use. Replacing a pipeline, framebuffer or swapchain at
+// runtime therefore only waits for the frames that used it.
+class DeletionQueue
+{
+public:
+	struct Stats final
+	{
+		uint64_t retiredCnt = 0;
+		uint64_t destroyedCnt = 0;
+		uint64_t peakPendingCnt = 0;
+	};
+
+	DeletionQueue(VkDevice device, FrameScheduler& scheduler);
+	// waits for every queue and destroys what is still pending
+	~DeletionQueue();
+
+	// e.g. retire(pipeline, vkDestroyPipeline)
+	template<typename Handle>
+	void retire(Handle handle, void (VKAPI_PTR* pfnDestroy)(VkDevice, Handle, const VkAllocationCallbacks*))
+	{
+		if (handle == VK_NULL_HANDLE)
+			return;
+
+		VkDevice device = m_device;
+		retire([device, handle, pfnDestroy]() { pfnDestroy(device, handle, nullptr); });
+	}
+
+	// for anything that isn't a single handle, like memory owned by the allocator
+	void retire(std::function<void()> destroy);
+
+	// destroys the entries the GPU has finished with, doesn't block
+	void collect();
+
+	// blocks until every queue is idle and destroys everything
+	void flush();
+
+	size_t getPendingCount()const
+	{
+		return m_entries.size();
+	}
+
+	const Stats& getStats()const
+	{
+		return m_stats;
+	}
+
+private:
+	struct Entry
+	{
+		// submitted value of each queue when the entry was retired
+		std::vector<uint64_t> values;
+		std::function<void()> destroy;
+	};
+
+	bool isComplete(const Entry& entry);
+
+private:
+	VkDevice                  m_device;
+	FrameScheduler&           m_scheduler;
+	std::deque<Entry>         m_entries;
+	Stats                     m_stats;
+};
\ No newline at end of file
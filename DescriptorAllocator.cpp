@@ -0,0 +1,224 @@
+#include "DescriptorAllocator.h"
+#include "Tracer.h"
+#include "HashCombine.h"
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+
+// descriptors per set a pool is sized for, generous for images as materials bind several
+static const std::pair<VkDescriptorType, float> s_poolRatios[] = {
+	{ VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f },
+	{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+	{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 4.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 0.5f },
+};
+
+std::size_t DescriptorAllocator::PersistentKeyHasher::operator()(const PersistentKey& key)const
+{
+	std::size_t seed = std::hash<VkDescriptorSetLayout>()(key.layout);
+	for (auto& write : key.writes)
+	{
+		hashCombine(seed, write.binding);
+		hashCombine(seed, write.arrayElement);
+		hashCombine(seed, (uint32_t)write.type);
+		hashCombine(seed, write.buffer);
+		hashCombine(seed, write.offset);
+		hashCombine(seed, write.range);
+		hashCombine(seed, write.imageView);
+		hashCombine(seed, write.sampler);
+		hashCombine(seed, (uint32_t)write.imageLayout);
+	}
+	return seed;
+}
+
+DescriptorAllocator::DescriptorAllocator(VkDevice device, uint32_t framesInFlight) :m_vkDevice(device)
+{
+	m_framePools.resize(framesInFlight);
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+	for (auto& chain : m_framePools)
+	{
+		for (auto& pool : chain.pools)
+		{
+			vkDestroyDescriptorPool(m_vkDevice, pool, nullptr);
+		}
+	}
+	for (auto& pool : m_persistentPools.pools)
+	{
+		vkDestroyDescriptorPool(m_vkDevice, pool, nullptr);
+	}
+}
+
+void DescriptorAllocator::beginFrame(uint32_t frameIndex)
+{
+	TRACE_ZONE("ResetDescriptorPools");
+	m_frameIndex = frameIndex;
+	auto& chain = m_framePools[frameIndex];
+	auto resetStart = std::chrono::steady_clock::now();
+	// pools past current were not touched since their last reset
+	std::size_t usedCnt = std::min(chain.current + 1, chain.pools.size());
+	for (std::size_t i = 0; i < usedCnt; ++i)
+	{
+		vkResetDescriptorPool(m_vkDevice, chain.pools[i], 0);
+	}
+	chain.current = 0;
+	chain.currentSets = 0;
+	m_stats.resetMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - resetStart).count();
+	++m_stats.resetCnt;
+}
+
+void DescriptorAllocator::allocateTransient(VkDescriptorSetLayout layout, uint32_t setCnt, VkDescriptorSet* pSets)
+{
+	auto allocateStart = std::chrono::steady_clock::now();
+	allocate(m_framePools[m_frameIndex], layout, setCnt, pSets);
+	m_stats.transientMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - allocateStart).count();
+	m_stats.transientSets += setCnt;
+}
+
+VkDescriptorSet DescriptorAllocator::getPersistent(VkDescriptorSetLayout layout, const std::vector<DescriptorWrite>& writes)
+{
+	PersistentKey key{ layout, writes };
+	auto it = m_persistentSets.find(key);
+	if (it != m_persistentSets.end())
+	{
+		++m_stats.persistentHits;
+		return it->second;
+	}
+
+	++m_stats.persistentMisses;
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	allocate(m_persistentPools, layout, 1, &set);
+	write(m_vkDevice, set, writes);
+	m_persistentSets.emplace(std::move(key), set);
+	return set;
+}
+
+void DescriptorAllocator::write(VkDevice device, VkDescriptorSet set, const std::vector<DescriptorWrite>& writes)
+{
+	// reserved up front, the write structs point into them
+	std::vector<VkDescriptorBufferInfo> bufferInfos;
+	std::vector<VkDescriptorImageInfo> imageInfos;
+	bufferInfos.reserve(writes.size());
+	imageInfos.reserve(writes.size());
+
+	std::vector<VkWriteDescriptorSet> descriptorWrites(writes.size());
+	for (std::size_t i = 0; i < writes.size(); ++i)
+	{
+		auto& write = writes[i];
+		auto& descriptorWrite = descriptorWrites[i];
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.pNext = nullptr;
+		descriptorWrite.dstSet = set;
+		descriptorWrite.dstBinding = write.binding;
+		descriptorWrite.dstArrayElement = write.arrayElement;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.descriptorType = write.type;
+		if (write.buffer != VK_NULL_HANDLE)
+		{
+			bufferInfos.push_back({ write.buffer, write.offset, write.range });
+			descriptorWrite.pBufferInfo = &bufferInfos.back();
+		}
+		else
+		{
+			imageInfos.push_back({ write.sampler, write.imageView, write.imageLayout });
+			descriptorWrite.pImageInfo = &imageInfos.back();
+		}
+	}
+	vkUpdateDescriptorSets(device, (uint32_t)descriptorWrites.size(), descriptorWrites.data(), 0, nullptr);
+}
+
+void DescriptorAllocator::allocate(PoolChain& chain, VkDescriptorSetLayout layout, uint32_t setCnt, VkDescriptorSet* pSets)
+{
+	uint32_t allocatedCnt = 0;
+	// lowered when a pool runs out of descriptors before it runs out of sets
+	uint32_t batchLimit = UINT32_MAX;
+	while (allocatedCnt < setCnt)
+	{
+		if (chain.current == chain.pools.size())
+		{
+			uint32_t maxSets = chain.maxSets.empty() ? FirstPoolSets : std::min(chain.maxSets.back() * 2, MaxPoolSets);
+			chain.pools.push_back(createPool(maxSets));
+			chain.maxSets.push_back(maxSets);
+			chain.currentSets = 0;
+		}
+
+		uint32_t batchCnt = std::min({ setCnt - allocatedCnt, chain.maxSets[chain.current] - chain.currentSets, batchLimit });
+		if (batchCnt == 0)
+		{
+			++chain.current;
+			chain.currentSets = 0;
+			batchLimit = UINT32_MAX;
+			continue;
+		}
+
+		m_layoutScratch.assign(batchCnt, layout);
+		VkDescriptorSetAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.pNext = nullptr;
+		allocateInfo.descriptorPool = chain.pools[chain.current];
+		allocateInfo.descriptorSetCount = batchCnt;
+		allocateInfo.pSetLayouts = m_layoutScratch.data();
+
+		VkResult result = vkAllocateDescriptorSets(m_vkDevice, &allocateInfo, pSets + allocatedCnt);
+		if (result == VK_SUCCESS)
+		{
+			allocatedCnt += batchCnt;
+			chain.currentSets += batchCnt;
+			continue;
+		}
+		if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+		{
+			throw std::runtime_error("failed to allocate descriptor sets!");
+		}
+
+		if (batchCnt > 1)
+		{
+			batchLimit = batchCnt / 2;
+		}
+		else if (chain.currentSets == 0)
+		{
+			throw std::runtime_error("failed to allocate descriptor set, its layout needs more descriptors than a pool holds!");
+		}
+		else
+		{
+			++chain.current;
+			chain.currentSets = 0;
+			batchLimit = UINT32_MAX;
+		}
+	}
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t maxSets)
+{
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (auto& ratio : s_poolRatios)
+	{
+		poolSizes.push_back({ ratio.first, std::max(1u, (uint32_t)(ratio.second * maxSets)) });
+	}
+
+	VkDescriptorPoolCreateInfo poolCreateInfo{};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.pNext = nullptr;
+	// sets are never freed one by one, pools without the free flag can use a plain linear allocator
+	poolCreateInfo.flags = 0;
+	poolCreateInfo.maxSets = maxSets;
+	poolCreateInfo.poolSizeCount = (uint32_t)poolSizes.size();
+	poolCreateInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(m_vkDevice, &poolCreateInfo, nullptr, &pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor pool!");
+	}
+	++m_stats.poolCnt;
+	return pool;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+
+// one descriptor written into a set, either a buffer or an image range
+struct DescriptorWrite final
+{
+	uint32_t         binding = 0;
+	uint32_t         arrayElement = 0;
+	VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	VkBuffer         buffer = VK_NULL_HANDLE;
+	VkDeviceSize     offset = 0;
+	VkDeviceSize     range = 0;
+	VkImageView      imageView = VK_NULL_HANDLE;
+	VkSampler        sampler = VK_NULL_HANDLE;
+	VkImageLayout    imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	static DescriptorWrite makeBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+	{
+		DescriptorWrite write;
+		write.binding = binding;
+		write.type = type;
+		write.buffer = buffer;
+		write.offset = offset;
+		write.range = range;
+		return write;
+	}
+
+	static DescriptorWrite makeImage(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout)
+	{
+		DescriptorWrite write;
+		write.binding = binding;
+		write.type = type;
+		write.imageView = imageView;
+		write.sampler = sampler;
+		write.imageLayout = imageLayout;
+		return write;
+	}
+
+	bool operator==(const DescriptorWrite& other)const = default;
+};
+
+// Hands out descriptor sets from pools that are created on demand, each one
+// twice the size of the last. Transient sets come from pools owned by a frame
+// in flight and are released all at once when beginFrame() resets those pools,
+// so there is no per set free. Persistent sets are cached by layout and
+// content, asking for the same writes again returns the set made the first
+// time. Not thread safe.
+class DescriptorAllocator
+{
+public:
+	struct Stats final
+	{
+		uint64_t transientSets = 0;
+		double   transientMs = 0.0;
+		uint64_t persistentHits = 0;
+		uint64_t persistentMisses = 0;
+		uint32_t poolCnt = 0;
+		uint64_t resetCnt = 0;
+		double   resetMs = 0.0;
+	};
+
+	DescriptorAllocator(VkDevice device, uint32_t framesInFlight);
+	~DescriptorAllocator();
+
+	// the last submission of frameIndex must have finished, its transient sets are recycled
+	void beginFrame(uint32_t frameIndex);
+
+	// valid until the frame slot comes around again, the caller writes them
+	void allocateTransient(VkDescriptorSetLayout layout, uint32_t setCnt, VkDescriptorSet* pSets);
+
+	VkDescriptorSet allocateTransient(VkDescriptorSetLayout layout)
+	{
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		allocateTransient(layout, 1, &set);
+		return set;
+	}
+
+	// a set holding writes, shared by everyone asking for the same layout and writes.
+	// Entries are never evicted, the written resources have to outlive the allocator.
+	VkDescriptorSet getPersistent(VkDescriptorSetLayout layout, const std::vector<DescriptorWrite>& writes);
+
+	static void write(VkDevice device, VkDescriptorSet set, const std::vector<DescriptorWrite>& writes);
+
+	const Stats& getStats()const
+	{
+		return m_stats;
+	}
+
+private:
+	// pools used in order, pools before current are full
+	struct PoolChain
+	{
+		std::vector<VkDescriptorPool> pools;
+		std::vector<uint32_t>         maxSets;
+		std::size_t                   current = 0;
+		uint32_t                      currentSets = 0;
+	};
+
+	struct PersistentKey
+	{
+		VkDescriptorSetLayout        layout = VK_NULL_HANDLE;
+		std::vector<DescriptorWrite> writes;
+
+		bool operator==(const PersistentKey& other)const = default;
+	};
+
+	struct PersistentKeyHasher
+	{
+		std::size_t operator()(const PersistentKey& key)const;
+	};
+
+	void allocate(PoolChain& chain, VkDescriptorSetLayout layout, uint32_t setCnt, VkDescriptorSet* pSets);
+	VkDescriptorPool createPool(uint32_t maxSets);
+
+private:
+	static constexpr uint32_t FirstPoolSets = 256;
+	static constexpr uint32_t MaxPoolSets = 8192;
+
+	VkDevice                                                         m_vkDevice;
+	std::vector<PoolChain>                                           m_framePools;
+	uint32_t                                                         m_frameIndex = 0;
+	PoolChain                                                        m_persistentPools;
+	std::unordered_map<PersistentKey, VkDescriptorSet, PersistentKeyHasher> m_persistentSets;
+	// layouts repeated setCnt times for vkAllocateDescriptorSets, kept to avoid reallocating
+	std::vector<VkDescriptorSetLayout>                               m_layoutScratch;
+	Stats                                                            m_stats;
+};
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "HashCombine.h"
+#include <cstdint>
+#include <vector>
+#include <functional>
+
+struct DescriptorBinding final
+{
+	uint32_t           binding = 0;
+	VkDescriptorType   type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	uint32_t           count = 1;
+	VkShaderStageFlags stages = VK_SHADER_STAGE_ALL_GRAPHICS;
+
+	bool operator==(const DescriptorBinding& other)const = default;
+};
+
+// The bindings of one descriptor set, GraphicsPipeLine creates a
+// VkDescriptorSetLayout from each of these for its pipeline layout. Sets
+// allocated for one pipeline may be bound with another whose set layout is
+// described identically.
+struct DescriptorSetLayoutDesc final
+{
+	std::vector<DescriptorBinding> bindings;
+
+	DescriptorSetLayoutDesc& addBinding(uint32_t binding, VkDescriptorType type, VkShaderStageFlags stages, uint32_t count = 1)
+	{
+		bindings.push_back({ binding, type, count, stages });
+		return *this;
+	}
+
+	bool operator==(const DescriptorSetLayoutDesc& other)const = default;
+
+	std::size_t hash()const
+	{
+		std::size_t seed = bindings.size();
+		for (auto& binding : bindings)
+		{
+			hashCombine(seed, binding.binding);
+			hashCombine(seed, (uint32_t)binding.type);
+			hashCombine(seed, binding.count);
+			hashCombine(seed, (uint32_t)binding.stages);
+		}
+		return seed;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "FrameRingBuffer.h"
+#include <algorithm>
+
+FrameRingBuffer::FrameRingBuffer(Device& device, uint32_t framesInFlight, VkDeviceSize frameSize, VkBufferUsageFlags usage)
+	:m_device(device)
+{
+	auto& limits = m_device.getProperties().limits;
+	m_defaultAlignment = std::max<VkDeviceSize>({ limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment, 16 });
+	// every partition starts aligned, so offsets aligned within it stay aligned in the buffer
+	m_frameSize = (frameSize + m_defaultAlignment - 1) / m_defaultAlignment * m_defaultAlignment;
+	m_buffer = m_device.createBuffer(m_frameSize * framesInFlight, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+FrameRingBuffer::~FrameRingBuffer()
+{
+	m_device.destroyBuffer(m_buffer);
+}
+
+void FrameRingBuffer::beginFrame(uint32_t frameIndex)
+{
+	m_peakFrameBytes = std::max(m_peakFrameBytes, m_head.load(std::memory_order_relaxed));
+	m_frameIndex = frameIndex;
+	m_head.store(0, std::memory_order_relaxed);
+}
+
+FrameAllocation FrameRingBuffer::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	if (alignment == 0)
+	{
+		alignment = m_defaultAlignment;
+	}
+
+	VkDeviceSize head = m_head.load(std::memory_order_relaxed);
+	VkDeviceSize offset = 0;
+	do
+	{
+		offset = (head + alignment - 1) / alignment * alignment;
+		if (offset + size > m_frameSize)
+		{
+			m_failedCnt.fetch_add(1, std::memory_order_relaxed);
+			return FrameAllocation();
+		}
+	} while (!m_head.compare_exchange_weak(head, offset + size, std::memory_order_relaxed));
+	m_allocationCnt.fetch_add(1, std::memory_order_relaxed);
+
+	FrameAllocation allocation;
+	allocation.buffer = m_buffer.buffer;
+	allocation.offset = m_frameSize * m_frameIndex + offset;
+	allocation.size = size;
+	allocation.pData = static_cast<uint8_t*>(m_buffer.allocation.pMapped) + allocation.offset;
+	return allocation;
+}
+
+void FrameRingBuffer::flush()
+{
+	VkDeviceSize used = m_head.load(std::memory_order_relaxed);
+	if (used > 0)
+	{
+		m_device.flush(m_buffer.allocation, m_frameSize * m_frameIndex, used);
+	}
+}
+
+FrameRingBuffer::Stats FrameRingBuffer::getStats()const
+{
+	Stats stats;
+	stats.allocationCnt = m_allocationCnt.load(std::memory_order_relaxed);
+	stats.failedCnt = m_failedCnt.load(std::memory_order_relaxed);
+	stats.peakFrameBytes = std::max(m_peakFrameBytes, m_head.load(std::memory_order_relaxed));
+	return stats;
+}
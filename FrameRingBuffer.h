@@ -0,0 +1,89 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "vulkan/Device.h"
+#include <atomic>
+#include <vector>
+#include <cstring>
+
+// a sub range of FrameRingBuffer, valid until the frame slot comes around again
+struct FrameAllocation final
+{
+	VkBuffer     buffer = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void*        pData = nullptr;
+
+	explicit operator bool()const
+	{
+		return pData != nullptr;
+	}
+};
+
+// Persistently mapped host visible buffer for data written once per frame,
+// like uniforms, transforms or instance data. The buffer is split into one
+// partition per frame in flight and allocations just bump an offset into the
+// partition of the recording frame. beginFrame() rewinds a partition once the
+// frame's fence has signaled, so streaming data never allocates, maps or
+// unmaps anything. allocate() is lock free and may be called from the record
+// workers.
+class FrameRingBuffer
+{
+public:
+	struct Stats final
+	{
+		uint64_t     allocationCnt = 0;
+		// allocations that did not fit into their frame's partition
+		uint64_t     failedCnt = 0;
+		VkDeviceSize peakFrameBytes = 0;
+	};
+
+	FrameRingBuffer(Device& device, uint32_t framesInFlight, VkDeviceSize frameSize,
+		VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+	~FrameRingBuffer();
+
+	// the last submission of frameIndex must have finished, its data is overwritten from now on
+	void beginFrame(uint32_t frameIndex);
+
+	// alignment 0 uses the strictest uniform/storage offset alignment of the device.
+	// Returns an empty allocation when the frame's partition is full.
+	FrameAllocation allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+
+	template<typename T>
+	FrameAllocation push(const T& value)
+	{
+		auto allocation = allocate(sizeof(T));
+		if (allocation)
+		{
+			std::memcpy(allocation.pData, &value, sizeof(T));
+		}
+		return allocation;
+	}
+
+	// makes this frame's writes visible to the device, call before submitting it
+	void flush();
+
+	VkBuffer getBuffer()const
+	{
+		return m_buffer.buffer;
+	}
+
+	VkDeviceSize getFrameSize()const
+	{
+		return m_frameSize;
+	}
+
+	Stats getStats()const;
+
+private:
+	Device&                   m_device;
+	AllocatedBuffer           m_buffer;
+	VkDeviceSize              m_frameSize;
+	VkDeviceSize              m_defaultAlignment;
+	uint32_t                  m_frameIndex = 0;
+	// offset into the current partition
+	std::atomic<VkDeviceSize> m_head{ 0 };
+	std::atomic<uint64_t>     m_allocationCnt{ 0 };
+	std::atomic<uint64_t>     m_failedCnt{ 0 };
+	VkDeviceSize              m_peakFrameBytes = 0;
+};
\ No newline at end of file
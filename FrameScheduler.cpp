@@ -0,0 +1,305 @@
+#include "FrameScheduler.h"
+#include "Tracer.h"
+#include <stdexcept>
+#include <chrono>
+
+FrameScheduler::FrameScheduler(Device& device)
+	:m_device(device)
+{
+	m_pfnWaitSemaphores = m_device.getWaitSemaphores();
+	m_pfnGetSemaphoreCounterValue = m_device.getSemaphoreCounterValue();
+	// the sync2 submit is only used for timeline semaphores, the fence path keeps vkQueueSubmit
+	if (m_pfnWaitSemaphores)
+	{
+		m_pfnQueueSubmit2 = m_device.getQueueSubmit2();
+	}
+}
+
+FrameScheduler::~FrameScheduler()
+{
+	waitIdle();
+	for (auto& queue : m_queues)
+	{
+		vkDestroySemaphore(m_device, queue.timeline, nullptr);
+	}
+	for (auto fence : m_freeFences)
+	{
+		vkDestroyFence(m_device, fence, nullptr);
+	}
+}
+
+FrameScheduler::QueueId FrameScheduler::addQueue(VkQueue queue)
+{
+	for (QueueId i = 0; i < m_queues.size(); ++i)
+	{
+		if (m_queues[i].queue == queue)
+			return i;
+	}
+
+	Queue newQueue;
+	newQueue.queue = queue;
+	if (usesTimelineSemaphores())
+	{
+		VkSemaphoreTypeCreateInfoKHR typeCreateInfo{};
+		typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		typeCreateInfo.pNext = nullptr;
+		typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		typeCreateInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		createInfo.pNext = &typeCreateInfo;
+		createInfo.flags = 0;
+		if (vkCreateSemaphore(m_device, &createInfo, nullptr, &newQueue.timeline) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create timeline semaphore!");
+		}
+	}
+	m_queues.push_back(std::move(newQueue));
+	return (QueueId)(m_queues.size() - 1);
+}
+
+uint64_t FrameScheduler::submit(QueueId queueId, const Submit& submit)
+{
+	TRACE_ZONE("SchedulerSubmit");
+	Queue& queue = m_queues[queueId];
+	uint64_t value = queue.submittedValue + 1;
+	if (usesTimelineSemaphores())
+	{
+		submitTimeline(queue, submit, value);
+	}
+	else
+	{
+		submitFence(queue, submit, value);
+	}
+	queue.submittedValue = value;
+	++m_stats.submitCnt;
+	return value;
+}
+
+void FrameScheduler::submitTimeline(Queue& queue, const Submit& submit, uint64_t value)
+{
+	if (m_pfnQueueSubmit2)
+	{
+		// the legacy stage bits keep their values in VkPipelineStageFlags2KHR
+		m_waitInfos.clear();
+		for (uint32_t i = 0; i < submit.timelineWaitCnt; ++i)
+		{
+			auto& wait = submit.pTimelineWaits[i];
+			m_waitInfos.push_back({ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, m_queues[wait.queue].timeline, wait.value, wait.stages, 0 });
+		}
+		for (uint32_t i = 0; i < submit.semaphoreWaitCnt; ++i)
+		{
+			auto& wait = submit.pSemaphoreWaits[i];
+			m_waitInfos.push_back({ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, wait.semaphore, 0, wait.stages, 0 });
+		}
+		m_signalInfos.clear();
+		m_signalInfos.push_back({ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, queue.timeline, value, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0 });
+		for (uint32_t i = 0; i < submit.signalSemaphoreCnt; ++i)
+		{
+			m_signalInfos.push_back({ VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr, submit.pSignalSemaphores[i], 0, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0 });
+		}
+		m_cmdBufferInfos.clear();
+		for (uint32_t i = 0; i < submit.cmdBufferCnt; ++i)
+		{
+			m_cmdBufferInfos.push_back({ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO_KHR, nullptr, submit.pCmdBuffers[i], 0 });
+		}
+
+		VkSubmitInfo2KHR submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2_KHR;
+		submitInfo.pNext = nullptr;
+		submitInfo.flags = 0;
+		submitInfo.waitSemaphoreInfoCount = (uint32_t)m_waitInfos.size();
+		submitInfo.pWaitSemaphoreInfos = m_waitInfos.data();
+		submitInfo.commandBufferInfoCount = (uint32_t)m_cmdBufferInfos.size();
+		submitInfo.pCommandBufferInfos = m_cmdBufferInfos.data();
+		submitInfo.signalSemaphoreInfoCount = (uint32_t)m_signalInfos.size();
+		submitInfo.pSignalSemaphoreInfos = m_signalInfos.data();
+		if (m_pfnQueueSubmit2(queue.queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit to queue!");
+		}
+		return;
+	}
+
+	// binary semaphores ignore their entry in the value arrays
+	m_waitSemaphores.clear();
+	m_waitStages.clear();
+	m_waitValues.clear();
+	for (uint32_t i = 0; i < submit.timelineWaitCnt; ++i)
+	{
+		auto& wait = submit.pTimelineWaits[i];
+		m_waitSemaphores.push_back(m_queues[wait.queue].timeline);
+		m_waitStages.push_back(wait.stages);
+		m_waitValues.push_back(wait.value);
+	}
+	for (uint32_t i = 0; i < submit.semaphoreWaitCnt; ++i)
+	{
+		m_waitSemaphores.push_back(submit.pSemaphoreWaits[i].semaphore);
+		m_waitStages.push_back(submit.pSemaphoreWaits[i].stages);
+		m_waitValues.push_back(0);
+	}
+	m_signalSemaphores.assign(1, queue.timeline);
+	m_signalValues.assign(1, value);
+	for (uint32_t i = 0; i < submit.signalSemaphoreCnt; ++i)
+	{
+		m_signalSemaphores.push_back(submit.pSignalSemaphores[i]);
+		m_signalValues.push_back(0);
+	}
+
+	VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+	timelineInfo.pNext = nullptr;
+	timelineInfo.waitSemaphoreValueCount = (uint32_t)m_waitValues.size();
+	timelineInfo.pWaitSemaphoreValues = m_waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = (uint32_t)m_signalValues.size();
+	timelineInfo.pSignalSemaphoreValues = m_signalValues.data();
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = (uint32_t)m_waitSemaphores.size();
+	submitInfo.pWaitSemaphores = m_waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = m_waitStages.data();
+	submitInfo.commandBufferCount = submit.cmdBufferCnt;
+	submitInfo.pCommandBuffers = submit.pCmdBuffers;
+	submitInfo.signalSemaphoreCount = (uint32_t)m_signalSemaphores.size();
+	submitInfo.pSignalSemaphores = m_signalSemaphores.data();
+	if (vkQueueSubmit(queue.queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to submit to queue!");
+	}
+}
+
+void FrameScheduler::submitFence(Queue& queue, const Submit& submit, uint64_t value)
+{
+	// without a semaphore to wait on, the other queues' values are waited for here
+	for (uint32_t i = 0; i < submit.timelineWaitCnt; ++i)
+	{
+		wait(submit.pTimelineWaits[i].queue, submit.pTimelineWaits[i].value);
+	}
+
+	m_waitSemaphores.clear();
+	m_waitStages.clear();
+	for (uint32_t i = 0; i < submit.semaphoreWaitCnt; ++i)
+	{
+		m_waitSemaphores.push_back(submit.pSemaphoreWaits[i].semaphore);
+		m_waitStages.push_back(submit.pSemaphoreWaits[i].stages);
+	}
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = nullptr;
+	submitInfo.waitSemaphoreCount = (uint32_t)m_waitSemaphores.size();
+	submitInfo.pWaitSemaphores = m_waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = m_waitStages.data();
+	submitInfo.commandBufferCount = submit.cmdBufferCnt;
+	submitInfo.pCommandBuffers = submit.pCmdBuffers;
+	submitInfo.signalSemaphoreCount = submit.signalSemaphoreCnt;
+	submitInfo.pSignalSemaphores = submit.pSignalSemaphores;
+
+	VkFence fence = acquireFence();
+	if (vkQueueSubmit(queue.queue, 1, &submitInfo, fence) != VK_SUCCESS)
+	{
+		m_freeFences.push_back(fence);
+		throw std::runtime_error("failed to submit to queue!");
+	}
+	queue.pendingFences.push_back({ value, fence });
+}
+
+VkFence FrameScheduler::acquireFence()
+{
+	if (!m_freeFences.empty())
+	{
+		VkFence fence = m_freeFences.back();
+		m_freeFences.pop_back();
+		vkResetFences(m_device, 1, &fence);
+		return fence;
+	}
+
+	VkFenceCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	createInfo.pNext = nullptr;
+	createInfo.flags = 0;
+	VkFence fence = VK_NULL_HANDLE;
+	if (vkCreateFence(m_device, &createInfo, nullptr, &fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create fence!");
+	}
+	++m_fenceCnt;
+	return fence;
+}
+
+uint64_t FrameScheduler::getCompletedValue(QueueId queueId)
+{
+	Queue& queue = m_queues[queueId];
+	if (usesTimelineSemaphores())
+	{
+		uint64_t value = 0;
+		if (m_pfnGetSemaphoreCounterValue(m_device, queue.timeline, &value) == VK_SUCCESS)
+		{
+			queue.completedValue = value;
+		}
+		return queue.completedValue;
+	}
+
+	// a queue completes its submissions in order
+	while (!queue.pendingFences.empty() && vkGetFenceStatus(m_device, queue.pendingFences.front().fence) == VK_SUCCESS)
+	{
+		queue.completedValue = queue.pendingFences.front().value;
+		m_freeFences.push_back(queue.pendingFences.front().fence);
+		queue.pendingFences.pop_front();
+	}
+	return queue.completedValue;
+}
+
+void FrameScheduler::wait(QueueId queueId, uint64_t value)
+{
+	if (isComplete(queueId, value))
+		return;
+
+	TRACE_ZONE("SchedulerWait");
+	Queue& queue = m_queues[queueId];
+	if (value > queue.submittedValue)
+		throw std::runtime_error("waiting for a value that was never submitted!");
+
+	auto waitStart = std::chrono::steady_clock::now();
+	if (usesTimelineSemaphores())
+	{
+		VkSemaphoreWaitInfoKHR waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		waitInfo.pNext = nullptr;
+		waitInfo.flags = 0;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &queue.timeline;
+		waitInfo.pValues = &value;
+		m_pfnWaitSemaphores(m_device, &waitInfo, UINT64_MAX);
+		queue.completedValue = value;
+	}
+	else
+	{
+		while (queue.completedValue < value)
+		{
+			auto& pending = queue.pendingFences.front();
+			vkWaitForFences(m_device, 1, &pending.fence, VK_TRUE, UINT64_MAX);
+			queue.completedValue = pending.value;
+			m_freeFences.push_back(pending.fence);
+			queue.pendingFences.pop_front();
+		}
+	}
+	++m_stats.blockingWaitCnt;
+	m_stats.waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+}
+
+void FrameScheduler::waitIdle()
+{
+	for (QueueId i = 0; i < m_queues.size(); ++i)
+	{
+		wait(i, m_queues[i].submittedValue);
+	}
+}
+
+uint32_t FrameScheduler::getSyncObjectCount()const
+{
+	return usesTimelineSemaphores() ? (uint32_t)m_queues.size() : m_fenceCnt;
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "vulkan/Device.h"
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Submits to the device's queues and tracks their progress as one monotonically
+// increasing value per queue, the number of submissions that queue has been
+// given. Every submission signals the next value, so the CPU waits for or polls
+// a value instead of owning a fence per frame or batch, and a submission on one
+// queue can wait for a value of another to order work across queues.
+//
+// With VK_KHR_timeline_semaphore each queue is backed by a single timeline
+// semaphore, submitted through vkQueueSubmit2KHR when VK_KHR_synchronization2 is
+// enabled as well. Without it the values are emulated with a small pool of
+// recycled fences, and waits on other queues are resolved on the CPU before
+// submitting, callers only waiting for values they know are complete or about
+// to be don't notice the difference. Binary semaphores are still used for the
+// swapchain, which can't wait on or signal timeline semaphores.
+class FrameScheduler
+{
+public:
+	using QueueId = uint32_t;
+
+	// waits on the GPU until queue has completed value
+	struct TimelineWait final
+	{
+		QueueId              queue = 0;
+		uint64_t             value = 0;
+		VkPipelineStageFlags stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	};
+
+	// waits on a binary semaphore, e.g. the one vkAcquireNextImageKHR signals
+	struct SemaphoreWait final
+	{
+		VkSemaphore          semaphore = VK_NULL_HANDLE;
+		VkPipelineStageFlags stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	};
+
+	struct Submit final
+	{
+		const VkCommandBuffer* pCmdBuffers = nullptr;
+		uint32_t               cmdBufferCnt = 0;
+		const TimelineWait*    pTimelineWaits = nullptr;
+		uint32_t               timelineWaitCnt = 0;
+		const SemaphoreWait*   pSemaphoreWaits = nullptr;
+		uint32_t               semaphoreWaitCnt = 0;
+		// binary semaphores signaled besides the queue's value, e.g. for vkQueuePresentKHR
+		const VkSemaphore*     pSignalSemaphores = nullptr;
+		uint32_t               signalSemaphoreCnt = 0;
+	};
+
+	struct Stats final
+	{
+		uint64_t submitCnt = 0;
+		// CPU waits that blocked, and the time spent in them
+		uint64_t blockingWaitCnt = 0;
+		double   waitMs = 0.0;
+	};
+
+	explicit FrameScheduler(Device& device);
+	~FrameScheduler();
+
+	// queues are identified by their handle, adding the same queue again returns its id,
+	// so roles sharing a queue also share its values
+	QueueId addQueue(VkQueue queue);
+
+	uint32_t getQueueCount()const
+	{
+		return (uint32_t)m_queues.size();
+	}
+
+	// returns the value the queue signals once the submission has completed
+	uint64_t submit(QueueId queue, const Submit& submit);
+
+	// the value of the last submission to the queue, 0 before the first
+	uint64_t getSubmittedValue(QueueId queue)const
+	{
+		return m_queues[queue].submittedValue;
+	}
+
+	// every submission up to the returned value has completed, doesn't block
+	uint64_t getCompletedValue(QueueId queue);
+
+	bool isComplete(QueueId queue, uint64_t value)
+	{
+		return value <= m_queues[queue].completedValue || value <= getCompletedValue(queue);
+	}
+
+	// blocks until the queue has completed value
+	void wait(QueueId queue, uint64_t value);
+
+	// blocks until every queue has completed all of its submissions
+	void waitIdle();
+
+	bool usesTimelineSemaphores()const
+	{
+		return m_pfnWaitSemaphores != nullptr;
+	}
+
+	bool usesSynchronization2()const
+	{
+		return m_pfnQueueSubmit2 != nullptr;
+	}
+
+	// semaphores and fences owned by the scheduler
+	uint32_t getSyncObjectCount()const;
+
+	const Stats& getStats()const
+	{
+		return m_stats;
+	}
+
+private:
+	struct PendingFence
+	{
+		uint64_t value;
+		VkFence  fence;
+	};
+
+	struct Queue
+	{
+		VkQueue                  queue = VK_NULL_HANDLE;
+		VkSemaphore              timeline = VK_NULL_HANDLE;
+		uint64_t                 submittedValue = 0;
+		uint64_t                 completedValue = 0;
+		// without timeline semaphores only, oldest first
+		std::deque<PendingFence> pendingFences;
+	};
+
+	void submitTimeline(Queue& queue, const Submit& submit, uint64_t value);
+	void submitFence(Queue& queue, const Submit& submit, uint64_t value);
+	VkFence acquireFence();
+
+private:
+	Device&                             m_device;
+	std::vector<Queue>                  m_queues;
+	std::vector<VkFence>                m_freeFences;
+	uint32_t                            m_fenceCnt = 0;
+	PFN_vkQueueSubmit2KHR               m_pfnQueueSubmit2 = nullptr;
+	PFN_vkWaitSemaphoresKHR             m_pfnWaitSemaphores = nullptr;
+	PFN_vkGetSemaphoreCounterValueKHR   m_pfnGetSemaphoreCounterValue = nullptr;
+	// reused by every submit to keep it free of allocations
+	std::vector<VkSemaphore>            m_waitSemaphores;
+	std::vector<VkPipelineStageFlags>   m_waitStages;
+	std::vector<uint64_t>               m_waitValues;
+	std::vector<VkSemaphore>            m_signalSemaphores;
+	std::vector<uint64_t>               m_signalValues;
+	std::vector<VkSemaphoreSubmitInfoKHR>     m_waitInfos;
+	std::vector<VkSemaphoreSubmitInfoKHR>     m_signalInfos;
+	std::vector<VkCommandBufferSubmitInfoKHR> m_cmdBufferInfos;
+	Stats                               m_stats;
+};
\ No newline at end of file
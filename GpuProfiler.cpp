@@ -0,0 +1,214 @@
+#include "GpuProfiler.h"
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+
+GpuProfiler::GpuProfiler(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t maxScopesPerFrame)
+	:m_vkDevice(device), m_maxQueries(maxScopesPerFrame * 2)
+{
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyProperties.data());
+	m_timestampValidBits = queueFamilyProperties[queueFamilyIndex].timestampValidBits;
+	if (!isSupported())
+		return;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	m_timestampPeriod = properties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo{};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.pNext = nullptr;
+	queryPoolCreateInfo.flags = 0;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = m_maxQueries;
+	queryPoolCreateInfo.pipelineStatistics = 0;
+
+	m_frames.resize(framesInFlight);
+	for (auto& frame : m_frames)
+	{
+		if (vkCreateQueryPool(m_vkDevice, &queryPoolCreateInfo, nullptr, &frame.queryPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create timestamp query pool!");
+		}
+		frame.scopes.reserve(maxScopesPerFrame);
+	}
+	m_results.resize(m_maxQueries);
+}
+
+GpuProfiler::~GpuProfiler()
+{
+	for (auto& frame : m_frames)
+	{
+		vkDestroyQueryPool(m_vkDevice, frame.queryPool, nullptr);
+	}
+}
+
+void GpuProfiler::beginFrame(uint32_t frameIndex)
+{
+	if (!isSupported())
+		return;
+
+	m_frameIndex = frameIndex;
+	auto& frame = m_frames[frameIndex];
+	if (frame.queryCnt > 0)
+	{
+		// the fence has signaled, so this returns without waiting
+		VkResult result = vkGetQueryPoolResults(m_vkDevice, frame.queryPool, 0, frame.queryCnt, frame.queryCnt * sizeof(uint64_t),
+			m_results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result == VK_SUCCESS)
+		{
+			uint64_t mask = m_timestampValidBits >= 64 ? UINT64_MAX : (1ull << m_timestampValidBits) - 1;
+			for (auto& pending : frame.scopes)
+			{
+				uint64_t ticks = ((m_results[pending.beginQuery + 1] & mask) - (m_results[pending.beginQuery] & mask)) & mask;
+				addSample(m_scopes[pending.scope], ticks * m_timestampPeriod / 1000000.0);
+			}
+		}
+	}
+
+	frame.queryCnt = 0;
+	frame.scopes.clear();
+}
+
+void GpuProfiler::recordReset(VkCommandBuffer cmdBuffer)
+{
+	if (!isSupported())
+		return;
+
+	vkCmdResetQueryPool(cmdBuffer, m_frames[m_frameIndex].queryPool, 0, m_maxQueries);
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer cmdBuffer, const char* name)
+{
+	if (!isSupported())
+		return InvalidScope;
+
+	auto& frame = m_frames[m_frameIndex];
+	if (frame.queryCnt + 2 > m_maxQueries)
+	{
+		++m_droppedScopes;
+		return InvalidScope;
+	}
+
+	uint32_t scope = (uint32_t)frame.scopes.size();
+	frame.scopes.push_back({ findScope(name), frame.queryCnt });
+	frame.queryCnt += 2;
+	vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, frame.scopes.back().beginQuery);
+	return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer cmdBuffer, uint32_t scope)
+{
+	if (scope == InvalidScope)
+		return;
+
+	auto& frame = m_frames[m_frameIndex];
+	vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.queryPool, frame.scopes[scope].beginQuery + 1);
+}
+
+uint32_t GpuProfiler::findScope(const char* name)
+{
+	auto it = m_scopeIndices.find(name);
+	if (it != m_scopeIndices.end())
+		return it->second;
+
+	auto& scope = m_scopes.emplace_back();
+	scope.name = name;
+	scope.samples.reserve(WindowSize);
+	uint32_t index = (uint32_t)m_scopes.size() - 1;
+	m_scopeIndices.emplace(scope.name, index);
+	return index;
+}
+
+void GpuProfiler::addSample(Scope& scope, double ms)
+{
+	if (scope.samples.size() < WindowSize)
+	{
+		scope.samples.push_back(ms);
+	}
+	else
+	{
+		scope.samples[scope.nextSample] = ms;
+	}
+	scope.nextSample = (scope.nextSample + 1) % WindowSize;
+	++scope.sampleCnt;
+}
+
+std::vector<GpuProfiler::ScopeStats> GpuProfiler::getStats()const
+{
+	std::vector<ScopeStats> stats;
+	std::vector<double> sorted;
+	for (auto& scope : m_scopes)
+	{
+		if (scope.samples.empty())
+			continue;
+
+		sorted = scope.samples;
+		std::sort(sorted.begin(), sorted.end());
+
+		ScopeStats scopeStats;
+		scopeStats.name = scope.name;
+		scopeStats.sampleCnt = scope.sampleCnt;
+		scopeStats.minMs = sorted.front();
+		for (double sample : sorted)
+		{
+			scopeStats.avgMs += sample;
+		}
+		scopeStats.avgMs /= sorted.size();
+		scopeStats.p99Ms = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+		stats.push_back(std::move(scopeStats));
+	}
+	return stats;
+}
+
+void GpuProfiler::report(std::ostream& out)const
+{
+	if (!isSupported())
+	{
+		out << "gpu profiler: timestamps are not supported by the graphics queue\n";
+		return;
+	}
+
+	out << "gpu scopes (last " << WindowSize << " samples):\n";
+	for (auto& stats : getStats())
+	{
+		out << '\t' << stats.name << ": min " << stats.minMs << " ms, avg " << stats.avgMs << " ms, p99 " << stats.p99Ms
+			<< " ms (" << stats.sampleCnt << " samples)\n";
+	}
+	if (m_droppedScopes > 0)
+	{
+		out << "\t" << m_droppedScopes << " scopes dropped, the query pools are full\n";
+	}
+}
+
+void GpuProfiler::writeJson(const std::string& filePath)const
+{
+	std::ofstream file(filePath.c_str(), std::ios::trunc);
+	if (!file.is_open())
+		throw std::runtime_error("failed to open:" + filePath);
+
+	auto writeString = [&file](const std::string& value) {
+		file << '"';
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+				file << '\\';
+			file << c;
+		}
+		file << '"';
+	};
+
+	file << "{\n\t\"timestampPeriodNs\": " << m_timestampPeriod << ",\n\t\"droppedScopes\": " << m_droppedScopes << ",\n\t\"scopes\": [";
+	auto stats = getStats();
+	for (std::size_t i = 0; i < stats.size(); ++i)
+	{
+		file << (i == 0 ? "\n" : ",\n") << "\t\t{ \"name\": ";
+		writeString(stats[i].name);
+		file << ", \"samples\": " << stats[i].sampleCnt << ", \"minMs\": " << stats[i].minMs << ", \"avgMs\": " << stats[i].avgMs
+			<< ", \"p99Ms\": " << stats[i].p99Ms << " }";
+	}
+	file << "\n\t]\n}\n";
+}
\ No newline at end of file
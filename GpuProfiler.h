@@ -0,0 +1,96 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <vector>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <ostream>
+
+// Measures named scopes of the recorded command buffers with timestamp
+// queries. Every frame in flight has its own query pool, whose results are
+// read back the next time the frame slot comes around, after its fence has
+// signaled, so collecting them never stalls. Each scope keeps a rolling
+// window of samples that min/avg/p99 are computed from.
+class GpuProfiler
+{
+public:
+	struct ScopeStats final
+	{
+		std::string name;
+		uint64_t    sampleCnt = 0;
+		double      minMs = 0.0;
+		double      avgMs = 0.0;
+		double      p99Ms = 0.0;
+	};
+
+	static constexpr uint32_t InvalidScope = UINT32_MAX;
+
+	GpuProfiler(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t maxScopesPerFrame = 256);
+	~GpuProfiler();
+
+	// false when the queue family can't write timestamps, every call is then a no-op
+	bool isSupported()const
+	{
+		return m_timestampValidBits != 0;
+	}
+
+	// collects the results of the last submission of frameIndex, whose fence
+	// must have signaled, and starts recording scopes for it again
+	void beginFrame(uint32_t frameIndex);
+
+	// resets the frame's queries, has to be recorded outside of a render pass
+	// before the first scope of the frame
+	void recordReset(VkCommandBuffer cmdBuffer);
+
+	// name must outlive the profiler, scopes with the same name are aggregated
+	uint32_t beginScope(VkCommandBuffer cmdBuffer, const char* name);
+	void endScope(VkCommandBuffer cmdBuffer, uint32_t scope);
+
+	std::vector<ScopeStats> getStats()const;
+	void report(std::ostream& out)const;
+	void writeJson(const std::string& filePath)const;
+
+private:
+	struct Scope
+	{
+		std::string         name;
+		// rolling window of the latest durations in milliseconds
+		std::vector<double> samples;
+		uint32_t            nextSample = 0;
+		uint64_t            sampleCnt = 0;
+	};
+
+	struct PendingScope
+	{
+		uint32_t scope;
+		uint32_t beginQuery;
+	};
+
+	struct Frame
+	{
+		VkQueryPool               queryPool = VK_NULL_HANDLE;
+		uint32_t                  queryCnt = 0;
+		std::vector<PendingScope> scopes;
+	};
+
+	uint32_t findScope(const char* name);
+	void addSample(Scope& scope, double ms);
+
+private:
+	static constexpr uint32_t WindowSize = 512;
+
+	VkDevice                  m_vkDevice;
+	uint32_t                  m_timestampValidBits = 0;
+	double                    m_timestampPeriod = 1.0; // nanoseconds per tick
+	uint32_t                  m_maxQueries;
+
+	std::vector<Frame>        m_frames;
+	uint32_t                  m_frameIndex = 0;
+	std::vector<uint64_t>     m_results;
+
+	// deque keeps the names stable for the string_view keys
+	std::deque<Scope>         m_scopes;
+	std::unordered_map<std::string_view, uint32_t> m_scopeIndices;
+	uint64_t                  m_droppedScopes = 0;
+};
\ No newline at end of file
@@ -3,7 +3,9 @@
 #include <vector>
 #include <fstream>
 #include "Application.h"
+#include "vulkan/Device.h"
 #include <iostream>
+#include <chrono>
 
 
 static std::vector<char> readFile(const std::string& filePath)
@@ -46,10 +48,22 @@ void populatePipeLineShaderStageCreateInfo(VkPipelineShaderStageCreateInfo& shad
 	shaderStageCreateInfo.module = module;
 }
 
-GraphicsPipeLine::GraphicsPipeLine(HelloTriangleApplication* pApp, const std::string& vsPath, const std::string& fsPath) :m_pApp(pApp)
+GraphicsPipeLine::GraphicsPipeLine(HelloTriangleApplication* pApp, const PipelineStateDesc& desc) :m_pApp(pApp), m_desc(desc),
+	m_colorFormat(pApp->getSwapChainImageFormat())
 {
-	auto vsByteCode = readFile(vsPath);
-	auto fsByteCode = readFile(fsPath);
+	// the render pass and layout are cheap and needed right away by the framebuffers,
+	// the pipeline itself is built later by compile()
+	createPipelineLayout();
+	if (!m_desc.dynamicRendering)
+	{
+		createRenderPass();
+	}
+}
+
+VkPipeline GraphicsPipeLine::compile()
+{
+	auto vsByteCode = readFile(m_desc.vsPath);
+	auto fsByteCode = readFile(m_desc.fsPath);
 
 	auto vsModule = createShaderModule(m_pApp->getDevice(), vsByteCode);
 	auto fsModule = createShaderModule(m_pApp->getDevice(), fsByteCode);
@@ -60,36 +74,32 @@ GraphicsPipeLine::GraphicsPipeLine(HelloTriangleApplication* pApp, const std::st
 
 	VkPipelineShaderStageCreateInfo stages[2]{ vsStage,fsStage };
 
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+	for (auto& binding : m_desc.vertexLayout.bindings)
+	{
+		bindingDescriptions.push_back({ binding.binding, binding.stride, binding.inputRate });
+	}
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+	for (auto& attribute : m_desc.vertexLayout.attributes)
+	{
+		attributeDescriptions.push_back({ attribute.location, attribute.binding, attribute.format, attribute.offset });
+	}
+
 	VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo{};
 	vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	vertexInputStateCreateInfo.pNext = nullptr;
 	vertexInputStateCreateInfo.flags = 0;
-	vertexInputStateCreateInfo.vertexAttributeDescriptionCount = 0;
-	vertexInputStateCreateInfo.pVertexAttributeDescriptions = nullptr;
-	vertexInputStateCreateInfo.vertexBindingDescriptionCount = 0;
-	vertexInputStateCreateInfo.pVertexBindingDescriptions = nullptr;
+	vertexInputStateCreateInfo.vertexAttributeDescriptionCount = (uint32_t)attributeDescriptions.size();
+	vertexInputStateCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+	vertexInputStateCreateInfo.vertexBindingDescriptionCount = (uint32_t)bindingDescriptions.size();
+	vertexInputStateCreateInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo{};
 	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 	inputAssemblyCreateInfo.pNext = nullptr;
 	inputAssemblyCreateInfo.flags = 0;
 	inputAssemblyCreateInfo.primitiveRestartEnable = false;
-	inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-
-	auto extent = m_pApp->getViewPort();
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = extent.width;
-	viewport.height = extent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor{};
-	scissor.offset.x = 0;
-	scissor.offset.y = 0;
-	scissor.extent.width = extent.width;
-	scissor.extent.height = extent.height;
+	inputAssemblyCreateInfo.topology = m_desc.topology;
 
 	std::vector<VkDynamicState> dynamicStates{
 	VK_DYNAMIC_STATE_VIEWPORT,
@@ -114,16 +124,16 @@ GraphicsPipeLine::GraphicsPipeLine(HelloTriangleApplication* pApp, const std::st
 	rasterizationStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
 	rasterizationStateCreateInfo.rasterizerDiscardEnable = false;
 	rasterizationStateCreateInfo.pNext = nullptr;
-	rasterizationStateCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizationStateCreateInfo.polygonMode = m_desc.polygonMode;
 	rasterizationStateCreateInfo.lineWidth = 1.0f;
-	rasterizationStateCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizationStateCreateInfo.frontFace = m_desc.frontFace;
 	rasterizationStateCreateInfo.flags = 0;
 	rasterizationStateCreateInfo.depthClampEnable = false;
 	rasterizationStateCreateInfo.depthBiasSlopeFactor = 0.0f;
 	rasterizationStateCreateInfo.depthBiasEnable = false;
 	rasterizationStateCreateInfo.depthBiasConstantFactor = 0.0f;
 	rasterizationStateCreateInfo.depthBiasClamp = 0.0f;
-	rasterizationStateCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+	rasterizationStateCreateInfo.cullMode = m_desc.cullMode;
 
 	VkPipelineMultisampleStateCreateInfo multiSampleStateCreateInfo{};
 	multiSampleStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
@@ -133,18 +143,18 @@ GraphicsPipeLine::GraphicsPipeLine(HelloTriangleApplication* pApp, const std::st
 	multiSampleStateCreateInfo.minSampleShading = 1.0f;
 	multiSampleStateCreateInfo.pNext = nullptr;
 	multiSampleStateCreateInfo.pSampleMask = nullptr;
-	multiSampleStateCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multiSampleStateCreateInfo.rasterizationSamples = m_desc.samples;
 	multiSampleStateCreateInfo.sampleShadingEnable = false;
 
 	VkPipelineColorBlendAttachmentState colorBlendAttachmentState{};
-	colorBlendAttachmentState.blendEnable = false;
-	colorBlendAttachmentState.alphaBlendOp = VK_BLEND_OP_ADD;
-	colorBlendAttachmentState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachmentState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachmentState.colorBlendOp = VK_BLEND_OP_ADD;
-	colorBlendAttachmentState.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachmentState.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachmentState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colorBlendAttachmentState.blendEnable = m_desc.blendEnable;
+	colorBlendAttachmentState.alphaBlendOp = m_desc.alphaBlendOp;
+	colorBlendAttachmentState.srcAlphaBlendFactor = m_desc.srcAlphaBlendFactor;
+	colorBlendAttachmentState.dstAlphaBlendFactor = m_desc.dstAlphaBlendFactor;
+	colorBlendAttachmentState.colorBlendOp = m_desc.colorBlendOp;
+	colorBlendAttachmentState.srcColorBlendFactor = m_desc.srcColorBlendFactor;
+	colorBlendAttachmentState.dstColorBlendFactor = m_desc.dstColorBlendFactor;
+	colorBlendAttachmentState.colorWriteMask = m_desc.colorWriteMask;
 
 	VkPipelineColorBlendStateCreateInfo colorBlendStateCreateInfo{};
 	colorBlendStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -159,9 +169,6 @@ GraphicsPipeLine::GraphicsPipeLine(HelloTriangleApplication* pApp, const std::st
 	colorBlendStateCreateInfo.blendConstants[3] = 0.0f;
 	colorBlendStateCreateInfo.pNext = nullptr;
 
-	createPipelineLayout();
-	createRenderPass();
-
 	VkGraphicsPipelineCreateInfo pipelineCreateInfo{};
 	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 	pipelineCreateInfo.stageCount = 2;
@@ -182,31 +189,60 @@ GraphicsPipeLine::GraphicsPipeLine(HelloTriangleApplication* pApp, const std::st
 
 	pipelineCreateInfo.pNext = nullptr;
 
+	// without a render pass the attachment formats are given to the pipeline directly
+	VkPipelineRenderingCreateInfoKHR renderingCreateInfo{};
+	renderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+	renderingCreateInfo.pNext = nullptr;
+	renderingCreateInfo.viewMask = 0;
+	renderingCreateInfo.colorAttachmentCount = 1;
+	renderingCreateInfo.pColorAttachmentFormats = &m_colorFormat;
+	renderingCreateInfo.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+	renderingCreateInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+	if (m_desc.dynamicRendering)
+	{
+		pipelineCreateInfo.pNext = &renderingCreateInfo;
+	}
+
 	// create a new pipeline by deriving from an existing pipeline
 	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
 	pipelineCreateInfo.basePipelineIndex = -1;
-	if (vkCreateGraphicsPipelines(m_pApp->getDevice(), VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_vkPipeline) != VK_SUCCESS)
+	// the pipeline cache is internally synchronized, so several workers may compile against it at once
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	auto createStart = std::chrono::steady_clock::now();
+	VkResult result = vkCreateGraphicsPipelines(m_pApp->getDevice(), m_pApp->getPipelineCache(), 1, &pipelineCreateInfo, nullptr, &pipeline);
+	m_creationTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - createStart).count();
+
+	vkDestroyShaderModule(m_pApp->getDevice(), vsModule, nullptr);
+	vkDestroyShaderModule(m_pApp->getDevice(), fsModule, nullptr);
+
+	if (result != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create graphics pipeline!");
 	}
 
-	vkDestroyShaderModule(m_pApp->getDevice(), vsModule, nullptr);
-	vkDestroyShaderModule(m_pApp->getDevice(), fsModule, nullptr);
+	m_vkPipeline.store(pipeline, std::memory_order_release);
+	return pipeline;
 }
 
 GraphicsPipeLine::~GraphicsPipeLine()
 {
-	vkDestroyPipeline(m_pApp->getDevice(), m_vkPipeline, nullptr);
-	vkDestroyRenderPass(m_pApp->getDevice(), m_vkRenderPass, nullptr);
-	vkDestroyPipelineLayout(m_pApp->getDevice(), m_vkPipelineLayout, nullptr);
+	// a pipeline replaced at runtime may still be bound by frames in flight
+	DeletionQueue& deletionQueue = m_pApp->getDeletionQueue();
+	deletionQueue.retire(m_vkPipeline.load(), vkDestroyPipeline);
+	deletionQueue.retire(m_vkRenderPass, vkDestroyRenderPass);
+	deletionQueue.retire(m_vkPipelineLayout, vkDestroyPipelineLayout);
+	for (auto& setLayout : m_vkDescriptorSetLayouts)
+	{
+		deletionQueue.retire(setLayout, vkDestroyDescriptorSetLayout);
+	}
 }
 
 void GraphicsPipeLine::createRenderPass()
 {
 	VkAttachmentDescription colorAttachment;
 	colorAttachment.flags = 0;
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.format = m_pApp->getSwapChainImageFormat();
+	colorAttachment.samples = m_desc.samples;
+	colorAttachment.format = m_colorFormat;
 
 	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
@@ -215,7 +251,7 @@ void GraphicsPipeLine::createRenderPass()
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
 	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	colorAttachment.finalLayout = m_desc.colorFinalLayout;
 
 	VkAttachmentReference attachmentRef;
 	attachmentRef.attachment = 0;
@@ -233,7 +269,8 @@ void GraphicsPipeLine::createRenderPass()
 	subpass.pPreserveAttachments = nullptr;
 	subpass.pResolveAttachments = nullptr;
 
-	VkSubpassDependency subpassDependency{};
+	VkSubpassDependency subpassDependencies[2]{};
+	VkSubpassDependency& subpassDependency = subpassDependencies[0];
 	subpassDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
 	subpassDependency.dstSubpass = 0 ;
 	subpassDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
@@ -242,12 +279,25 @@ void GraphicsPipeLine::createRenderPass()
 	subpassDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 	subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
+	// an attachment that is copied out after the pass needs its writes made visible to the transfer
+	uint32_t dependencyCount = 1;
+	if (m_desc.colorFinalLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+	{
+		VkSubpassDependency& readbackDependency = subpassDependencies[dependencyCount++];
+		readbackDependency.srcSubpass = 0;
+		readbackDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+		readbackDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		readbackDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		readbackDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		readbackDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	}
+
 	VkRenderPassCreateInfo renderPassCreateInfo;
 	renderPassCreateInfo.flags = 0;
 	renderPassCreateInfo.attachmentCount = 1;
 	renderPassCreateInfo.pAttachments = &colorAttachment;
-	renderPassCreateInfo.dependencyCount = 1;
-	renderPassCreateInfo.pDependencies = &subpassDependency;
+	renderPassCreateInfo.dependencyCount = dependencyCount;
+	renderPassCreateInfo.pDependencies = subpassDependencies;
 	renderPassCreateInfo.pNext = nullptr;
 	renderPassCreateInfo.subpassCount = 1;
 	renderPassCreateInfo.pSubpasses = &subpass;
@@ -261,14 +311,48 @@ void GraphicsPipeLine::createRenderPass()
 
 void GraphicsPipeLine::createPipelineLayout()
 {
+	for (auto& setLayoutDesc : m_desc.descriptorSetLayouts)
+	{
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		for (auto& binding : setLayoutDesc.bindings)
+		{
+			bindings.push_back({ binding.binding, binding.type, binding.count, binding.stages, nullptr });
+		}
+
+		VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo{};
+		setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		setLayoutCreateInfo.pNext = nullptr;
+		setLayoutCreateInfo.flags = 0;
+		setLayoutCreateInfo.bindingCount = (uint32_t)bindings.size();
+		setLayoutCreateInfo.pBindings = bindings.data();
+
+		VkDescriptorSetLayout setLayout;
+		if (vkCreateDescriptorSetLayout(m_pApp->getDevice(), &setLayoutCreateInfo, nullptr, &setLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create descriptor set layout!");
+		}
+		m_vkDescriptorSetLayouts.push_back(setLayout);
+	}
+
 	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo;
 	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipelineLayoutCreateInfo.flags = 0;
 	pipelineLayoutCreateInfo.pNext = nullptr;
-	pipelineLayoutCreateInfo.setLayoutCount = 0;
-	pipelineLayoutCreateInfo.pSetLayouts = nullptr;
-	pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-	pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+	pipelineLayoutCreateInfo.setLayoutCount = (uint32_t)m_vkDescriptorSetLayouts.size();
+	pipelineLayoutCreateInfo.pSetLayouts = m_vkDescriptorSetLayouts.data();
+	// PushConstants<T> only guarantees the spec minimum at compile time, the actual limit is checked here
+	uint32_t maxPushConstantsSize = m_pApp->getLogicalDevice().getProperties().limits.maxPushConstantsSize;
+	std::vector<VkPushConstantRange> pushConstantRanges;
+	for (auto& range : m_desc.pushConstantRanges)
+	{
+		if (range.offset + range.size > maxPushConstantsSize)
+		{
+			throw std::runtime_error("failed to create pipeline layout, push constant range exceeds maxPushConstantsSize!");
+		}
+		pushConstantRanges.push_back({ range.stages, range.offset, range.size });
+	}
+	pipelineLayoutCreateInfo.pushConstantRangeCount = (uint32_t)pushConstantRanges.size();
+	pipelineLayoutCreateInfo.pPushConstantRanges = pushConstantRanges.data();
 
 	if (vkCreatePipelineLayout(m_pApp->getDevice(), &pipelineLayoutCreateInfo, nullptr, &m_vkPipelineLayout) != VK_SUCCESS)
 	{
@@ -2,21 +2,56 @@
 
 #include "vulkan/vulkan.h"
 #include <string>
+#include <atomic>
+#include <vector>
+#include "PipelineStateDesc.h"
 class HelloTriangleApplication;
 class GraphicsPipeLine
 {
 public:
-	GraphicsPipeLine(HelloTriangleApplication*pApp, const std::string&vsPath,const std::string&fsPath);
+	GraphicsPipeLine(HelloTriangleApplication*pApp, const PipelineStateDesc& desc);
 	~GraphicsPipeLine();
 
+	// builds the shader modules and the pipeline object, safe to call from a worker thread as it
+	// only reads state captured by the constructor, the device and the pipeline cache
+	VkPipeline compile();
+
 	VkRenderPass getRenderPass()
 	{
 		return m_vkRenderPass;
 	}
 
-	VkPipeline getPipeline()
+	VkPipelineLayout getPipelineLayout()const
+	{
+		return m_vkPipelineLayout;
+	}
+
+	// layout of set index, as described by PipelineStateDesc::descriptorSetLayouts
+	VkDescriptorSetLayout getDescriptorSetLayout(uint32_t index)const
+	{
+		return m_vkDescriptorSetLayouts[index];
+	}
+
+	// VK_NULL_HANDLE until compile() has finished
+	VkPipeline getPipeline()const
+	{
+		return m_vkPipeline.load(std::memory_order_acquire);
+	}
+
+	bool isReady()const
+	{
+		return getPipeline() != VK_NULL_HANDLE;
+	}
+
+	const PipelineStateDesc& getDesc()const
+	{
+		return m_desc;
+	}
+
+	// milliseconds spent in vkCreateGraphicsPipelines
+	double getCreationTime()const
 	{
-		return m_vkPipeline;
+		return m_creationTime;
 	}
 
 private:
@@ -24,7 +59,13 @@ private:
 	void createPipelineLayout();
 private:
 	HelloTriangleApplication *m_pApp;
-	VkRenderPass              m_vkRenderPass;
+	// VK_NULL_HANDLE for dynamic rendering
+	VkRenderPass              m_vkRenderPass = VK_NULL_HANDLE;
 	VkPipelineLayout          m_vkPipelineLayout;
-	VkPipeline                m_vkPipeline;
+	std::vector<VkDescriptorSetLayout> m_vkDescriptorSetLayouts;
+	PipelineStateDesc         m_desc;
+	// read on the constructing thread, compile() may run on a worker
+	VkFormat                  m_colorFormat;
+	std::atomic<VkPipeline>   m_vkPipeline{ VK_NULL_HANDLE };
+	double                    m_creationTime = 0.0;
 };
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+// mixes the std::hash of value into seed, the boost hash_combine recipe used by
+// every content hash in the demo
+template<typename T>
+inline void hashCombine(std::size_t& seed, const T& value)
+{
+	seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
\ No newline at end of file
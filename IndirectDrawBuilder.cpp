@@ -0,0 +1,251 @@
+#include "IndirectDrawBuilder.h"
+#include "Mesh.h"
+#include "StagingUploader.h"
+#include "DescriptorAllocator.h"
+#include "commands/CommandStream.h"
+#include <stdexcept>
+#include <fstream>
+#include <cstring>
+
+// local_size_x of indirect.comp
+static const uint32_t s_groupSize = 64;
+
+// PrePassConstants in indirect.comp
+struct PrePassConstants
+{
+	float    viewOffsetScale[4];
+	uint32_t objectCnt;
+	uint32_t frameIndex;
+	uint32_t templateCnt;
+	uint32_t pass;
+	uint32_t compact;
+};
+
+// the storage buffers bound to indirect.comp
+static const uint32_t s_bindingCnt = 6;
+
+static std::vector<char> readShader(const std::string& filePath)
+{
+	std::ifstream file(filePath.c_str(), std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+		throw std::runtime_error("failed to open:" + filePath);
+
+	auto size = file.tellg();
+	std::vector<char> contents(size);
+	file.seekg(0);
+	file.read(contents.data(), size);
+	return contents;
+}
+
+IndirectDrawBuilder::IndirectDrawBuilder(Device& device, StagingUploader& uploader, DescriptorAllocator& descriptorAllocator, VkPipelineCache pipelineCache,
+	const std::string& shaderPath, uint32_t framesInFlight, const Mesh& mesh, const std::vector<IndirectObject>& objects)
+	:m_device(device), m_mesh(mesh), m_objectCnt((uint32_t)objects.size())
+{
+	if (objects.empty())
+	{
+		throw std::runtime_error("failed to create indirect draws, there are no objects!");
+	}
+
+	// firstInstance of the compacted draws is only honored with drawIndirectFirstInstance, and a
+	// single call only issues several draws with multiDrawIndirect
+	auto& features = m_device.getEnabledFeatures();
+	m_multiDraw = m_device.getCmdDrawIndexedIndirectCount() && features.multiDrawIndirect && features.drawIndirectFirstInstance;
+
+	// each draw owns the instance range [firstInstance, firstInstance + its object count)
+	auto& subMeshes = mesh.getSubMeshes();
+	std::vector<uint32_t> instanceCounts(subMeshes.size(), 0);
+	std::vector<IndirectObject> boundedObjects(objects);
+	for (auto& object : boundedObjects)
+	{
+		if (object.drawIndex >= subMeshes.size())
+		{
+			throw std::runtime_error("failed to create indirect draws, an object refers to a missing sub mesh!");
+		}
+		object.boundingRadius = subMeshes[object.drawIndex].boundingRadius;
+		++instanceCounts[object.drawIndex];
+	}
+	std::vector<VkDrawIndexedIndirectCommand> templates(subMeshes.size());
+	m_firstInstances.resize(subMeshes.size());
+	uint32_t firstInstance = 0;
+	for (std::size_t i = 0; i < subMeshes.size(); ++i)
+	{
+		templates[i] = { subMeshes[i].indexCount, 0, subMeshes[i].firstIndex, subMeshes[i].vertexOffset, firstInstance };
+		m_firstInstances[i] = firstInstance;
+		firstInstance += instanceCounts[i];
+	}
+
+	VkDeviceSize objectBytes = sizeof(IndirectObject) * objects.size();
+	VkDeviceSize drawBytes = sizeof(VkDrawIndexedIndirectCommand) * templates.size();
+	m_objectBuffer = m_device.createBuffer(objectBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	m_templateBuffer = m_device.createBuffer(drawBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	m_drawBuffer = m_device.createBuffer(drawBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	m_drawCountBuffer = m_device.createBuffer(sizeof(uint32_t) * (1 + subMeshes.size()),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	m_instanceBuffer = m_device.createBuffer(sizeof(InstanceData) * objects.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	m_counterBuffer = m_device.createBuffer(4 * sizeof(uint32_t) * framesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+	std::memset(m_counterBuffer.allocation.pMapped, 0, 4 * sizeof(uint32_t) * framesInFlight);
+
+	uploader.upload(m_objectBuffer.buffer, 0, boundedObjects.data(), objectBytes, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	m_uploadTicket = uploader.upload(m_templateBuffer.buffer, 0, templates.data(), drawBytes, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+	createPipeline(pipelineCache, shaderPath);
+
+	m_vkDescriptorSet = descriptorAllocator.getPersistent(m_vkDescriptorSetLayout, {
+		DescriptorWrite::makeBuffer(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_objectBuffer.buffer, 0, VK_WHOLE_SIZE),
+		DescriptorWrite::makeBuffer(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_templateBuffer.buffer, 0, VK_WHOLE_SIZE),
+		DescriptorWrite::makeBuffer(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_instanceBuffer.buffer, 0, VK_WHOLE_SIZE),
+		DescriptorWrite::makeBuffer(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_drawCountBuffer.buffer, 0, VK_WHOLE_SIZE),
+		DescriptorWrite::makeBuffer(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_counterBuffer.buffer, 0, VK_WHOLE_SIZE),
+		DescriptorWrite::makeBuffer(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_drawBuffer.buffer, 0, VK_WHOLE_SIZE) });
+}
+
+IndirectDrawBuilder::~IndirectDrawBuilder()
+{
+	vkDestroyPipeline(m_device, m_vkPipeline, nullptr);
+	vkDestroyPipelineLayout(m_device, m_vkPipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, m_vkDescriptorSetLayout, nullptr);
+	m_device.destroyBuffer(m_counterBuffer);
+	m_device.destroyBuffer(m_instanceBuffer);
+	m_device.destroyBuffer(m_drawCountBuffer);
+	m_device.destroyBuffer(m_drawBuffer);
+	m_device.destroyBuffer(m_templateBuffer);
+	m_device.destroyBuffer(m_objectBuffer);
+}
+
+void IndirectDrawBuilder::createPipeline(VkPipelineCache pipelineCache, const std::string& shaderPath)
+{
+	VkDescriptorSetLayoutBinding bindings[s_bindingCnt];
+	for (uint32_t i = 0; i < s_bindingCnt; ++i)
+	{
+		bindings[i] = { i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+	}
+
+	VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo{};
+	setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutCreateInfo.pNext = nullptr;
+	setLayoutCreateInfo.flags = 0;
+	setLayoutCreateInfo.bindingCount = s_bindingCnt;
+	setLayoutCreateInfo.pBindings = bindings;
+	if (vkCreateDescriptorSetLayout(m_device, &setLayoutCreateInfo, nullptr, &m_vkDescriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create indirect pre-pass descriptor set layout!");
+	}
+
+	VkPushConstantRange pushConstantRange{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PrePassConstants) };
+	VkPipelineLayoutCreateInfo layoutCreateInfo{};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.pNext = nullptr;
+	layoutCreateInfo.flags = 0;
+	layoutCreateInfo.setLayoutCount = 1;
+	layoutCreateInfo.pSetLayouts = &m_vkDescriptorSetLayout;
+	layoutCreateInfo.pushConstantRangeCount = 1;
+	layoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+	if (vkCreatePipelineLayout(m_device, &layoutCreateInfo, nullptr, &m_vkPipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create indirect pre-pass pipeline layout!");
+	}
+
+	auto byteCode = readShader(shaderPath);
+	VkShaderModuleCreateInfo moduleCreateInfo{};
+	moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleCreateInfo.pNext = nullptr;
+	moduleCreateInfo.flags = 0;
+	moduleCreateInfo.codeSize = byteCode.size();
+	moduleCreateInfo.pCode = (uint32_t*)byteCode.data();
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(m_device, &moduleCreateInfo, nullptr, &shaderModule) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create shader module");
+	}
+
+	VkComputePipelineCreateInfo pipelineCreateInfo{};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.pNext = nullptr;
+	pipelineCreateInfo.flags = 0;
+	pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineCreateInfo.stage.pNext = nullptr;
+	pipelineCreateInfo.stage.flags = 0;
+	pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineCreateInfo.stage.module = shaderModule;
+	pipelineCreateInfo.stage.pName = "main";
+	pipelineCreateInfo.stage.pSpecializationInfo = nullptr;
+	pipelineCreateInfo.layout = m_vkPipelineLayout;
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = -1;
+	VkResult result = vkCreateComputePipelines(m_device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &m_vkPipeline);
+	vkDestroyShaderModule(m_device, shaderModule, nullptr);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create indirect pre-pass pipeline!");
+	}
+}
+
+void IndirectDrawBuilder::beginFrame(uint32_t frameIndex)
+{
+	// zeroed again right away, the next submission of the frame slot counts from scratch
+	auto pCounters = static_cast<uint32_t*>(m_counterBuffer.allocation.pMapped) + 4 * frameIndex;
+	if (pCounters[0] + pCounters[1] > 0)
+	{
+		++m_stats.frameCnt;
+		m_stats.drawnCnt += pCounters[0];
+		m_stats.culledCnt += pCounters[1];
+	}
+	std::memset(pCounters, 0, 4 * sizeof(uint32_t));
+}
+
+void IndirectDrawBuilder::recordPrePass(VkCommandBuffer cmdBuffer, uint32_t frameIndex, const float* pViewOffsetScale)const
+{
+	vkCmdFillBuffer(cmdBuffer, m_drawCountBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.pNext = nullptr;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_vkPipeline);
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_vkPipelineLayout, 0, 1, &m_vkDescriptorSet, 0, nullptr);
+	PrePassConstants constants{};
+	std::memcpy(constants.viewOffsetScale, pViewOffsetScale, sizeof(constants.viewOffsetScale));
+	constants.objectCnt = m_objectCnt;
+	constants.frameIndex = frameIndex;
+	constants.templateCnt = getDrawCount();
+	constants.pass = 0;
+	constants.compact = m_multiDraw ? 1 : 0;
+	vkCmdPushConstants(cmdBuffer, m_vkPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PrePassConstants), &constants);
+	vkCmdDispatch(cmdBuffer, (m_objectCnt + s_groupSize - 1) / s_groupSize, 1, 1);
+
+	// the draws are written once every object has been counted
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	constants.pass = 1;
+	vkCmdPushConstants(cmdBuffer, m_vkPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PrePassConstants), &constants);
+	vkCmdDispatch(cmdBuffer, (constants.templateCnt + s_groupSize - 1) / s_groupSize, 1, 1);
+}
+
+void IndirectDrawBuilder::draw(CommandStream& stream)const
+{
+	m_mesh.bind(stream);
+	if (m_multiDraw)
+	{
+		stream.bindVertexBuffers(&m_instanceBuffer.buffer, nullptr, 1, InstanceBatcher::InstanceBinding);
+		stream.drawIndexedIndirectCount(m_device.getCmdDrawIndexedIndirectCount(), m_drawBuffer.buffer, 0,
+			m_drawCountBuffer.buffer, 0, getDrawCount());
+		return;
+	}
+
+	// the draws are in sub mesh order with firstInstance 0, draws without visible objects have no instances
+	for (uint32_t i = 0; i < getDrawCount(); ++i)
+	{
+		VkDeviceSize instanceOffset = sizeof(InstanceData) * m_firstInstances[i];
+		stream.bindVertexBuffers(&m_instanceBuffer.buffer, &instanceOffset, 1, InstanceBatcher::InstanceBinding);
+		stream.drawIndexedIndirect(m_drawBuffer.buffer, sizeof(VkDrawIndexedIndirectCommand) * i);
+	}
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "vulkan/Device.h"
+#include "InstanceBatcher.h"
+#include <string>
+#include <vector>
+class Mesh;
+class StagingUploader;
+class DescriptorAllocator;
+class CommandStream;
+
+// std430 layout of Object in indirect.comp
+struct IndirectObject final
+{
+	InstanceData instance;
+	// index of the object's sub mesh in the mesh given to IndirectDrawBuilder
+	uint32_t     drawIndex = 0;
+	// filled in by IndirectDrawBuilder from the sub mesh
+	float        boundingRadius = 0.0f;
+	uint32_t     padding[2] = {};
+};
+
+// GPU driven drawing of a static object list, each object one of the sub meshes
+// of a packed mesh. A compute pre-pass frustum culls the objects into the
+// compacted stream of visible instances, then writes one
+// VkDrawIndexedIndirectCommand per sub mesh with visible objects and their
+// count, so the CPU records a single vkCmdDrawIndexedIndirectCount no matter
+// how many objects and sub meshes there are. That needs VK_KHR_draw_indirect_count
+// and the multiDrawIndirect and drawIndirectFirstInstance features, without them
+// every sub mesh is drawn on its own with the instance stream bound at its range.
+// The object list and draw templates live in device local buffers uploaded once
+// through the staging uploader. The pre-pass counts drawn and culled objects into
+// a host visible buffer per frame in flight, read back once the frame slot comes
+// around again.
+class IndirectDrawBuilder
+{
+public:
+	struct Stats final
+	{
+		// frames whose counters have been read back
+		uint64_t frameCnt = 0;
+		uint64_t drawnCnt = 0;
+		uint64_t culledCnt = 0;
+	};
+
+	IndirectDrawBuilder(Device& device, StagingUploader& uploader, DescriptorAllocator& descriptorAllocator, VkPipelineCache pipelineCache,
+		const std::string& shaderPath, uint32_t framesInFlight, const Mesh& mesh, const std::vector<IndirectObject>& objects);
+	~IndirectDrawBuilder();
+
+	// collects the counters of the last submission of frameIndex, whose fence must have signaled
+	void beginFrame(uint32_t frameIndex);
+
+	// records the compute pass rewriting the draw commands, outside of a render pass
+	// and before the draws. The caller orders it after the previous frame's reads of
+	// the draw, draw count and instance buffers and makes its writes visible to the
+	// draws and the counters to the host. recordPrePass() and draw() must not be used before
+	// StagingUploader::isComplete() reports the upload ticket. pViewOffsetScale is
+	// the translation in xy and uniform scale in z the vertex shader applies after
+	// the instance transform, objects that end up outside of clip space are culled.
+	void recordPrePass(VkCommandBuffer cmdBuffer, uint32_t frameIndex, const float* pViewOffsetScale)const;
+
+	// binds the mesh and the instance stream at InstanceBatcher::InstanceBinding and issues the draws
+	void draw(CommandStream& stream)const;
+
+	uint64_t getUploadTicket()const
+	{
+		return m_uploadTicket;
+	}
+
+	uint32_t getObjectCount()const
+	{
+		return m_objectCnt;
+	}
+
+	// sub meshes, the most draws a frame issues
+	uint32_t getDrawCount()const
+	{
+		return (uint32_t)m_firstInstances.size();
+	}
+
+	// every draw is issued by a single vkCmdDrawIndexedIndirectCount
+	bool usesMultiDraw()const
+	{
+		return m_multiDraw;
+	}
+
+	// the buffers recordPrePass() writes, for the caller to synchronize with the draws and the host
+	VkBuffer getDrawBuffer()const
+	{
+		return m_drawBuffer.buffer;
+	}
+
+	VkBuffer getDrawCountBuffer()const
+	{
+		return m_drawCountBuffer.buffer;
+	}
+
+	VkBuffer getInstanceBuffer()const
+	{
+		return m_instanceBuffer.buffer;
+	}
+
+	VkBuffer getCounterBuffer()const
+	{
+		return m_counterBuffer.buffer;
+	}
+
+	const Stats& getStats()const
+	{
+		return m_stats;
+	}
+
+private:
+	void createPipeline(VkPipelineCache pipelineCache, const std::string& shaderPath);
+
+private:
+	Device&                  m_device;
+	const Mesh&              m_mesh;
+	uint32_t                 m_objectCnt;
+	// start of each sub mesh's range in the instance stream
+	std::vector<uint32_t>    m_firstInstances;
+	bool                     m_multiDraw = false;
+	uint64_t                 m_uploadTicket = 0;
+	AllocatedBuffer          m_objectBuffer;
+	// one draw command per sub mesh with instanceCount 0, read by the pre-pass
+	AllocatedBuffer          m_templateBuffer;
+	AllocatedBuffer          m_drawBuffer;
+	// the draw count followed by the visible instances of each sub mesh
+	AllocatedBuffer          m_drawCountBuffer;
+	AllocatedBuffer          m_instanceBuffer;
+	// drawn and culled object counts, a uvec4 per frame in flight
+	AllocatedBuffer          m_counterBuffer;
+	VkDescriptorSetLayout    m_vkDescriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout         m_vkPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline               m_vkPipeline = VK_NULL_HANDLE;
+	VkDescriptorSet          m_vkDescriptorSet = VK_NULL_HANDLE;
+	Stats                    m_stats;
+};
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "InstanceBatcher.h"
+#include "Mesh.h"
+#include "FrameRingBuffer.h"
+#include "commands/CommandStream.h"
+#include "Tracer.h"
+#include <cstring>
+#include <cstddef>
+
+InstanceBatcher::InstanceBatcher(FrameRingBuffer& frameRing)
+	:m_frameRing(frameRing)
+{
+}
+
+void InstanceBatcher::addInstanceAttributes(VertexLayout& layout, uint32_t location)
+{
+	layout.addBinding(InstanceBinding, sizeof(InstanceData), VK_VERTEX_INPUT_RATE_INSTANCE)
+		.addAttribute(location, InstanceBinding, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, offsetScale));
+}
+
+void InstanceBatcher::add(const Mesh& mesh, const InstanceData& instance)
+{
+	add(mesh, &instance, 1);
+}
+
+void InstanceBatcher::add(const Mesh& mesh, const InstanceData* pInstances, uint32_t instanceCnt)
+{
+	auto& instances = m_batches[&mesh];
+	if (instances.empty())
+	{
+		m_meshes.push_back(&mesh);
+	}
+	instances.insert(instances.end(), pInstances, pInstances + instanceCnt);
+}
+
+void InstanceBatcher::flush(CommandStream& stream)
+{
+	TRACE_ZONE("InstanceBatcher::flush");
+	for (auto pMesh : m_meshes)
+	{
+		auto& instances = m_batches[pMesh];
+		VkDeviceSize byteSize = sizeof(InstanceData) * instances.size();
+		auto allocation = m_frameRing.allocate(byteSize, sizeof(InstanceData));
+		if (!allocation)
+		{
+			m_stats.droppedCnt += instances.size();
+			instances.clear();
+			continue;
+		}
+
+		std::memcpy(allocation.pData, instances.data(), byteSize);
+		stream.bindVertexBuffers(&allocation.buffer, &allocation.offset, 1, InstanceBinding);
+		pMesh->draw(stream, (uint32_t)instances.size());
+
+		m_stats.instanceCnt += instances.size();
+		++m_stats.drawCnt;
+		instances.clear();
+	}
+	m_meshes.clear();
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "VertexLayout.h"
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+class Mesh;
+class FrameRingBuffer;
+class CommandStream;
+
+// per instance data streamed through the frame ring, matching inInstance in shader.vert
+struct InstanceData final
+{
+	// translation in xy, uniform scale in z
+	float offsetScale[4];
+};
+
+// Collects the instances drawn with the same mesh during a frame and turns
+// each mesh into a single instanced draw. flush() copies a mesh's instances
+// into the frame ring and binds that range as an instance rate vertex buffer,
+// so 100k objects cost one draw and one memcpy instead of 100k draws. Draws
+// added between two flushes share the pipeline and descriptor sets bound
+// before flush(); flush once per pipeline to batch several of them.
+class InstanceBatcher
+{
+public:
+	static constexpr uint32_t InstanceBinding = 1;
+
+	struct Stats final
+	{
+		uint64_t instanceCnt = 0;
+		uint64_t drawCnt = 0;
+		// instances dropped because the frame ring was full
+		uint64_t droppedCnt = 0;
+	};
+
+	explicit InstanceBatcher(FrameRingBuffer& frameRing);
+
+	// adds InstanceData at InstanceBinding to a mesh's vertex layout, starting at location
+	static void addInstanceAttributes(VertexLayout& layout, uint32_t location);
+
+	void add(const Mesh& mesh, const InstanceData& instance);
+	void add(const Mesh& mesh, const InstanceData* pInstances, uint32_t instanceCnt);
+
+	// records one instanced draw per mesh in the order the meshes were first added
+	void flush(CommandStream& stream);
+
+	const Stats& getStats()const
+	{
+		return m_stats;
+	}
+
+private:
+	FrameRingBuffer&                                            m_frameRing;
+	// keeps the draw order stable, so the recorded stream hashes the same every frame
+	std::vector<const Mesh*>                                    m_meshes;
+	// the vectors keep their capacity across flushes, so steady state batching never allocates
+	std::unordered_map<const Mesh*, std::vector<InstanceData>> m_batches;
+	Stats                                                       m_stats;
+};
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include "Mesh.h"
+#include "StagingUploader.h"
+#include "commands/CommandStream.h"
+#include <stdexcept>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+static float getRadius(const Mesh::Vertex& vertex)
+{
+	return std::sqrt(vertex.position[0] * vertex.position[0] + vertex.position[1] * vertex.position[1]);
+}
+
+Mesh::Mesh(Device& device, StagingUploader& uploader, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	std::vector<SubMesh> subMeshes)
+	:m_device(device), m_vertexCnt((uint32_t)vertices.size()), m_indexCnt((uint32_t)indices.size()), m_subMeshes(std::move(subMeshes))
+{
+	if (vertices.empty() || indices.empty())
+	{
+		throw std::runtime_error("failed to create mesh, it has no vertices or indices!");
+	}
+
+	for (auto& vertex : vertices)
+	{
+		m_boundingRadius = std::max(m_boundingRadius, getRadius(vertex));
+	}
+
+	if (m_subMeshes.empty())
+	{
+		m_subMeshes.push_back({ 0, m_indexCnt, 0, m_boundingRadius });
+	}
+	else
+	{
+		for (auto& subMesh : m_subMeshes)
+		{
+			if ((uint64_t)subMesh.firstIndex + subMesh.indexCount > m_indexCnt)
+			{
+				throw std::runtime_error("failed to create mesh, a sub mesh exceeds the indices!");
+			}
+			subMesh.boundingRadius = 0.0f;
+			for (uint32_t i = subMesh.firstIndex; i < subMesh.firstIndex + subMesh.indexCount; ++i)
+			{
+				subMesh.boundingRadius = std::max(subMesh.boundingRadius, getRadius(vertices[indices[i] + subMesh.vertexOffset]));
+			}
+		}
+	}
+
+	VkDeviceSize vertexBytes = sizeof(Vertex) * vertices.size();
+	m_vertexBuffer = m_device.createBuffer(vertexBytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	m_uploadTicket = uploader.upload(m_vertexBuffer.buffer, 0, vertices.data(), vertexBytes,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+
+	// index 0xffff is only special with primitive restart, which is disabled. Sub mesh
+	// indices are relative to their vertex offset, so packed meshes can stay 16 bit
+	if (*std::max_element(indices.begin(), indices.end()) <= 0xffff)
+	{
+		std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+		VkDeviceSize indexBytes = sizeof(uint16_t) * shortIndices.size();
+		m_indexType = VK_INDEX_TYPE_UINT16;
+		m_indexBuffer = m_device.createBuffer(indexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		m_uploadTicket = uploader.upload(m_indexBuffer.buffer, 0, shortIndices.data(), indexBytes,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+	}
+	else
+	{
+		VkDeviceSize indexBytes = sizeof(uint32_t) * indices.size();
+		m_indexType = VK_INDEX_TYPE_UINT32;
+		m_indexBuffer = m_device.createBuffer(indexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		m_uploadTicket = uploader.upload(m_indexBuffer.buffer, 0, indices.data(), indexBytes,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+	}
+}
+
+Mesh::~Mesh()
+{
+	m_device.destroyBuffer(m_indexBuffer);
+	m_device.destroyBuffer(m_vertexBuffer);
+}
+
+VertexLayout Mesh::getVertexLayout()
+{
+	VertexLayout layout;
+	layout.addBinding(0, sizeof(Vertex))
+		.addAttribute(0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, position))
+		.addAttribute(1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color));
+	return layout;
+}
+
+void Mesh::createTriangle(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	vertices = {
+		{{-0.5f,-0.5f},{1.0f,0.0f,0.0f}},
+		{{0.5f,-0.5f},{0.0f,1.0f,0.0f}},
+		{{0.0f,0.5f},{0.0f,0.0f,1.0f}},
+	};
+	indices = { 0,1,2 };
+}
+
+void Mesh::createGrid(uint32_t gridSize, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	uint32_t rowVertexCnt = gridSize + 1;
+	vertices.resize((std::size_t)rowVertexCnt * rowVertexCnt);
+	for (uint32_t y = 0; y < rowVertexCnt; ++y)
+	{
+		for (uint32_t x = 0; x < rowVertexCnt; ++x)
+		{
+			float u = (float)x / gridSize;
+			float v = (float)y / gridSize;
+			auto& vertex = vertices[(std::size_t)y * rowVertexCnt + x];
+			vertex.position[0] = -0.9f + 1.8f * u;
+			vertex.position[1] = -0.9f + 1.8f * v;
+			vertex.color[0] = u;
+			vertex.color[1] = v;
+			vertex.color[2] = 1.0f - u;
+		}
+	}
+
+	// two clockwise triangles per quad, matching the pipeline's front face
+	indices.resize((std::size_t)gridSize * gridSize * 6);
+	std::size_t index = 0;
+	for (uint32_t y = 0; y < gridSize; ++y)
+	{
+		for (uint32_t x = 0; x < gridSize; ++x)
+		{
+			uint32_t topLeft = y * rowVertexCnt + x;
+			uint32_t topRight = topLeft + 1;
+			uint32_t bottomLeft = topLeft + rowVertexCnt;
+			uint32_t bottomRight = bottomLeft + 1;
+			indices[index++] = topLeft;
+			indices[index++] = topRight;
+			indices[index++] = bottomRight;
+			indices[index++] = topLeft;
+			indices[index++] = bottomRight;
+			indices[index++] = bottomLeft;
+		}
+	}
+}
+
+Mesh::SubMesh Mesh::append(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+	const std::vector<Vertex>& subVertices, const std::vector<uint32_t>& subIndices)
+{
+	SubMesh subMesh;
+	subMesh.firstIndex = (uint32_t)indices.size();
+	subMesh.indexCount = (uint32_t)subIndices.size();
+	subMesh.vertexOffset = (int32_t)vertices.size();
+	vertices.insert(vertices.end(), subVertices.begin(), subVertices.end());
+	indices.insert(indices.end(), subIndices.begin(), subIndices.end());
+	return subMesh;
+}
+
+void Mesh::bind(CommandStream& stream)const
+{
+	stream.bindVertexBuffers(&m_vertexBuffer.buffer, nullptr, 1);
+	stream.bindIndexBuffer(m_indexBuffer.buffer, 0, m_indexType);
+}
+
+void Mesh::draw(CommandStream& stream, uint32_t instanceCnt, uint32_t firstInstance)const
+{
+	bind(stream);
+	for (auto& subMesh : m_subMeshes)
+	{
+		stream.drawIndexed(subMesh.indexCount, subMesh.firstIndex, subMesh.vertexOffset, instanceCnt, firstInstance);
+	}
+}
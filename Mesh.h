@@ -0,0 +1,111 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "vulkan/Device.h"
+#include "VertexLayout.h"
+#include <vector>
+class StagingUploader;
+class CommandStream;
+
+// Indexed triangle mesh in device local vertex and index buffers, filled
+// through the staging uploader, possibly on a transfer queue. Indices are stored as 16 bit whenever the
+// index values allow it, halving the index fetch bandwidth. Several meshes can be
+// packed into one as sub meshes, so they are drawn without rebinding buffers.
+class Mesh
+{
+public:
+	struct Vertex final
+	{
+		float position[2];
+		float color[3];
+	};
+
+	// index range drawn on its own, its indices are relative to vertexOffset
+	struct SubMesh final
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		int32_t  vertexOffset = 0;
+		// computed by the mesh, see getBoundingRadius()
+		float    boundingRadius = 0.0f;
+	};
+
+	// without subMeshes the mesh has a single one covering every index
+	Mesh(Device& device, StagingUploader& uploader, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+		std::vector<SubMesh> subMeshes = {});
+	~Mesh();
+
+	// the vertex input state matching Vertex, bound at binding 0
+	static VertexLayout getVertexLayout();
+
+	// the single colored triangle the demo always drew
+	static void createTriangle(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	// gridSize x gridSize quads covering most of the viewport, 2 * gridSize^2 triangles
+	static void createGrid(uint32_t gridSize, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+	// appends the geometry of another mesh to vertices and indices and returns its sub mesh
+	static SubMesh append(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+		const std::vector<Vertex>& subVertices, const std::vector<uint32_t>& subIndices);
+
+	// binds the vertex buffer at binding 0 and the index buffer
+	void bind(CommandStream& stream)const;
+
+	// binds the buffers and draws every sub mesh
+	void draw(CommandStream& stream, uint32_t instanceCnt = 1, uint32_t firstInstance = 0)const;
+
+	VkBuffer getVertexBuffer()const
+	{
+		return m_vertexBuffer.buffer;
+	}
+
+	VkBuffer getIndexBuffer()const
+	{
+		return m_indexBuffer.buffer;
+	}
+
+	VkIndexType getIndexType()const
+	{
+		return m_indexType;
+	}
+
+	uint32_t getVertexCount()const
+	{
+		return m_vertexCnt;
+	}
+
+	uint32_t getIndexCount()const
+	{
+		return m_indexCnt;
+	}
+
+	// pass to StagingUploader::isComplete(), the buffers can't be drawn from before
+	uint64_t getUploadTicket()const
+	{
+		return m_uploadTicket;
+	}
+
+	// radius of the circle around the origin of the vertex positions enclosing the mesh
+	float getBoundingRadius()const
+	{
+		return m_boundingRadius;
+	}
+
+	const std::vector<SubMesh>& getSubMeshes()const
+	{
+		return m_subMeshes;
+	}
+
+	VkDeviceSize getByteSize()const
+	{
+		return m_vertexBuffer.allocation.size + m_indexBuffer.allocation.size;
+	}
+
+private:
+	Device&         m_device;
+	AllocatedBuffer m_vertexBuffer;
+	AllocatedBuffer m_indexBuffer;
+	VkIndexType     m_indexType = VK_INDEX_TYPE_UINT32;
+	uint32_t        m_vertexCnt = 0;
+	uint32_t        m_indexCnt = 0;
+	float           m_boundingRadius = 0.0f;
+	std::vector<SubMesh> m_subMeshes;
+	uint64_t        m_uploadTicket = 0;
+};
\ No newline at end of file
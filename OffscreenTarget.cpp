@@ -0,0 +1,120 @@
+#include "OffscreenTarget.h"
+#include <stdexcept>
+#include <fstream>
+
+OffscreenTarget::OffscreenTarget(Device& device, VkExtent2D extent, VkFormat format, uint32_t imageCount)
+	:m_device(device), m_extent(extent), m_format(format)
+{
+	m_images.resize(imageCount);
+	m_vkImageViews.resize(imageCount);
+	for (uint32_t i = 0; i < imageCount; ++i)
+	{
+		createImage(m_images[i]);
+		createReadbackBuffer(m_images[i]);
+
+		VkImageViewCreateInfo imageViewCreateInfo{};
+		imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		imageViewCreateInfo.image = m_images[i].image.image;
+		imageViewCreateInfo.pNext = nullptr;
+		imageViewCreateInfo.format = m_format;
+		imageViewCreateInfo.components = { VK_COMPONENT_SWIZZLE_R ,VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B,VK_COMPONENT_SWIZZLE_A };
+		imageViewCreateInfo.flags = 0;
+		imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+		imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+		imageViewCreateInfo.subresourceRange.layerCount = 1;
+		imageViewCreateInfo.subresourceRange.levelCount = 1;
+
+		if (vkCreateImageView(m_device, &imageViewCreateInfo, nullptr, &m_vkImageViews[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create offscreen image view!");
+		}
+	}
+}
+
+OffscreenTarget::~OffscreenTarget()
+{
+	for (auto& imageView : m_vkImageViews)
+	{
+		vkDestroyImageView(m_device, imageView, nullptr);
+	}
+
+	for (auto& image : m_images)
+	{
+		m_device.destroyBuffer(image.readback);
+		m_device.destroyImage(image.image);
+	}
+}
+
+void OffscreenTarget::createImage(Image& image)
+{
+	VkImageCreateInfo imageCreateInfo{};
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.pNext = nullptr;
+	imageCreateInfo.flags = 0;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = m_format;
+	imageCreateInfo.extent = { m_extent.width, m_extent.height, 1 };
+	imageCreateInfo.mipLevels = 1;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.queueFamilyIndexCount = 0;
+	imageCreateInfo.pQueueFamilyIndices = nullptr;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	// render targets are large and long lived, they get memory of their own
+	image.image = m_device.createImage(imageCreateInfo, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+}
+
+void OffscreenTarget::createReadbackBuffer(Image& image)
+{
+	// tightly packed rows of 4 byte texels, cached memory makes the CPU reads much faster where it exists
+	VkDeviceSize size = (VkDeviceSize)m_extent.width * m_extent.height * 4;
+	image.readback = m_device.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+}
+
+void OffscreenTarget::recordReadback(VkCommandBuffer cmdBuffer, uint32_t imageIndex)
+{
+	auto& image = m_images[imageIndex];
+
+	VkBufferImageCopy region{};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0,0,0 };
+	region.imageExtent = { m_extent.width, m_extent.height, 1 };
+	vkCmdCopyImageToBuffer(cmdBuffer, image.image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.readback.buffer, 1, &region);
+}
+
+void OffscreenTarget::writePPM(uint32_t imageIndex, const std::string& filePath)const
+{
+	std::ofstream file(filePath.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		throw std::runtime_error("failed to open:" + filePath);
+
+	file << "P6\n" << m_extent.width << ' ' << m_extent.height << "\n255\n";
+
+	// PPM has no alpha channel and expects RGB order
+	bool bgr = m_format == VK_FORMAT_B8G8R8A8_UNORM || m_format == VK_FORMAT_B8G8R8A8_SRGB;
+	const uint8_t* pTexel = static_cast<const uint8_t*>(m_images[imageIndex].readback.allocation.pMapped);
+	std::vector<char> row(m_extent.width * 3);
+	for (uint32_t y = 0; y < m_extent.height; ++y)
+	{
+		for (uint32_t x = 0; x < m_extent.width; ++x, pTexel += 4)
+		{
+			row[x * 3 + 0] = (char)pTexel[bgr ? 2 : 0];
+			row[x * 3 + 1] = (char)pTexel[1];
+			row[x * 3 + 2] = (char)pTexel[bgr ? 0 : 2];
+		}
+		file.write(row.data(), row.size());
+	}
+}
\ No newline at end of file
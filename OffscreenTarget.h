@@ -0,0 +1,67 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "vulkan/Device.h"
+#include <vector>
+#include <string>
+
+// Stands in for the swapchain when running without a window: a set of
+// device-local color images the frames render into, each with a host-visible
+// buffer its contents are copied to so frames can be inspected or saved.
+class OffscreenTarget final
+{
+public:
+	OffscreenTarget(Device& device, VkExtent2D extent, VkFormat format, uint32_t imageCount);
+	~OffscreenTarget();
+
+	VkFormat getFormat()const
+	{
+		return m_format;
+	}
+
+	VkExtent2D getExtent()const
+	{
+		return m_extent;
+	}
+
+	std::vector<VkImageView>& getImageViews()
+	{
+		return m_vkImageViews;
+	}
+
+	VkImage getImage(uint32_t imageIndex)const
+	{
+		return m_images[imageIndex].image.image;
+	}
+
+	VkBuffer getReadbackBuffer(uint32_t imageIndex)const
+	{
+		return m_images[imageIndex].readback.buffer;
+	}
+
+	// copies the image into its readback buffer. The image has to be in
+	// VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, and the caller makes the copy
+	// visible to the host before writePPM() reads it
+	void recordReadback(VkCommandBuffer cmdBuffer, uint32_t imageIndex);
+
+	// writes the last readback of imageIndex as a binary PPM, the submission
+	// that recorded it must have finished
+	void writePPM(uint32_t imageIndex, const std::string& filePath)const;
+
+private:
+	struct Image
+	{
+		AllocatedImage  image;
+		// persistently mapped through the allocator
+		AllocatedBuffer readback;
+	};
+
+	void createImage(Image& image);
+	void createReadbackBuffer(Image& image);
+
+private:
+	Device&                    m_device;
+	VkExtent2D                 m_extent;
+	VkFormat                   m_format;
+	std::vector<Image>         m_images;
+	std::vector<VkImageView>   m_vkImageViews;
+};
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "ParallelCommandRecorder.h"
+#include "CommandPool.h"
+#include "CommandBuffer.h"
+#include "commands/CommandStream.h"
+#include "Tracer.h"
+#include <stdexcept>
+#include <algorithm>
+
+ParallelCommandRecorder::ParallelCommandRecorder(VkDevice device, uint32_t queueFamilyIndex, uint32_t threadCnt, uint32_t framesInFlight)
+{
+	threadCnt = std::max(threadCnt, 1u);
+	for (uint32_t i = 0; i < threadCnt; ++i)
+	{
+		auto pWorker = std::make_unique<Worker>();
+		for (uint32_t frame = 0; frame < framesInFlight; ++frame)
+		{
+			// buffers are only ever recycled together by resetting the whole pool
+			pWorker->cmdPools.push_back(std::make_unique<CommandPool>(device, queueFamilyIndex, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT));
+			pWorker->cmdBuffers.push_back(pWorker->cmdPools.back()->allocate(VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+		}
+		m_workers.push_back(std::move(pWorker));
+	}
+	// sized for every worker up front, so record() doesn't allocate
+	m_firstDraws.resize(threadCnt);
+	m_snapshots.resize(threadCnt);
+	m_secondaries.resize(threadCnt);
+
+	for (uint32_t i = 0; i < threadCnt; ++i)
+	{
+		m_workers[i]->thread = std::thread(&ParallelCommandRecorder::workerLoop, this, i);
+	}
+}
+
+ParallelCommandRecorder::~ParallelCommandRecorder()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_workAvailable.notify_all();
+
+	for (auto& pWorker : m_workers)
+	{
+		pWorker->thread.join();
+		pWorker->cmdBuffers.clear();
+		pWorker->cmdPools.clear();
+	}
+}
+
+void ParallelCommandRecorder::beginFrame(uint32_t frameIndex)
+{
+	m_frameIndex = frameIndex;
+	for (auto& pWorker : m_workers)
+	{
+		pWorker->cmdPools[frameIndex]->reset();
+	}
+}
+
+void ParallelCommandRecorder::record(CommandBuffer& primary, const CommandStream& stream, const VkCommandBufferInheritanceInfo& inheritanceInfo)
+{
+	uint32_t drawCnt = stream.getDrawCount();
+	uint32_t workerCnt = std::clamp((drawCnt + MinDrawsPerWorker - 1) / MinDrawsPerWorker, 1u, (uint32_t)m_workers.size());
+	uint32_t drawsPerWorker = drawCnt / workerCnt;
+	uint32_t remainder = drawCnt % workerCnt;
+
+	uint32_t firstDraw = 0;
+	for (uint32_t i = 0; i < workerCnt; ++i)
+	{
+		auto& worker = *m_workers[i];
+		m_firstDraws[i] = firstDraw;
+		worker.drawCnt = drawsPerWorker + (i < remainder ? 1 : 0);
+		firstDraw += worker.drawCnt;
+	}
+	stream.takeSnapshots(m_firstDraws.data(), workerCnt, m_snapshots.data());
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_pStream = &stream;
+		m_pInheritanceInfo = &inheritanceInfo;
+		m_activeWorkers = workerCnt;
+		m_pendingWorkers = workerCnt;
+		m_error = nullptr;
+		++m_generation;
+		m_workAvailable.notify_all();
+		m_workDone.wait(lock, [this] { return m_pendingWorkers == 0; });
+		m_pStream = nullptr;
+		m_pInheritanceInfo = nullptr;
+	}
+
+	if (m_error)
+	{
+		std::rethrow_exception(m_error);
+	}
+
+	// secondaries keep the order of the draws they were given
+	for (uint32_t i = 0; i < workerCnt; ++i)
+	{
+		m_secondaries[i] = *m_workers[i]->cmdBuffers[m_frameIndex];
+	}
+	vkCmdExecuteCommands(primary, workerCnt, m_secondaries.data());
+}
+
+void ParallelCommandRecorder::workerLoop(uint32_t workerIndex)
+{
+	TRACE_THREAD_NAME("record worker");
+	uint64_t seenGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workAvailable.wait(lock, [&] { return m_quit || (m_generation != seenGeneration && workerIndex < m_activeWorkers); });
+			if (m_quit)
+				return;
+			seenGeneration = m_generation;
+		}
+
+		std::exception_ptr error;
+		try
+		{
+			recordSecondary(workerIndex);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (error && !m_error)
+			{
+				m_error = error;
+			}
+			if (--m_pendingWorkers == 0)
+			{
+				m_workDone.notify_one();
+			}
+		}
+	}
+}
+
+void ParallelCommandRecorder::recordSecondary(uint32_t workerIndex)
+{
+	TRACE_ZONE("RecordSecondary");
+	auto& worker = *m_workers[workerIndex];
+	auto& cmdBuffer = *worker.cmdBuffers[m_frameIndex];
+
+	VkCommandBufferBeginInfo cmdBufferBeginInfo{};
+	cmdBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	cmdBufferBeginInfo.pNext = nullptr;
+	cmdBufferBeginInfo.pInheritanceInfo = m_pInheritanceInfo;
+	cmdBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (vkBeginCommandBuffer(cmdBuffer, &cmdBufferBeginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to begin secondary command buffer!");
+	}
+
+	m_pStream->record(cmdBuffer, m_snapshots[workerIndex], worker.drawCnt);
+
+	if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed end secondary command buffer!");
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "commands/CommandStream.h"
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+class CommandPool;
+class CommandBuffer;
+
+// Records the draws of a CommandStream on worker threads. Every worker owns one
+// CommandPool per frame in flight and records a secondary command buffer with
+// its share of the draws; the primary buffer then only begins the render pass
+// and executes the secondaries.
+class ParallelCommandRecorder
+{
+public:
+	ParallelCommandRecorder(VkDevice device, uint32_t queueFamilyIndex, uint32_t threadCnt, uint32_t framesInFlight);
+	~ParallelCommandRecorder();
+
+	// recycles the pools of frameIndex, the frame's fence must have signaled
+	void beginFrame(uint32_t frameIndex);
+
+	// records stream into secondary buffers and executes them from primary, which
+	// must be inside the render pass described by inheritanceInfo and begun with
+	// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, or inside dynamic rendering begun
+	// with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR and described by a
+	// VkCommandBufferInheritanceRenderingInfoKHR chained to inheritanceInfo
+	void record(CommandBuffer& primary, const CommandStream& stream, const VkCommandBufferInheritanceInfo& inheritanceInfo);
+
+	uint32_t getThreadCount()const
+	{
+		return (uint32_t)m_workers.size();
+	}
+
+private:
+	struct Worker
+	{
+		std::thread                                   thread;
+		// indexed by frame in flight
+		std::vector<std::unique_ptr<CommandPool>>     cmdPools;
+		std::vector<std::shared_ptr<CommandBuffer>>   cmdBuffers;
+		uint32_t                                      drawCnt = 0;
+	};
+
+	void workerLoop(uint32_t workerIndex);
+	void recordSecondary(uint32_t workerIndex);
+
+private:
+	// below this many draws per secondary, threading costs more than it saves
+	static constexpr uint32_t MinDrawsPerWorker = 64;
+
+	std::vector<std::unique_ptr<Worker>>  m_workers;
+	uint32_t                              m_frameIndex = 0;
+
+	std::mutex                            m_mutex;
+	std::condition_variable               m_workAvailable;
+	std::condition_variable               m_workDone;
+	uint64_t                              m_generation = 0;
+	uint32_t                              m_activeWorkers = 0;
+	uint32_t                              m_pendingWorkers = 0;
+	bool                                  m_quit = false;
+	std::exception_ptr                    m_error;
+
+	// only valid while a record() call is in progress
+	const CommandStream*                  m_pStream = nullptr;
+	const VkCommandBufferInheritanceInfo* m_pInheritanceInfo = nullptr;
+	// the state in front of each worker's first draw, taken in one pass when the draws are split
+	std::vector<uint32_t>                 m_firstDraws;
+	std::vector<CommandStream::StateSnapshot> m_snapshots;
+	// one per worker, the first ones executed in order by record()
+	std::vector<VkCommandBuffer>          m_secondaries;
+};
\ No newline at end of file
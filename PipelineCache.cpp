@@ -0,0 +1,100 @@
+#include "PipelineCache.h"
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <iostream>
+#include <cstring>
+
+PipelineCache::PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& filePath)
+	:m_device(device), m_physicalDevice(physicalDevice), m_filePath(filePath)
+{
+	auto data = load();
+	m_warm = !data.empty() && isCompatible(data);
+	if (!data.empty() && !m_warm)
+	{
+		std::cout << "discarding pipeline cache " << m_filePath << ", it was created for another device or driver\n";
+	}
+
+	VkPipelineCacheCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.pNext = nullptr;
+	createInfo.flags = 0;
+	createInfo.initialDataSize = m_warm ? data.size() : 0;
+	createInfo.pInitialData = m_warm ? data.data() : nullptr;
+
+	if (vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_vkPipelineCache) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create pipeline cache!");
+	}
+}
+
+PipelineCache::~PipelineCache()
+{
+	try
+	{
+		save();
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+	}
+	vkDestroyPipelineCache(m_device, m_vkPipelineCache, nullptr);
+}
+
+std::vector<char> PipelineCache::load()
+{
+	std::ifstream file(m_filePath.c_str(), std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+		return {};
+
+	auto size = file.tellg();
+	std::vector<char> contents(size);
+	file.seekg(0);
+	file.read(contents.data(), size);
+	if (!file)
+		return {};
+
+	return contents;
+}
+
+bool PipelineCache::isCompatible(const std::vector<char>& data)
+{
+	VkPipelineCacheHeaderVersionOne header;
+	if (data.size() < sizeof(header))
+		return false;
+
+	std::memcpy(&header, data.data(), sizeof(header));
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+
+	return header.headerSize >= sizeof(header)
+		&& header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& header.vendorID == properties.vendorID
+		&& header.deviceID == properties.deviceID
+		&& std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::save()
+{
+	size_t size = 0;
+	if (vkGetPipelineCacheData(m_device, m_vkPipelineCache, &size, nullptr) != VK_SUCCESS || size == 0)
+		return;
+
+	std::vector<char> data(size);
+	if (vkGetPipelineCacheData(m_device, m_vkPipelineCache, &size, data.data()) != VK_SUCCESS)
+		return;
+
+	// never leave a truncated cache behind if we die while writing
+	std::string tmpPath = m_filePath + ".tmp";
+	{
+		std::ofstream file(tmpPath.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+			throw std::runtime_error("failed to open:" + tmpPath);
+
+		file.write(data.data(), size);
+		if (!file)
+			throw std::runtime_error("failed to write:" + tmpPath);
+	}
+	std::filesystem::rename(tmpPath, m_filePath);
+}
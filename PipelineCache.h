@@ -0,0 +1,38 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <string>
+#include <vector>
+
+// VkPipelineCache persisted to disk between runs. The blob is only handed to
+// the driver when its header matches the physical device it was created on,
+// and it is written back atomically (temporary file + rename) on destruction.
+class PipelineCache
+{
+public:
+	PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& filePath);
+	~PipelineCache();
+
+	operator VkPipelineCache()const
+	{
+		return m_vkPipelineCache;
+	}
+
+	// true when a valid cache blob was loaded from disk
+	bool isWarm()const
+	{
+		return m_warm;
+	}
+
+	void save();
+
+private:
+	std::vector<char> load();
+	bool isCompatible(const std::vector<char>& data);
+
+private:
+	VkDevice         m_device;
+	VkPhysicalDevice m_physicalDevice;
+	VkPipelineCache  m_vkPipelineCache;
+	std::string      m_filePath;
+	bool             m_warm = false;
+};
\ No newline at end of file
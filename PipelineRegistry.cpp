@@ -0,0 +1,66 @@
+#include "PipelineRegistry.h"
+#include "GraphicsPipeLine.h"
+#include "AsyncPipelineCompiler.h"
+
+PipelineRegistry::PipelineRegistry(HelloTriangleApplication* pApp, AsyncPipelineCompiler* pCompiler) :m_pApp(pApp), m_pCompiler(pCompiler)
+{
+}
+
+PipelineRegistry::~PipelineRegistry()
+{
+	clear();
+}
+
+GraphicsPipeLine* PipelineRegistry::acquire(const PipelineStateDesc& desc)
+{
+	auto it = m_pipelines.find(desc);
+	if (it != m_pipelines.end())
+	{
+		++m_stats.hits;
+		return it->second.get();
+	}
+
+	++m_stats.misses;
+	auto pPipeline = std::make_unique<GraphicsPipeLine>(m_pApp, desc);
+	if (m_pCompiler)
+	{
+		m_pending.push_back({ pPipeline.get(), m_pCompiler->request(pPipeline.get()) });
+	}
+	else
+	{
+		pPipeline->compile();
+		m_stats.creationMs += pPipeline->getCreationTime();
+	}
+	return m_pipelines.emplace(desc, std::move(pPipeline)).first->second.get();
+}
+
+uint32_t PipelineRegistry::poll()
+{
+	uint32_t readyCnt = 0;
+	for (auto it = m_pending.begin(); it != m_pending.end();)
+	{
+		if (it->compiled.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		// rethrows whatever the worker failed with
+		it->compiled.get();
+		m_stats.creationMs += it->pPipeline->getCreationTime();
+		++readyCnt;
+		it = m_pending.erase(it);
+	}
+	return readyCnt;
+}
+
+void PipelineRegistry::clear()
+{
+	// a worker may still be compiling one of the pipelines about to be destroyed
+	for (auto& pending : m_pending)
+	{
+		pending.compiled.wait();
+	}
+	m_pending.clear();
+	m_pipelines.clear();
+}
\ No newline at end of file
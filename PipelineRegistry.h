@@ -0,0 +1,63 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "PipelineStateDesc.h"
+#include <unordered_map>
+#include <memory>
+#include <vector>
+#include <future>
+class HelloTriangleApplication;
+class GraphicsPipeLine;
+class AsyncPipelineCompiler;
+
+// Owns every graphics pipeline of the application, keyed by PipelineStateDesc.
+// Requesting a description that was seen before returns the existing pipeline
+// instead of compiling it again.
+class PipelineRegistry
+{
+public:
+	struct Stats final
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		// vkCreateGraphicsPipelines time of every pipeline compiled so far
+		double   creationMs = 0.0;
+	};
+
+	// with pCompiler the pipelines are compiled on its workers, otherwise inside acquire()
+	PipelineRegistry(HelloTriangleApplication* pApp, AsyncPipelineCompiler* pCompiler);
+	// waits for compiles still in flight
+	~PipelineRegistry();
+
+	// the returned pipeline is not ready to bind until isReady() says so
+	GraphicsPipeLine* acquire(const PipelineStateDesc& desc);
+
+	// collects finished async compiles and rethrows their errors,
+	// returns how many pipelines became ready since the last call
+	uint32_t poll();
+
+	// destroys every pipeline, none of them may still be used by the GPU
+	void clear();
+
+	std::size_t getPipelineCount()const
+	{
+		return m_pipelines.size();
+	}
+
+	const Stats& getStats()const
+	{
+		return m_stats;
+	}
+
+private:
+	struct PendingCompile
+	{
+		GraphicsPipeLine*              pPipeline = nullptr;
+		std::shared_future<VkPipeline> compiled;
+	};
+
+	HelloTriangleApplication* m_pApp;
+	AsyncPipelineCompiler*    m_pCompiler;
+	std::unordered_map<PipelineStateDesc, std::unique_ptr<GraphicsPipeLine>, PipelineStateDesc::Hasher> m_pipelines;
+	std::vector<PendingCompile> m_pending;
+	Stats                     m_stats;
+};
\ No newline at end of file
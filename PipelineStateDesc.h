@@ -0,0 +1,95 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "HashCombine.h"
+#include <string>
+#include <functional>
+#include "VertexLayout.h"
+#include "DescriptorSetLayoutDesc.h"
+#include <vector>
+
+struct PushConstantRange final
+{
+	VkShaderStageFlags stages = VK_SHADER_STAGE_VERTEX_BIT;
+	uint32_t           offset = 0;
+	uint32_t           size = 0;
+
+	bool operator==(const PushConstantRange& other)const = default;
+};
+
+// Everything that distinguishes one graphics pipeline from another. Two equal
+// descriptions always produce interchangeable pipelines, so PipelineRegistry
+// uses it as the lookup key.
+struct PipelineStateDesc final
+{
+	std::string           vsPath;
+	std::string           fsPath;
+
+	VertexLayout          vertexLayout;
+	// set i of the pipeline layout
+	std::vector<DescriptorSetLayoutDesc> descriptorSetLayouts;
+	// checked against the device's maxPushConstantsSize when the layout is created
+	std::vector<PushConstantRange> pushConstantRanges;
+
+	VkPrimitiveTopology   topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkPolygonMode         polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags       cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace           frontFace = VK_FRONT_FACE_CLOCKWISE;
+	// also used for the render pass attachment, so it must match the framebuffer images
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	// layout the render pass leaves the color attachment in
+	VkImageLayout         colorFinalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	// created for VK_KHR_dynamic_rendering without a render pass, colorFinalLayout is unused then
+	bool                  dynamicRendering = false;
+
+	VkBool32              blendEnable = VK_FALSE;
+	VkBlendFactor         srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	VkBlendFactor         dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+	VkBlendOp             colorBlendOp = VK_BLEND_OP_ADD;
+	VkBlendFactor         srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	VkBlendFactor         dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	VkBlendOp             alphaBlendOp = VK_BLEND_OP_ADD;
+	VkColorComponentFlags colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	bool operator==(const PipelineStateDesc& other)const = default;
+
+	std::size_t hash()const
+	{
+		std::size_t seed = std::hash<std::string>()(vsPath);
+		hashCombine(seed, fsPath);
+		hashCombine(seed, vertexLayout.hash());
+		for (auto& setLayout : descriptorSetLayouts)
+		{
+			hashCombine(seed, setLayout.hash());
+		}
+		for (auto& range : pushConstantRanges)
+		{
+			hashCombine(seed, (uint32_t)range.stages);
+			hashCombine(seed, range.offset);
+			hashCombine(seed, range.size);
+		}
+		hashCombine(seed, (uint32_t)topology);
+		hashCombine(seed, (uint32_t)polygonMode);
+		hashCombine(seed, (uint32_t)cullMode);
+		hashCombine(seed, (uint32_t)frontFace);
+		hashCombine(seed, (uint32_t)samples);
+		hashCombine(seed, (uint32_t)colorFinalLayout);
+		hashCombine(seed, (uint32_t)dynamicRendering);
+		hashCombine(seed, (uint32_t)blendEnable);
+		hashCombine(seed, (uint32_t)srcColorBlendFactor);
+		hashCombine(seed, (uint32_t)dstColorBlendFactor);
+		hashCombine(seed, (uint32_t)colorBlendOp);
+		hashCombine(seed, (uint32_t)srcAlphaBlendFactor);
+		hashCombine(seed, (uint32_t)dstAlphaBlendFactor);
+		hashCombine(seed, (uint32_t)alphaBlendOp);
+		hashCombine(seed, (uint32_t)colorWriteMask);
+		return seed;
+	}
+
+	struct Hasher
+	{
+		std::size_t operator()(const PipelineStateDesc& desc)const
+		{
+			return desc.hash();
+		}
+	};
+};
\ No newline at end of file
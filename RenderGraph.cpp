@@ -0,0 +1,568 @@
+#include "RenderGraph.h"
+#include "CommandBuffer.h"
+#include "GpuProfiler.h"
+#include <algorithm>
+#include <stdexcept>
+
+static const VkAccessFlags s_writeAccess = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+	VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+void RenderGraph::PassBuilder::read(RenderGraphResource resource, const ResourceAccess& access)
+{
+	use(resource, access, false);
+}
+
+void RenderGraph::PassBuilder::write(RenderGraphResource resource, const ResourceAccess& access)
+{
+	use(resource, access, true);
+}
+
+void RenderGraph::PassBuilder::use(RenderGraphResource resource, const ResourceAccess& access, bool write)
+{
+	if (resource >= m_graph.m_resources.size())
+		throw std::runtime_error("render graph pass uses an unknown resource!");
+
+	// a pass using a resource several times gets a single barrier covering all of its accesses
+	auto& accesses = m_graph.m_passes[m_pass].accesses;
+	auto it = std::find_if(accesses.begin(), accesses.end(), [resource](const PassAccess& passAccess) {
+		return passAccess.resource == resource;
+	});
+	if (it == accesses.end())
+	{
+		accesses.push_back({ resource, access, write, !write });
+		return;
+	}
+
+	if (access.layout != VK_IMAGE_LAYOUT_UNDEFINED && it->access.layout != VK_IMAGE_LAYOUT_UNDEFINED && access.layout != it->access.layout)
+		throw std::runtime_error("render graph pass uses an image in two layouts!");
+
+	it->access.stages |= access.stages;
+	it->access.access |= access.access;
+	if (access.layout != VK_IMAGE_LAYOUT_UNDEFINED)
+	{
+		it->access.layout = access.layout;
+	}
+	if (access.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED)
+	{
+		it->access.finalLayout = access.finalLayout;
+	}
+	it->write |= write;
+	it->read |= !write;
+}
+
+RenderGraph::RenderGraph(Device& device)
+	:m_device(device)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+	for (auto& resource : m_resources)
+	{
+		if (!resource.isTransient)
+			continue;
+
+		if (resource.buffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(m_device, resource.buffer, nullptr);
+		}
+		if (resource.image != VK_NULL_HANDLE)
+		{
+			vkDestroyImage(m_device, resource.image, nullptr);
+		}
+	}
+	for (auto& heap : m_heaps)
+	{
+		m_device.getAllocator().free(heap.allocation);
+	}
+}
+
+RenderGraphResource RenderGraph::importBuffer(const char* name, VkBuffer buffer, const ResourceAccess& initialAccess)
+{
+	Resource resource;
+	resource.name = name;
+	resource.buffer = buffer;
+	resource.initialAccess = initialAccess;
+	m_resources.push_back(resource);
+	return (RenderGraphResource)(m_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::importImage(const char* name, VkImage image, VkImageAspectFlags aspects, const ResourceAccess& initialAccess)
+{
+	Resource resource;
+	resource.name = name;
+	resource.isImage = true;
+	resource.image = image;
+	resource.aspects = aspects;
+	resource.initialAccess = initialAccess;
+	m_resources.push_back(resource);
+	return (RenderGraphResource)(m_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::createBuffer(const char* name, VkDeviceSize size, VkBufferUsageFlags usage)
+{
+	Resource resource;
+	resource.name = name;
+	resource.isTransient = true;
+	resource.size = size;
+	resource.usage = usage;
+	m_resources.push_back(resource);
+	return (RenderGraphResource)(m_resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::createImage(const char* name, const VkImageCreateInfo& createInfo, VkImageAspectFlags aspects)
+{
+	Resource resource;
+	resource.name = name;
+	resource.isImage = true;
+	resource.isTransient = true;
+	resource.aspects = aspects;
+	resource.imageCreateInfo = createInfo;
+	// every transient starts out discarded
+	resource.imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	m_resources.push_back(resource);
+	return (RenderGraphResource)(m_resources.size() - 1);
+}
+
+void RenderGraph::setBuffer(RenderGraphResource resource, VkBuffer buffer)
+{
+	if (m_resources[resource].isTransient || m_resources[resource].isImage)
+		throw std::runtime_error("render graph resource is not an imported buffer!");
+
+	m_resources[resource].buffer = buffer;
+}
+
+void RenderGraph::setImage(RenderGraphResource resource, VkImage image)
+{
+	if (m_resources[resource].isTransient || !m_resources[resource].isImage)
+		throw std::runtime_error("render graph resource is not an imported image!");
+
+	m_resources[resource].image = image;
+}
+
+VkBuffer RenderGraph::getBuffer(RenderGraphResource resource)const
+{
+	return m_resources[resource].buffer;
+}
+
+VkImage RenderGraph::getImage(RenderGraphResource resource)const
+{
+	return m_resources[resource].image;
+}
+
+void RenderGraph::addPass(const char* name, const std::function<void(PassBuilder&)>& setup, ExecuteFunction execute)
+{
+	if (m_compiled)
+		throw std::runtime_error("render graph can't change after compile!");
+
+	m_passes.push_back({ name, {}, std::move(execute) });
+	PassBuilder builder(*this, (uint32_t)(m_passes.size() - 1));
+	setup(builder);
+}
+
+void RenderGraph::markOutput(RenderGraphResource resource, const ResourceAccess& finalAccess)
+{
+	m_resources[resource].isOutput = true;
+	m_resources[resource].finalAccess = finalAccess;
+}
+
+void RenderGraph::compile()
+{
+	if (m_compiled)
+		throw std::runtime_error("render graph is already compiled!");
+
+	cullPasses();
+	allocateTransients();
+	planBarriers();
+	m_compiled = true;
+}
+
+void RenderGraph::cullPasses()
+{
+	// walks the passes backwards from the outputs, a pass survives when something
+	// after it still needs one of the resources it writes
+	std::vector<bool> needed(m_resources.size(), false);
+	for (size_t i = 0; i < m_resources.size(); ++i)
+	{
+		needed[i] = m_resources[i].isOutput;
+	}
+
+	std::vector<bool> alive(m_passes.size(), false);
+	for (size_t i = m_passes.size(); i-- > 0;)
+	{
+		auto& pass = m_passes[i];
+		for (auto& passAccess : pass.accesses)
+		{
+			if (passAccess.write && needed[passAccess.resource])
+			{
+				alive[i] = true;
+				break;
+			}
+		}
+		if (!alive[i])
+			continue;
+
+		for (auto& passAccess : pass.accesses)
+		{
+			// an image written without reading its old contents ends the needs of the passes before,
+			// a buffer write may leave parts of the buffer alone so it doesn't
+			bool discard = m_resources[passAccess.resource].isImage && passAccess.write && !passAccess.read &&
+				passAccess.access.layout == VK_IMAGE_LAYOUT_UNDEFINED;
+			needed[passAccess.resource] = !discard;
+		}
+	}
+
+	m_order.clear();
+	for (uint32_t i = 0; i < m_passes.size(); ++i)
+	{
+		if (alive[i])
+		{
+			m_order.push_back(i);
+		}
+	}
+	m_stats.passCnt = (uint32_t)m_order.size();
+	m_stats.culledPassCnt = (uint32_t)(m_passes.size() - m_order.size());
+
+	for (uint32_t position = 0; position < m_order.size(); ++position)
+	{
+		for (auto& passAccess : m_passes[m_order[position]].accesses)
+		{
+			auto& resource = m_resources[passAccess.resource];
+			// the passes run as added, a transient's contents start with its first writer
+			if (resource.isTransient && resource.firstUse == UINT32_MAX && !passAccess.write)
+				throw std::runtime_error("render graph pass reads a transient no pass before it writes!");
+
+			resource.firstUse = std::min(resource.firstUse, position);
+			resource.lastUse = std::max(resource.lastUse, position);
+		}
+	}
+	for (auto& resource : m_resources)
+	{
+		// outputs are read after the graph, their memory can't be handed on
+		if (resource.isOutput)
+		{
+			resource.lastUse = (uint32_t)m_order.size();
+		}
+	}
+}
+
+void RenderGraph::allocateTransients()
+{
+	std::vector<RenderGraphResource> transients;
+	for (RenderGraphResource i = 0; i < m_resources.size(); ++i)
+	{
+		// transients no surviving pass uses are never created
+		if (m_resources[i].isTransient && m_resources[i].firstUse != UINT32_MAX)
+		{
+			transients.push_back(i);
+		}
+	}
+	std::sort(transients.begin(), transients.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+		return m_resources[a].firstUse < m_resources[b].firstUse;
+	});
+
+	VkDeviceSize requestedBytes = 0;
+	std::vector<VkMemoryRequirements> requirements(m_resources.size());
+	for (auto index : transients)
+	{
+		auto& resource = m_resources[index];
+		ResourceTiling tiling = ResourceTiling::Linear;
+		if (resource.isImage)
+		{
+			if (vkCreateImage(m_device, &resource.imageCreateInfo, nullptr, &resource.image) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create render graph image!");
+			}
+			vkGetImageMemoryRequirements(m_device, resource.image, &requirements[index]);
+			if (resource.imageCreateInfo.tiling == VK_IMAGE_TILING_OPTIMAL)
+			{
+				tiling = ResourceTiling::Optimal;
+			}
+		}
+		else
+		{
+			VkBufferCreateInfo createInfo{};
+			createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			createInfo.pNext = nullptr;
+			createInfo.size = resource.size;
+			createInfo.usage = resource.usage;
+			createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			if (vkCreateBuffer(m_device, &createInfo, nullptr, &resource.buffer) != VK_SUCCESS)
+			{
+				throw std::runtime_error("failed to create render graph buffer!");
+			}
+			vkGetBufferMemoryRequirements(m_device, resource.buffer, &requirements[index]);
+		}
+		const auto& memoryRequirements = requirements[index];
+		requestedBytes += memoryRequirements.size;
+
+		// first fit into a heap whose last user is done before this one starts
+		Heap* pHeap = nullptr;
+		for (auto& heap : m_heaps)
+		{
+			if (heap.tiling == tiling && (heap.requirements.memoryTypeBits & memoryRequirements.memoryTypeBits) != 0 &&
+				m_resources[heap.members.back()].lastUse < resource.firstUse)
+			{
+				pHeap = &heap;
+				break;
+			}
+		}
+		if (pHeap == nullptr)
+		{
+			m_heaps.emplace_back();
+			pHeap = &m_heaps.back();
+			pHeap->tiling = tiling;
+			pHeap->requirements = memoryRequirements;
+		}
+		else
+		{
+			pHeap->requirements.size = std::max(pHeap->requirements.size, memoryRequirements.size);
+			pHeap->requirements.alignment = std::max(pHeap->requirements.alignment, memoryRequirements.alignment);
+			pHeap->requirements.memoryTypeBits &= memoryRequirements.memoryTypeBits;
+		}
+		pHeap->members.push_back(index);
+	}
+
+	for (auto& heap : m_heaps)
+	{
+		heap.allocation = m_device.getAllocator().allocate(heap.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, heap.tiling);
+		for (auto index : heap.members)
+		{
+			auto& resource = m_resources[index];
+			if (resource.isImage)
+			{
+				vkBindImageMemory(m_device, resource.image, heap.allocation.memory, heap.allocation.offset);
+			}
+			else
+			{
+				vkBindBufferMemory(m_device, resource.buffer, heap.allocation.memory, heap.allocation.offset);
+			}
+		}
+		m_stats.transientBytes += heap.requirements.size;
+	}
+	m_stats.transientCnt = (uint32_t)transients.size();
+	m_stats.heapCnt = (uint32_t)m_heaps.size();
+	m_stats.aliasedBytes = requestedBytes - m_stats.transientBytes;
+}
+
+void RenderGraph::planBarriers()
+{
+	// every stage and write a resource sees during one execution
+	std::vector<ResourceAccess> usage(m_resources.size());
+	for (auto passIndex : m_order)
+	{
+		for (auto& passAccess : m_passes[passIndex].accesses)
+		{
+			usage[passAccess.resource].stages |= passAccess.access.stages;
+			usage[passAccess.resource].access |= passAccess.access.access & s_writeAccess;
+		}
+	}
+
+	std::vector<ResourceState> states(m_resources.size());
+	for (RenderGraphResource i = 0; i < m_resources.size(); ++i)
+	{
+		auto& resource = m_resources[i];
+		auto& state = states[i];
+		if (!resource.isTransient)
+		{
+			const auto& initial = resource.initialAccess;
+			bool written = (initial.access & s_writeAccess) != 0;
+			state.writeStages = written ? initial.stages : 0;
+			state.writeAccess = initial.access & s_writeAccess;
+			state.readStages = written ? 0 : initial.stages;
+			state.layout = initial.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED ? initial.finalLayout : initial.layout;
+		}
+	}
+	// a transient inherits the memory from the heap member before it, the first
+	// member from the last one as the previous execution left it
+	for (auto& heap : m_heaps)
+	{
+		for (size_t i = 0; i < heap.members.size(); ++i)
+		{
+			auto previous = heap.members[i == 0 ? heap.members.size() - 1 : i - 1];
+			auto& state = states[heap.members[i]];
+			state.writeStages = usage[previous].stages;
+			state.writeAccess = usage[previous].access;
+			state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+	}
+
+	m_batches.assign(m_order.size() + 1, BarrierBatch{});
+	for (size_t position = 0; position < m_order.size(); ++position)
+	{
+		for (auto& passAccess : m_passes[m_order[position]].accesses)
+		{
+			addBarrier(m_batches[position], passAccess.resource, states[passAccess.resource], passAccess.access, passAccess.write);
+		}
+	}
+	for (RenderGraphResource i = 0; i < m_resources.size(); ++i)
+	{
+		if (m_resources[i].isOutput)
+		{
+			addBarrier(m_batches.back(), i, states[i], m_resources[i].finalAccess, false);
+		}
+	}
+
+	m_stats.barrierCallCnt = 0;
+	m_stats.barrierCnt = 0;
+	for (auto& batch : m_batches)
+	{
+		if (batch.srcStages == 0)
+			continue;
+
+		// memory barriers are merged into one per call
+		bool hasMemoryBarrier = false;
+		for (auto& entry : batch.entries)
+		{
+			bool isMemoryBarrier = m_resources[entry.resource].isImage && entry.oldLayout == entry.newLayout;
+			if (!isMemoryBarrier || !hasMemoryBarrier)
+			{
+				++m_stats.barrierCnt;
+			}
+			hasMemoryBarrier |= isMemoryBarrier;
+		}
+		++m_stats.barrierCallCnt;
+	}
+}
+
+void RenderGraph::addBarrier(BarrierBatch& batch, RenderGraphResource resource, ResourceState& state, const ResourceAccess& access, bool write)
+{
+	bool isImage = m_resources[resource].isImage;
+	bool layoutChange = isImage && access.layout != VK_IMAGE_LAYOUT_UNDEFINED && access.layout != state.layout;
+
+	if (write || layoutChange)
+	{
+		// write after read only needs the readers done, which the stages of the call cover
+		// alone, write after write the last write made available as well
+		VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+		if (srcStages != 0 || layoutChange)
+		{
+			batch.srcStages |= srcStages != 0 ? srcStages : (VkPipelineStageFlags)VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			batch.dstStages |= access.stages;
+		}
+		if (state.writeAccess != 0 || layoutChange)
+		{
+			VkImageLayout layout = layoutChange ? access.layout : state.layout;
+			batch.entries.push_back({ resource, state.writeAccess, access.access, layoutChange ? state.layout : layout, layout });
+		}
+		state.writeStages = access.stages;
+		// a layout transition is a write the later accesses have to wait for, its memory is made available by the barrier
+		state.writeAccess = write ? access.access & s_writeAccess : 0;
+		state.readStages = 0;
+		state.visibleStages = write ? 0 : access.stages;
+		state.visibleAccess = write ? 0 : access.access;
+	}
+	else
+	{
+		// read after read needs nothing, read after write once per stage and access
+		bool visible = (access.stages & ~state.visibleStages) == 0 && (access.access & ~state.visibleAccess) == 0;
+		if (state.writeStages != 0 && !visible)
+		{
+			batch.srcStages |= state.writeStages;
+			batch.dstStages |= access.stages;
+			batch.entries.push_back({ resource, state.writeAccess, access.access, state.layout, state.layout });
+			state.visibleStages |= access.stages;
+			state.visibleAccess |= access.access;
+		}
+		state.readStages |= access.stages;
+	}
+
+	if (isImage)
+	{
+		if (access.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED)
+		{
+			state.layout = access.finalLayout;
+		}
+		else if (access.layout != VK_IMAGE_LAYOUT_UNDEFINED)
+		{
+			state.layout = access.layout;
+		}
+	}
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer cmdBuffer, const BarrierBatch& batch)const
+{
+	if (batch.srcStages == 0)
+		return;
+
+	VkMemoryBarrier memoryBarrier{};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	memoryBarrier.pNext = nullptr;
+	bool hasMemoryBarrier = false;
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	for (auto& entry : batch.entries)
+	{
+		const auto& resource = m_resources[entry.resource];
+		if (!resource.isImage)
+		{
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.pNext = nullptr;
+			barrier.srcAccessMask = entry.srcAccess;
+			barrier.dstAccessMask = entry.dstAccess;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.buffer = resource.buffer;
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+			bufferBarriers.push_back(barrier);
+		}
+		else if (entry.oldLayout != entry.newLayout)
+		{
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.pNext = nullptr;
+			barrier.srcAccessMask = entry.srcAccess;
+			barrier.dstAccessMask = entry.dstAccess;
+			barrier.oldLayout = entry.oldLayout;
+			barrier.newLayout = entry.newLayout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = resource.image;
+			barrier.subresourceRange.aspectMask = resource.aspects;
+			barrier.subresourceRange.baseMipLevel = 0;
+			barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+			imageBarriers.push_back(barrier);
+		}
+		else
+		{
+			// images keeping their layout only need the memory dependency
+			memoryBarrier.srcAccessMask |= entry.srcAccess;
+			memoryBarrier.dstAccessMask |= entry.dstAccess;
+			hasMemoryBarrier = true;
+		}
+	}
+
+	VkPipelineStageFlags dstStages = batch.dstStages != 0 ? batch.dstStages : (VkPipelineStageFlags)VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	vkCmdPipelineBarrier(cmdBuffer, batch.srcStages, dstStages, 0,
+		hasMemoryBarrier ? 1 : 0, hasMemoryBarrier ? &memoryBarrier : nullptr,
+		(uint32_t)bufferBarriers.size(), bufferBarriers.data(),
+		(uint32_t)imageBarriers.size(), imageBarriers.data());
+}
+
+void RenderGraph::execute(CommandBuffer& cmdBuffer, GpuProfiler* pProfiler)const
+{
+	if (!m_compiled)
+		throw std::runtime_error("render graph isn't compiled!");
+
+	for (size_t position = 0; position < m_order.size(); ++position)
+	{
+		const auto& pass = m_passes[m_order[position]];
+		recordBarriers(cmdBuffer, m_batches[position]);
+
+		uint32_t scope = GpuProfiler::InvalidScope;
+		if (pProfiler)
+		{
+			scope = pProfiler->beginScope(cmdBuffer, pass.name);
+		}
+		pass.execute(cmdBuffer);
+		if (pProfiler)
+		{
+			pProfiler->endScope(cmdBuffer, scope);
+		}
+	}
+	recordBarriers(cmdBuffer, m_batches.back());
+}
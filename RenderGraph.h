@@ -0,0 +1,203 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "vulkan/Device.h"
+#include <cstdint>
+#include <vector>
+#include <functional>
+class CommandBuffer;
+class GpuProfiler;
+
+// how a pass uses a resource, the graph derives the barriers between passes from consecutive accesses
+struct ResourceAccess final
+{
+	// 0 for a resource not used before the graph
+	VkPipelineStageFlags stages = 0;
+	VkAccessFlags        access = 0;
+	// images only, the layout the pass expects, UNDEFINED when it discards the contents
+	VkImageLayout        layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// images only, the layout the pass leaves the image in when it transitions it
+	// itself like a render pass does, UNDEFINED when that is layout
+	VkImageLayout        finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+using RenderGraphResource = uint32_t;
+
+// Frame graph over the passes of a command buffer. Passes declare which
+// resources they read and write, compile() culls the passes nothing consumes,
+// works out the barriers and layout transitions between the remaining ones
+// and places transient resources whose lifetimes don't overlap into the same
+// memory. The graph is built and compiled once, execute() then replays it
+// into every command buffer recorded, so the per frame cost is the barrier
+// calls themselves. Passes are never reordered, they run in the order they
+// were added, so a pass has to be added after the passes producing what it
+// reads. compile() rejects a transient read before any pass wrote it.
+class RenderGraph
+{
+public:
+	struct Stats final
+	{
+		uint32_t     passCnt = 0;
+		uint32_t     culledPassCnt = 0;
+		// vkCmdPipelineBarrier calls and the buffer, image and memory barriers in them, per execute()
+		uint32_t     barrierCallCnt = 0;
+		uint32_t     barrierCnt = 0;
+		uint32_t     transientCnt = 0;
+		// allocations the transients share
+		uint32_t     heapCnt = 0;
+		VkDeviceSize transientBytes = 0;
+		// memory the transients would take without aliasing, minus what they take
+		VkDeviceSize aliasedBytes = 0;
+	};
+
+	using ExecuteFunction = std::function<void(CommandBuffer&)>;
+
+	class PassBuilder
+	{
+	public:
+		void read(RenderGraphResource resource, const ResourceAccess& access);
+		void write(RenderGraphResource resource, const ResourceAccess& access);
+
+	private:
+		friend class RenderGraph;
+		PassBuilder(RenderGraph& graph, uint32_t pass)
+			:m_graph(graph), m_pass(pass)
+		{
+		}
+
+		void use(RenderGraphResource resource, const ResourceAccess& access, bool write);
+
+	private:
+		RenderGraph& m_graph;
+		uint32_t     m_pass;
+	};
+
+	explicit RenderGraph(Device& device);
+	~RenderGraph();
+
+	// resources owned elsewhere, initialAccess is how they were last used before the graph runs, e.g. by the previous frame
+	RenderGraphResource importBuffer(const char* name, VkBuffer buffer, const ResourceAccess& initialAccess = {});
+	RenderGraphResource importImage(const char* name, VkImage image, VkImageAspectFlags aspects, const ResourceAccess& initialAccess = {});
+
+	// owned by the graph and device local, their contents only live from the first to the last pass using them
+	RenderGraphResource createBuffer(const char* name, VkDeviceSize size, VkBufferUsageFlags usage);
+	RenderGraphResource createImage(const char* name, const VkImageCreateInfo& createInfo, VkImageAspectFlags aspects);
+
+	// for imported resources that change between executions, like the swapchain image
+	void setBuffer(RenderGraphResource resource, VkBuffer buffer);
+	void setImage(RenderGraphResource resource, VkImage image);
+
+	// transients are created by compile()
+	VkBuffer getBuffer(RenderGraphResource resource)const;
+	VkImage getImage(RenderGraphResource resource)const;
+
+	// the pass runs after every pass added before it
+	void addPass(const char* name, const std::function<void(PassBuilder&)>& setup, ExecuteFunction execute);
+
+	// the resource is consumed after the graph, by presenting or a host read for example, as described by finalAccess.
+	// Passes contributing to no output are culled.
+	void markOutput(RenderGraphResource resource, const ResourceAccess& finalAccess);
+
+	// culls, aliases and allocates the transients and plans the barriers, the graph can't change afterwards
+	void compile();
+
+	// records the passes and their barriers, with pProfiler every pass is a scope named after it
+	void execute(CommandBuffer& cmdBuffer, GpuProfiler* pProfiler = nullptr)const;
+
+	const Stats& getStats()const
+	{
+		return m_stats;
+	}
+
+private:
+	struct Resource
+	{
+		const char*        name;
+		bool               isImage = false;
+		bool               isTransient = false;
+		bool               isOutput = false;
+		VkBuffer           buffer = VK_NULL_HANDLE;
+		VkImage            image = VK_NULL_HANDLE;
+		VkImageAspectFlags aspects = 0;
+		ResourceAccess     initialAccess;
+		ResourceAccess     finalAccess;
+		// transients only
+		VkDeviceSize       size = 0;
+		VkBufferUsageFlags usage = 0;
+		VkImageCreateInfo  imageCreateInfo{};
+		// positions in m_order
+		uint32_t           firstUse = UINT32_MAX;
+		uint32_t           lastUse = 0;
+	};
+
+	struct PassAccess
+	{
+		RenderGraphResource resource;
+		ResourceAccess      access;
+		bool                write;
+		bool                read;
+	};
+
+	struct Pass
+	{
+		const char*             name;
+		std::vector<PassAccess> accesses;
+		ExecuteFunction         execute;
+	};
+
+	// transients sharing one allocation, in the order they use it
+	struct Heap
+	{
+		std::vector<RenderGraphResource> members;
+		VkMemoryRequirements             requirements{};
+		ResourceTiling                   tiling = ResourceTiling::Linear;
+		MemoryAllocation                 allocation;
+	};
+
+	// the handles are looked up in execute(), imported resources may change after compile()
+	struct BarrierEntry
+	{
+		RenderGraphResource resource;
+		VkAccessFlags       srcAccess;
+		VkAccessFlags       dstAccess;
+		VkImageLayout       oldLayout;
+		VkImageLayout       newLayout;
+	};
+
+	struct BarrierBatch
+	{
+		VkPipelineStageFlags      srcStages = 0;
+		VkPipelineStageFlags      dstStages = 0;
+		std::vector<BarrierEntry> entries;
+	};
+
+	// what the accesses so far left behind
+	struct ResourceState
+	{
+		// the last write or layout transition
+		VkPipelineStageFlags writeStages = 0;
+		VkAccessFlags        writeAccess = 0;
+		// stages that read since then, and the ones the write was made visible to
+		VkPipelineStageFlags readStages = 0;
+		VkPipelineStageFlags visibleStages = 0;
+		VkAccessFlags        visibleAccess = 0;
+		VkImageLayout        layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	};
+
+	void cullPasses();
+	void allocateTransients();
+	void planBarriers();
+	void addBarrier(BarrierBatch& batch, RenderGraphResource resource, ResourceState& state, const ResourceAccess& access, bool write);
+	void recordBarriers(VkCommandBuffer cmdBuffer, const BarrierBatch& batch)const;
+
+private:
+	Device&                   m_device;
+	std::vector<Resource>     m_resources;
+	std::vector<Pass>         m_passes;
+	// indices of the passes that survived culling
+	std::vector<uint32_t>     m_order;
+	std::vector<Heap>         m_heaps;
+	// one batch in front of each pass in m_order, then the transitions of the outputs
+	std::vector<BarrierBatch> m_batches;
+	bool                      m_compiled = false;
+	Stats                     m_stats;
+};
\ No newline at end of file
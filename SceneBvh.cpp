@@ -0,0 +1,483 @@
+#include "SceneBvh.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cfloat>
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define SCENE_BVH_SSE
+static const uint32_t s_simdWidth = 4;
+#if defined(__AVX2__)
+#define SCENE_BVH_AVX2
+#elif defined(__GNUC__) || defined(__clang__)
+// the AVX2 leaf test is compiled for AVX2 on its own and picked at runtime
+#define SCENE_BVH_AVX2_DISPATCH
+#define SCENE_BVH_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define SCENE_BVH_AVX2_DISPATCH
+#define SCENE_BVH_TARGET_AVX2
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SCENE_BVH_NEON
+static const uint32_t s_simdWidth = 4;
+#else
+static const uint32_t s_simdWidth = 1;
+#endif
+
+#if defined(SCENE_BVH_AVX2)
+#define SCENE_BVH_TARGET_AVX2
+#endif
+
+#if defined(SCENE_BVH_AVX2_DISPATCH)
+static bool isAvx2Supported()
+{
+#if defined(__GNUC__) || defined(__clang__)
+	// s_leafWidth is initialized by a static constructor, which may run before the runtime's own
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	// AVX and OSXSAVE, then the OS saving the ymm registers on context switches
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#endif
+}
+
+// boxes per leaf test instruction, known once the CPU is
+static const uint32_t s_leafWidth = isAvx2Supported() ? 8 : s_simdWidth;
+#elif defined(SCENE_BVH_AVX2)
+static const uint32_t s_leafWidth = 8;
+#else
+static const uint32_t s_leafWidth = s_simdWidth;
+#endif
+
+static const uint32_t s_binCnt = 16;
+// SAH costs relative to visiting a node, a box test is shared by a vector's worth of boxes
+static const float s_boxCost = 1.0f / s_leafWidth;
+// past this depth splits fall back to the median, bounding the traversal stack
+static const uint32_t s_maxSahDepth = 48;
+static const uint32_t s_maxDepth = 128;
+
+static Aabb2D emptyBox()
+{
+	return Aabb2D{ { FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX } };
+}
+
+static void grow(Aabb2D& box, const Aabb2D& other)
+{
+	box.min[0] = std::min(box.min[0], other.min[0]);
+	box.min[1] = std::min(box.min[1], other.min[1]);
+	box.max[0] = std::max(box.max[0], other.max[0]);
+	box.max[1] = std::max(box.max[1], other.max[1]);
+}
+
+// the 2D surface area heuristic weighs children by the chance a random view overlaps them, which grows with the perimeter
+static float halfPerimeter(const Aabb2D& box)
+{
+	if (box.min[0] > box.max[0])
+		return 0.0f;
+	return (box.max[0] - box.min[0]) + (box.max[1] - box.min[1]);
+}
+
+static bool overlaps(const Aabb2D& box, const Aabb2D& view)
+{
+	return box.min[0] <= view.max[0] && box.max[0] >= view.min[0] && box.min[1] <= view.max[1] && box.max[1] >= view.min[1];
+}
+
+static bool contains(const Aabb2D& view, const Aabb2D& box)
+{
+	return box.min[0] >= view.min[0] && box.max[0] <= view.max[0] && box.min[1] >= view.min[1] && box.max[1] <= view.max[1];
+}
+
+SceneBvh::SceneBvh(const std::vector<Aabb2D>& bounds, uint32_t threadCnt)
+{
+	TRACE_ZONE("SceneBvh::build");
+	if (!bounds.empty())
+	{
+		uint32_t boxCnt = (uint32_t)bounds.size();
+		std::vector<uint32_t> order(boxCnt);
+		std::iota(order.begin(), order.end(), 0u);
+		std::vector<float> centers(2 * (std::size_t)boxCnt);
+		for (uint32_t i = 0; i < boxCnt; ++i)
+		{
+			centers[2 * i] = 0.5f * (bounds[i].min[0] + bounds[i].max[0]);
+			centers[2 * i + 1] = 0.5f * (bounds[i].min[1] + bounds[i].max[1]);
+		}
+
+		m_nodes.reserve(4 * (std::size_t)boxCnt / MaxLeafSize + 1);
+		build(order, bounds, centers, 0, boxCnt, 0);
+
+		// the padding boxes overlap nothing
+		std::size_t paddedCnt = (std::size_t)boxCnt + s_leafWidth - 1;
+		m_minX.assign(paddedCnt, FLT_MAX);
+		m_minY.assign(paddedCnt, FLT_MAX);
+		m_maxX.assign(paddedCnt, -FLT_MAX);
+		m_maxY.assign(paddedCnt, -FLT_MAX);
+		for (uint32_t i = 0; i < boxCnt; ++i)
+		{
+			auto& box = bounds[order[i]];
+			m_minX[i] = box.min[0];
+			m_minY[i] = box.min[1];
+			m_maxX[i] = box.max[0];
+			m_maxY[i] = box.max[1];
+		}
+		m_objectIndices = std::move(order);
+	}
+
+	if (threadCnt == 0 || m_nodes.empty())
+		return;
+
+	// split the top of the tree until every thread can take a few subtrees
+	m_tasks.push_back(0);
+	std::size_t taskTarget = 4 * ((std::size_t)threadCnt + 1);
+	for (std::size_t i = 0; i < m_tasks.size() && m_tasks.size() < taskTarget;)
+	{
+		auto& node = m_nodes[m_tasks[i]];
+		if (node.rightChild == 0)
+		{
+			++i;
+			continue;
+		}
+		uint32_t left = m_tasks[i] + 1;
+		m_tasks[i] = left;
+		m_tasks.push_back(node.rightChild);
+	}
+
+	m_threadVisible.resize(threadCnt + 1);
+	m_threadTested.resize(threadCnt + 1);
+	for (uint32_t i = 0; i < threadCnt; ++i)
+	{
+		m_workers.emplace_back(&SceneBvh::workerLoop, this, i + 1);
+	}
+}
+
+SceneBvh::~SceneBvh()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_quit = true;
+	}
+	m_workAvailable.notify_all();
+	for (auto& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+const char* SceneBvh::getSimdName()
+{
+	if (s_leafWidth == 8)
+		return "AVX2";
+#if defined(SCENE_BVH_SSE)
+	return "SSE2";
+#elif defined(SCENE_BVH_NEON)
+	return "NEON";
+#else
+	return "scalar";
+#endif
+}
+
+uint32_t SceneBvh::build(std::vector<uint32_t>& order, const std::vector<Aabb2D>& bounds, const std::vector<float>& centers,
+	uint32_t begin, uint32_t end, uint32_t depth)
+{
+	uint32_t nodeIndex = (uint32_t)m_nodes.size();
+	m_nodes.push_back({});
+
+	Aabb2D nodeBounds = emptyBox();
+	Aabb2D centerBounds = emptyBox();
+	for (uint32_t i = begin; i < end; ++i)
+	{
+		grow(nodeBounds, bounds[order[i]]);
+		const float* pCenter = &centers[2 * order[i]];
+		grow(centerBounds, Aabb2D{ { pCenter[0], pCenter[1] }, { pCenter[0], pCenter[1] } });
+	}
+	m_nodes[nodeIndex] = Node{ nodeBounds, begin, end - begin, 0, 0 };
+
+	uint32_t count = end - begin;
+	if (count <= s_leafWidth)
+		return nodeIndex;
+
+	// binned SAH over both axes
+	int bestAxis = -1;
+	uint32_t bestBin = 0;
+	float bestCost = halfPerimeter(nodeBounds) * count * s_boxCost;
+	if (depth < s_maxSahDepth)
+	{
+		for (int axis = 0; axis < 2; ++axis)
+		{
+			float extent = centerBounds.max[axis] - centerBounds.min[axis];
+			if (extent <= 0.0f)
+				continue;
+
+			Aabb2D binBounds[s_binCnt];
+			uint32_t binCounts[s_binCnt] = {};
+			std::fill(binBounds, binBounds + s_binCnt, emptyBox());
+			float binScale = s_binCnt / extent;
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				uint32_t bin = std::min(s_binCnt - 1, (uint32_t)((centers[2 * order[i] + axis] - centerBounds.min[axis]) * binScale));
+				grow(binBounds[bin], bounds[order[i]]);
+				++binCounts[bin];
+			}
+
+			// right to left sweep, then evaluate each split while sweeping left to right
+			float rightCosts[s_binCnt];
+			Aabb2D rightBounds = emptyBox();
+			uint32_t rightCnt = 0;
+			for (uint32_t bin = s_binCnt - 1; bin > 0; --bin)
+			{
+				grow(rightBounds, binBounds[bin]);
+				rightCnt += binCounts[bin];
+				rightCosts[bin] = halfPerimeter(rightBounds) * rightCnt * s_boxCost;
+			}
+			Aabb2D leftBounds = emptyBox();
+			uint32_t leftCnt = 0;
+			for (uint32_t bin = 0; bin < s_binCnt - 1; ++bin)
+			{
+				grow(leftBounds, binBounds[bin]);
+				leftCnt += binCounts[bin];
+				float cost = halfPerimeter(nodeBounds) + halfPerimeter(leftBounds) * leftCnt * s_boxCost + rightCosts[bin + 1];
+				if (leftCnt > 0 && leftCnt < count && cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = bin;
+				}
+			}
+		}
+	}
+
+	uint32_t middle = begin;
+	if (bestAxis >= 0)
+	{
+		float extent = centerBounds.max[bestAxis] - centerBounds.min[bestAxis];
+		float binScale = s_binCnt / extent;
+		float minCenter = centerBounds.min[bestAxis];
+		auto it = std::partition(order.begin() + begin, order.begin() + end, [&](uint32_t index) {
+			return std::min(s_binCnt - 1, (uint32_t)((centers[2 * index + bestAxis] - minCenter) * binScale)) <= bestBin;
+		});
+		middle = (uint32_t)(it - order.begin());
+	}
+	else if (count <= MaxLeafSize)
+	{
+		// splitting doesn't pay off
+		return nodeIndex;
+	}
+	else
+	{
+		// too many boxes for a leaf but no useful split, e.g. identical centers
+		int axis = (centerBounds.max[0] - centerBounds.min[0]) >= (centerBounds.max[1] - centerBounds.min[1]) ? 0 : 1;
+		middle = begin + count / 2;
+		std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end, [&](uint32_t a, uint32_t b) {
+			return centers[2 * a + axis] < centers[2 * b + axis];
+		});
+	}
+
+	build(order, bounds, centers, begin, middle, depth + 1);
+	uint32_t rightChild = build(order, bounds, centers, middle, end, depth + 1);
+	m_nodes[nodeIndex].rightChild = rightChild;
+	return nodeIndex;
+}
+
+void SceneBvh::cull(const Aabb2D& view, std::vector<uint32_t>& visible)
+{
+	TRACE_ZONE("SceneBvh::cull");
+	auto start = std::chrono::steady_clock::now();
+	visible.clear();
+	if (m_nodes.empty())
+		return;
+
+	if (m_workers.empty())
+	{
+		cullSubtree(0, view, visible, m_stats.testedCnt);
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_view = view;
+			m_nextTask = 0;
+			m_pendingWorkers = (uint32_t)m_workers.size();
+			++m_generation;
+		}
+		m_workAvailable.notify_all();
+		runTasks(0);
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workDone.wait(lock, [this] { return m_pendingWorkers == 0; });
+		}
+		for (std::size_t slot = 0; slot < m_threadVisible.size(); ++slot)
+		{
+			visible.insert(visible.end(), m_threadVisible[slot].begin(), m_threadVisible[slot].end());
+			m_stats.testedCnt += m_threadTested[slot];
+		}
+	}
+
+	++m_stats.cullCnt;
+	m_stats.boxCnt += m_objectIndices.size();
+	m_stats.visibleCnt += visible.size();
+	m_stats.cullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SceneBvh::cullSubtree(uint32_t root, const Aabb2D& view, std::vector<uint32_t>& visible, uint64_t& testedCnt)const
+{
+	uint32_t stack[s_maxDepth];
+	uint32_t stackSize = 0;
+	uint32_t nodeIndex = root;
+	for (;;)
+	{
+		auto& node = m_nodes[nodeIndex];
+		if (overlaps(node.bounds, view))
+		{
+			if (contains(view, node.bounds))
+			{
+				visible.insert(visible.end(), m_objectIndices.begin() + node.first, m_objectIndices.begin() + node.first + node.count);
+			}
+			else if (node.rightChild == 0)
+			{
+				testLeaf(node, view, visible);
+				testedCnt += node.count;
+			}
+			else
+			{
+				stack[stackSize++] = node.rightChild;
+				nodeIndex = nodeIndex + 1;
+				continue;
+			}
+		}
+
+		if (stackSize == 0)
+			break;
+		nodeIndex = stack[--stackSize];
+	}
+}
+
+#if defined(SCENE_BVH_AVX2) || defined(SCENE_BVH_AVX2_DISPATCH)
+// testLeaf() for 8 boxes at a time, the whole loop is in here as it can't be inlined into code not compiled for AVX2
+SCENE_BVH_TARGET_AVX2 static void testBoxesAvx2(const float* pMinX, const float* pMinY, const float* pMaxX, const float* pMaxY,
+	const uint32_t* pObjectIndices, uint32_t first, uint32_t end, const Aabb2D& view, std::vector<uint32_t>& visible)
+{
+	__m256 viewMinX = _mm256_set1_ps(view.min[0]);
+	__m256 viewMinY = _mm256_set1_ps(view.min[1]);
+	__m256 viewMaxX = _mm256_set1_ps(view.max[0]);
+	__m256 viewMaxY = _mm256_set1_ps(view.max[1]);
+	for (uint32_t i = first; i < end; i += 8)
+	{
+		__m256 overlapX = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&pMinX[i]), viewMaxX, _CMP_LE_OQ),
+			_mm256_cmp_ps(_mm256_loadu_ps(&pMaxX[i]), viewMinX, _CMP_GE_OQ));
+		__m256 overlapY = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&pMinY[i]), viewMaxY, _CMP_LE_OQ),
+			_mm256_cmp_ps(_mm256_loadu_ps(&pMaxY[i]), viewMinY, _CMP_GE_OQ));
+		uint32_t mask = (uint32_t)_mm256_movemask_ps(_mm256_and_ps(overlapX, overlapY));
+		if (end - i < 8)
+		{
+			mask &= (1u << (end - i)) - 1;
+		}
+		while (mask)
+		{
+			visible.push_back(pObjectIndices[i + std::countr_zero(mask)]);
+			mask &= mask - 1;
+		}
+	}
+}
+#endif
+
+void SceneBvh::testLeaf(const Node& leaf, const Aabb2D& view, std::vector<uint32_t>& visible)const
+{
+	uint32_t end = leaf.first + leaf.count;
+#if defined(SCENE_BVH_AVX2) || defined(SCENE_BVH_AVX2_DISPATCH)
+	if (s_leafWidth == 8)
+	{
+		testBoxesAvx2(m_minX.data(), m_minY.data(), m_maxX.data(), m_maxY.data(), m_objectIndices.data(), leaf.first, end, view, visible);
+		return;
+	}
+#endif
+
+#if defined(SCENE_BVH_SSE)
+	__m128 viewMinX = _mm_set1_ps(view.min[0]);
+	__m128 viewMinY = _mm_set1_ps(view.min[1]);
+	__m128 viewMaxX = _mm_set1_ps(view.max[0]);
+	__m128 viewMaxY = _mm_set1_ps(view.max[1]);
+#elif defined(SCENE_BVH_NEON)
+	float32x4_t viewMinX = vdupq_n_f32(view.min[0]);
+	float32x4_t viewMinY = vdupq_n_f32(view.min[1]);
+	float32x4_t viewMaxX = vdupq_n_f32(view.max[0]);
+	float32x4_t viewMaxY = vdupq_n_f32(view.max[1]);
+	static const uint32_t laneBits[4] = { 1, 2, 4, 8 };
+	uint32x4_t laneMask = vld1q_u32(laneBits);
+#endif
+
+	for (uint32_t i = leaf.first; i < end; i += s_simdWidth)
+	{
+		// one bit per box overlapping the view
+#if defined(SCENE_BVH_SSE)
+		__m128 overlapX = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&m_minX[i]), viewMaxX), _mm_cmpge_ps(_mm_loadu_ps(&m_maxX[i]), viewMinX));
+		__m128 overlapY = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&m_minY[i]), viewMaxY), _mm_cmpge_ps(_mm_loadu_ps(&m_maxY[i]), viewMinY));
+		uint32_t mask = (uint32_t)_mm_movemask_ps(_mm_and_ps(overlapX, overlapY));
+#elif defined(SCENE_BVH_NEON)
+		uint32x4_t overlapX = vandq_u32(vcleq_f32(vld1q_f32(&m_minX[i]), viewMaxX), vcgeq_f32(vld1q_f32(&m_maxX[i]), viewMinX));
+		uint32x4_t overlapY = vandq_u32(vcleq_f32(vld1q_f32(&m_minY[i]), viewMaxY), vcgeq_f32(vld1q_f32(&m_maxY[i]), viewMinY));
+		uint32_t mask = vaddvq_u32(vandq_u32(vandq_u32(overlapX, overlapY), laneMask));
+#else
+		Aabb2D box{ { m_minX[i], m_minY[i] }, { m_maxX[i], m_maxY[i] } };
+		uint32_t mask = overlaps(box, view) ? 1u : 0u;
+#endif
+		// the last group may run into the next leaf
+		if (end - i < s_simdWidth)
+		{
+			mask &= (1u << (end - i)) - 1;
+		}
+		while (mask)
+		{
+			visible.push_back(m_objectIndices[i + std::countr_zero(mask)]);
+			mask &= mask - 1;
+		}
+	}
+}
+
+void SceneBvh::runTasks(uint32_t slot)
+{
+	auto& visible = m_threadVisible[slot];
+	visible.clear();
+	m_threadTested[slot] = 0;
+	for (uint32_t task = m_nextTask++; task < m_tasks.size(); task = m_nextTask++)
+	{
+		cullSubtree(m_tasks[task], m_view, visible, m_threadTested[slot]);
+	}
+}
+
+void SceneBvh::workerLoop(uint32_t slot)
+{
+	TRACE_THREAD_NAME("SceneBvh worker");
+	uint64_t generation = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workAvailable.wait(lock, [&] { return m_quit || m_generation != generation; });
+			if (m_quit)
+				return;
+			generation = m_generation;
+		}
+
+		runTasks(slot);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (--m_pendingWorkers == 0)
+			{
+				m_workDone.notify_one();
+			}
+		}
+	}
+}
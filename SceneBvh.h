@@ -0,0 +1,111 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// 2D axis aligned box, empty when min > max
+struct Aabb2D final
+{
+	float min[2];
+	float max[2];
+};
+
+// Bounding volume hierarchy over a static set of 2D boxes for rejecting
+// invisible objects on the CPU before any draw is emitted. The tree is built
+// with the binned surface area heuristic (half perimeter in 2D) and
+// flattened depth first into one array, so a node's left child is the next
+// node. The boxes are reordered into leaf order and kept as structure of
+// arrays, so a leaf is tested against the view 8 boxes per instruction with
+// AVX2 when the CPU has it, otherwise 4 at a time with SSE or NEON. Subtrees
+// entirely inside the view are accepted without testing their boxes.
+class SceneBvh
+{
+public:
+	struct Stats final
+	{
+		uint64_t cullCnt = 0;
+		// boxes culled against, objects * cull calls
+		uint64_t boxCnt = 0;
+		uint64_t visibleCnt = 0;
+		// boxes tested one by one in leaves straddling the view
+		uint64_t testedCnt = 0;
+		double   cullMs = 0.0;
+	};
+
+	static constexpr uint32_t MaxLeafSize = 16;
+
+	// threadCnt 0 culls on the calling thread only, otherwise threadCnt workers
+	// help with the subtrees while the calling thread takes its share
+	SceneBvh(const std::vector<Aabb2D>& bounds, uint32_t threadCnt = 0);
+	~SceneBvh();
+
+	// replaces visible with the indices into the constructor's bounds of every box overlapping view, in no particular order
+	void cull(const Aabb2D& view, std::vector<uint32_t>& visible);
+
+	uint32_t getNodeCount()const
+	{
+		return (uint32_t)m_nodes.size();
+	}
+
+	uint32_t getThreadCount()const
+	{
+		return (uint32_t)m_workers.size();
+	}
+
+	const Stats& getStats()const
+	{
+		return m_stats;
+	}
+
+	// name of the vector instruction set the box test runs with on this CPU
+	static const char* getSimdName();
+
+private:
+	// 32 bytes, two nodes per cache line
+	struct Node
+	{
+		Aabb2D   bounds;
+		// the boxes below the node, contiguous in leaf order
+		uint32_t first;
+		uint32_t count;
+		// 0 for leaves, the left child is always the next node
+		uint32_t rightChild;
+		uint32_t padding;
+	};
+
+	uint32_t build(std::vector<uint32_t>& order, const std::vector<Aabb2D>& bounds, const std::vector<float>& centers,
+		uint32_t begin, uint32_t end, uint32_t depth);
+	void cullSubtree(uint32_t root, const Aabb2D& view, std::vector<uint32_t>& visible, uint64_t& testedCnt)const;
+	void testLeaf(const Node& leaf, const Aabb2D& view, std::vector<uint32_t>& visible)const;
+	void runTasks(uint32_t slot);
+	void workerLoop(uint32_t slot);
+
+private:
+	std::vector<Node>                  m_nodes;
+	// the boxes in leaf order, padded so a vector load never reads past the end
+	std::vector<float>                 m_minX;
+	std::vector<float>                 m_minY;
+	std::vector<float>                 m_maxX;
+	std::vector<float>                 m_maxY;
+	// leaf order to the caller's index
+	std::vector<uint32_t>              m_objectIndices;
+	Stats                              m_stats;
+
+	// subtrees handed out to the threads, a few per thread to balance uneven visibility
+	std::vector<uint32_t>              m_tasks;
+	std::vector<std::thread>           m_workers;
+	// per thread results, slot 0 is the calling thread
+	std::vector<std::vector<uint32_t>> m_threadVisible;
+	std::vector<uint64_t>              m_threadTested;
+	std::atomic<uint32_t>              m_nextTask{ 0 };
+	Aabb2D                             m_view{};
+	std::mutex                         m_mutex;
+	std::condition_variable            m_workAvailable;
+	std::condition_variable            m_workDone;
+	uint64_t                           m_generation = 0;
+	uint32_t                           m_pendingWorkers = 0;
+	bool                               m_quit = false;
+};
\ No newline at end of file
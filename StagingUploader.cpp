@@ -0,0 +1,326 @@
+#include "StagingUploader.h"
+#include "CommandPool.h"
+#include "CommandBuffer.h"
+#include "Tracer.h"
+#include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+StagingUploader::StagingUploader(Device& device, FrameScheduler& scheduler, VkQueue transferQueue, uint32_t transferQueueFamily,
+	VkQueue graphicsQueue, uint32_t graphicsQueueFamily, VkDeviceSize ringSize)
+	:m_device(device), m_scheduler(scheduler), m_transferQueue(scheduler.addQueue(transferQueue)), m_transferQueueFamily(transferQueueFamily),
+	m_graphicsQueue(scheduler.addQueue(graphicsQueue)), m_graphicsQueueFamily(graphicsQueueFamily), m_ringSize(ringSize)
+{
+	// copies from aligned offsets take the fast path on some implementations
+	m_alignment = std::max<VkDeviceSize>(m_device.getProperties().limits.optimalBufferCopyOffsetAlignment, 16);
+	VkCommandPoolCreateFlags poolFlags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	m_pCommandPool = new CommandPool(m_device, m_transferQueueFamily, poolFlags);
+	if (hasTransferQueue())
+	{
+		m_pAcquireCommandPool = new CommandPool(m_device, m_graphicsQueueFamily, poolFlags);
+	}
+	// the ring is only ever written sequentially, so uncached write combined memory is fine
+	m_ring = m_device.createBuffer(m_ringSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+StagingUploader::~StagingUploader()
+{
+	waitIdle();
+	// the batches' command buffers are freed back to the pools, before those are destroyed
+	m_recording = Batch{};
+	m_submitted.clear();
+	m_acquiring.clear();
+	m_freeBatches.clear();
+	delete m_pAcquireCommandPool;
+	delete m_pCommandPool;
+	m_device.destroyBuffer(m_ring);
+}
+
+uint64_t StagingUploader::upload(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* pData, VkDeviceSize size,
+	VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+	TRACE_ZONE("StagingUpload");
+	// smaller chunks than the ring let the GPU copy one chunk while the next is written
+	VkDeviceSize chunkSize = m_ringSize / 4;
+	auto pSrc = static_cast<const uint8_t*>(pData);
+	uint64_t ticket = m_completedTicket;
+	for (VkDeviceSize copied = 0; copied < size;)
+	{
+		VkDeviceSize copySize = std::min(chunkSize, size - copied);
+		// may submit the recording batch when the ring is full, the chunk then goes into a new one
+		VkDeviceSize ringOffset = allocate(copySize);
+
+		auto copyStart = std::chrono::steady_clock::now();
+		std::memcpy(static_cast<uint8_t*>(m_ring.allocation.pMapped) + ringOffset, pSrc + copied, (std::size_t)copySize);
+		m_device.flush(m_ring.allocation, ringOffset, copySize);
+		m_stats.copyMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - copyStart).count();
+
+		Batch& batch = getRecordingBatch();
+		VkBufferCopy region{};
+		region.srcOffset = ringOffset;
+		region.dstOffset = dstOffset + copied;
+		region.size = copySize;
+		vkCmdCopyBuffer(*batch.cmdBuffer, m_ring.buffer, dstBuffer, 1, &region);
+		batch.dstStages |= dstStage;
+		batch.dstAccess |= dstAccess;
+		if (hasTransferQueue())
+		{
+			addOwnershipBarrier(batch, dstBuffer, region.dstOffset, copySize);
+		}
+		ticket = batch.ticket;
+
+		copied += copySize;
+		++m_stats.copies;
+	}
+	m_stats.bytes += size;
+	return ticket;
+}
+
+void StagingUploader::flush()
+{
+	if (!m_isRecording)
+		return;
+
+	TRACE_ZONE("StagingFlush");
+	VkCommandBuffer cmdBuffer = *m_recording.cmdBuffer;
+	if (hasTransferQueue())
+	{
+		// release half of the ownership transfer, the graphics queue acquires in submitAcquire()
+		vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+			(uint32_t)m_recording.ownershipBarriers.size(), m_recording.ownershipBarriers.data(), 0, nullptr);
+	}
+	else
+	{
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.pNext = nullptr;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = m_recording.dstAccess;
+		vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, m_recording.dstStages ? m_recording.dstStages : (VkPipelineStageFlags)VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+	if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to end upload command buffer!");
+	}
+
+	FrameScheduler::Submit submit;
+	submit.pCmdBuffers = &cmdBuffer;
+	submit.cmdBufferCnt = 1;
+	m_recording.copyValue = m_scheduler.submit(m_transferQueue, submit);
+
+	// on a shared queue, everything submitted after this is ordered behind the copies and the barrier
+	if (!hasTransferQueue())
+	{
+		m_completedTicket = m_recording.ticket;
+	}
+	m_submitted.push_back(std::move(m_recording));
+	m_recording = Batch();
+	m_isRecording = false;
+	++m_stats.submits;
+}
+
+void StagingUploader::poll()
+{
+	while (!m_submitted.empty() && retireOldest(false))
+	{
+	}
+	while (!m_acquiring.empty() && m_scheduler.isComplete(m_graphicsQueue, m_acquiring.front().acquireValue))
+	{
+		m_freeBatches.push_back(std::move(m_acquiring.front()));
+		m_acquiring.pop_front();
+	}
+}
+
+void StagingUploader::waitIdle()
+{
+	flush();
+	auto waitStart = std::chrono::steady_clock::now();
+	while (!m_submitted.empty())
+	{
+		retireOldest(true);
+	}
+	while (!m_acquiring.empty())
+	{
+		m_scheduler.wait(m_graphicsQueue, m_acquiring.front().acquireValue);
+		m_freeBatches.push_back(std::move(m_acquiring.front()));
+		m_acquiring.pop_front();
+	}
+	m_stats.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+}
+
+VkDeviceSize StagingUploader::allocate(VkDeviceSize size)
+{
+	// batches that finished in the meantime give their space back without waiting
+	poll();
+
+	VkDeviceSize offset = 0;
+	VkDeviceSize padding = 0;
+	for (;;)
+	{
+		// an empty ring starts over at the front instead of wrapping later
+		if (m_used == 0)
+		{
+			m_head = 0;
+		}
+		offset = (m_head + m_alignment - 1) / m_alignment * m_alignment;
+		padding = offset - m_head;
+		if (offset + size > m_ringSize)
+		{
+			// the tail of the ring is skipped and released together with this batch
+			padding = m_ringSize - m_head;
+			offset = 0;
+		}
+		if (m_used + padding + size <= m_ringSize)
+			break;
+
+		// the ring is full, the oldest copies have to finish first
+		TRACE_ZONE("StagingStall");
+		auto waitStart = std::chrono::steady_clock::now();
+		if (m_submitted.empty())
+		{
+			flush();
+		}
+		retireOldest(true);
+		m_stats.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+	}
+
+	Batch& batch = getRecordingBatch();
+	batch.ringBytes += padding + size;
+	m_used += padding + size;
+	m_head = offset + size;
+	return offset;
+}
+
+StagingUploader::Batch& StagingUploader::getRecordingBatch()
+{
+	if (m_isRecording)
+		return m_recording;
+
+	if (!m_freeBatches.empty())
+	{
+		m_recording = std::move(m_freeBatches.back());
+		m_freeBatches.pop_back();
+		m_recording.cmdBuffer->reset();
+	}
+	else
+	{
+		m_recording.cmdBuffer = m_pCommandPool->allocate();
+		if (hasTransferQueue())
+		{
+			m_recording.acquireCmdBuffer = m_pAcquireCommandPool->allocate();
+		}
+	}
+	m_recording.ticket = m_nextTicket++;
+	m_recording.ringBytes = 0;
+	m_recording.dstStages = 0;
+	m_recording.dstAccess = 0;
+	m_recording.ownershipBarriers.clear();
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.pNext = nullptr;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = nullptr;
+	if (vkBeginCommandBuffer(*m_recording.cmdBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to begin upload command buffer!");
+	}
+	m_isRecording = true;
+	return m_recording;
+}
+
+void StagingUploader::addOwnershipBarrier(Batch& batch, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size)
+{
+	// chunks of one upload are contiguous, they share a single barrier
+	if (!batch.ownershipBarriers.empty())
+	{
+		auto& last = batch.ownershipBarriers.back();
+		if (last.buffer == buffer && last.offset + last.size == offset)
+		{
+			last.size += size;
+			return;
+		}
+	}
+
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.pNext = nullptr;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.srcQueueFamilyIndex = m_transferQueueFamily;
+	barrier.dstQueueFamilyIndex = m_graphicsQueueFamily;
+	barrier.buffer = buffer;
+	barrier.offset = offset;
+	barrier.size = size;
+	batch.ownershipBarriers.push_back(barrier);
+}
+
+bool StagingUploader::retireOldest(bool wait)
+{
+	Batch& batch = m_submitted.front();
+	if (wait)
+	{
+		m_scheduler.wait(m_transferQueue, batch.copyValue);
+	}
+	else if (!m_scheduler.isComplete(m_transferQueue, batch.copyValue))
+	{
+		return false;
+	}
+
+	// batches retire in submission order, so this frees the oldest bytes of the ring
+	m_used -= batch.ringBytes;
+	if (hasTransferQueue())
+	{
+		submitAcquire(batch);
+		m_completedTicket = batch.ticket;
+		m_acquiring.push_back(std::move(batch));
+	}
+	else
+	{
+		m_freeBatches.push_back(std::move(batch));
+	}
+	m_submitted.pop_front();
+	return true;
+}
+
+void StagingUploader::submitAcquire(Batch& batch)
+{
+	TRACE_ZONE("StagingAcquire");
+	VkCommandBuffer cmdBuffer = *batch.acquireCmdBuffer;
+	batch.acquireCmdBuffer->reset();
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.pNext = nullptr;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = nullptr;
+	if (vkBeginCommandBuffer(cmdBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to begin acquire command buffer!");
+	}
+
+	// the acquire has to repeat the release barriers, only the access masks differ
+	for (auto& barrier : batch.ownershipBarriers)
+	{
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = batch.dstAccess;
+	}
+	VkPipelineStageFlags dstStages = batch.dstStages ? batch.dstStages : (VkPipelineStageFlags)VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+	vkCmdPipelineBarrier(cmdBuffer, dstStages, dstStages, 0, 0, nullptr,
+		(uint32_t)batch.ownershipBarriers.size(), batch.ownershipBarriers.data(), 0, nullptr);
+	if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to end acquire command buffer!");
+	}
+
+	// the copies have finished already, so waiting for the transfer queue never blocks the graphics queue
+	FrameScheduler::TimelineWait copyWait{ m_transferQueue, batch.copyValue, dstStages };
+	FrameScheduler::Submit submit;
+	submit.pCmdBuffers = &cmdBuffer;
+	submit.cmdBufferCnt = 1;
+	submit.pTimelineWaits = &copyWait;
+	submit.timelineWaitCnt = 1;
+	batch.acquireValue = m_scheduler.submit(m_graphicsQueue, submit);
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "vulkan/Device.h"
+#include "FrameScheduler.h"
+#include <memory>
+#include <deque>
+#include <vector>
+class CommandPool;
+class CommandBuffer;
+
+// Streams data into device local buffers through a persistently mapped staging
+// ring. Copies are batched into one command buffer per flush() and the ring
+// space of a batch is reused once the scheduler reports its submission complete,
+// so uploads larger than the ring are split into chunks and only stall when the
+// ring is full.
+//
+// Given a transfer queue from another family than the graphics queue, the
+// copies run there while the graphics queue keeps rendering. Each batch then
+// releases its buffers to the graphics family, and poll() submits the matching
+// acquire on the graphics queue waiting for the transfer queue's value once the
+// copies have finished, so the graphics queue never waits on a transfer in progress.
+// Not thread safe, use it from the thread that submits to the queues.
+class StagingUploader
+{
+public:
+	struct Stats final
+	{
+		uint64_t bytes = 0;
+		uint64_t copies = 0;
+		uint64_t submits = 0;
+		// host time spent writing into the ring, and waiting for ring space or waitIdle()
+		double   copyMs = 0.0;
+		double   stallMs = 0.0;
+	};
+
+	StagingUploader(Device& device, FrameScheduler& scheduler, VkQueue transferQueue, uint32_t transferQueueFamily,
+		VkQueue graphicsQueue, uint32_t graphicsQueueFamily, VkDeviceSize ringSize = 32 * 1024 * 1024);
+	~StagingUploader();
+
+	// dstStage and dstAccess describe how dstBuffer is read on the graphics queue.
+	// Returns the ticket to pass to isComplete(), the buffer must not be used before.
+	uint64_t upload(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* pData, VkDeviceSize size,
+		VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+	// submits the copies recorded so far without waiting for them
+	void flush();
+
+	// hands finished copies over to the graphics queue, call once per frame
+	void poll();
+
+	// true once graphics queue submissions made from now on see the upload
+	bool isComplete(uint64_t ticket)const
+	{
+		return ticket <= m_completedTicket;
+	}
+
+	// flushes and blocks until every upload is complete
+	void waitIdle();
+
+	bool hasTransferQueue()const
+	{
+		return m_transferQueueFamily != m_graphicsQueueFamily;
+	}
+
+	const Stats& getStats()const
+	{
+		return m_stats;
+	}
+
+private:
+	struct Batch
+	{
+		uint64_t                           ticket = 0;
+		std::shared_ptr<CommandBuffer>     cmdBuffer;
+		// scheduler values of the copies on the transfer queue and of the acquire on the graphics queue
+		uint64_t                           copyValue = 0;
+		std::shared_ptr<CommandBuffer>     acquireCmdBuffer;
+		uint64_t                           acquireValue = 0;
+		// ring bytes written by this batch including padding, released with the batch
+		VkDeviceSize                       ringBytes = 0;
+		VkPipelineStageFlags               dstStages = 0;
+		VkAccessFlags                      dstAccess = 0;
+		// the ranges changing queue family, released and acquired with identical barriers
+		std::vector<VkBufferMemoryBarrier> ownershipBarriers;
+	};
+
+	// reserves size contiguous ring bytes for the recording batch and returns their offset
+	VkDeviceSize allocate(VkDeviceSize size);
+	Batch& getRecordingBatch();
+	void addOwnershipBarrier(Batch& batch, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+	// releases the ring space of the oldest submitted batch, returns false if it is
+	// still pending and wait is false
+	bool retireOldest(bool wait);
+	void submitAcquire(Batch& batch);
+
+private:
+	Device&              m_device;
+	FrameScheduler&      m_scheduler;
+	FrameScheduler::QueueId m_transferQueue;
+	uint32_t             m_transferQueueFamily;
+	FrameScheduler::QueueId m_graphicsQueue;
+	uint32_t             m_graphicsQueueFamily;
+	CommandPool*         m_pCommandPool = nullptr;
+	CommandPool*         m_pAcquireCommandPool = nullptr;
+	AllocatedBuffer      m_ring;
+	VkDeviceSize         m_ringSize;
+	VkDeviceSize         m_alignment;
+	VkDeviceSize         m_head = 0;
+	VkDeviceSize         m_used = 0;
+
+	Batch                m_recording;
+	bool                 m_isRecording = false;
+	uint64_t             m_nextTicket = 1;
+	uint64_t             m_completedTicket = 0;
+	// copies in flight, oldest first
+	std::deque<Batch>    m_submitted;
+	// copies done, acquire in flight on the graphics queue
+	std::deque<Batch>    m_acquiring;
+	std::vector<Batch>   m_freeBatches;
+
+	Stats                m_stats;
+};
\ No newline at end of file
@@ -7,6 +7,33 @@
 SwapChain::SwapChain(HelloTriangleApplication* pApp) :m_pApp(pApp)
 {
 	querySwapChainInfo(pApp);
+	createSwapChain(VK_NULL_HANDLE);
+	getImages();
+	createImageViews();
+}
+
+void SwapChain::recreate()
+{
+	// the old swapchain and its views may still be used by frames in flight,
+	// the deletion queue destroys them once those have finished
+	DeletionQueue& deletionQueue = m_pApp->getDeletionQueue();
+	VkSwapchainKHR oldSwapChain = m_vkSwapChain;
+	for (auto& imageView : m_vkImageViews)
+	{
+		deletionQueue.retire(imageView, vkDestroyImageView);
+	}
+	m_vkImageViews.clear();
+	deletionQueue.retire(oldSwapChain, vkDestroySwapchainKHR);
+
+	querySwapChainInfo(m_pApp);
+	createSwapChain(oldSwapChain);
+	getImages();
+	createImageViews();
+}
+
+void SwapChain::createSwapChain(VkSwapchainKHR oldSwapChain)
+{
+	HelloTriangleApplication* pApp = m_pApp;
 	VkSwapchainCreateInfoKHR createInfo;
 	createInfo.clipped = true;
 	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -29,16 +56,14 @@ SwapChain::SwapChain(HelloTriangleApplication* pApp) :m_pApp(pApp)
 	createInfo.imageSharingMode = queueFamilyIndices.size() == 1 ? VkSharingMode::VK_SHARING_MODE_EXCLUSIVE : VkSharingMode::VK_SHARING_MODE_CONCURRENT;
 
 	createInfo.flags = 0;
-	createInfo.oldSwapchain = nullptr;
+	// lets the driver hand resources of the retired swapchain over to the new one
+	createInfo.oldSwapchain = oldSwapChain;
 	createInfo.preTransform = m_swapChainInfo.transform;
 
 	if (vkCreateSwapchainKHR(pApp->getDevice(), &createInfo, nullptr, &m_vkSwapChain) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create swapchain");
 	}
-
-	getImages();
-	createImageViews();
 }
 
 SwapChain::~SwapChain()
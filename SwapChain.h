@@ -8,6 +8,10 @@ class SwapChain final
 public:
 	SwapChain(HelloTriangleApplication*pApp);
 	~SwapChain();
+
+	// rebuilds the swapchain and its image views for the current surface size,
+	// passing the current swapchain as oldSwapchain
+	void recreate();
 	
 	struct SwapChainInfo
 	{
@@ -27,13 +31,24 @@ public:
 		return m_swapChainInfo.format.format;
 	}
 
+	VkExtent2D getExtent()const
+	{
+		return m_swapChainInfo.imageExtend;
+	}
+
 	std::vector<VkImageView>& getImageViews()
 	{
 		return m_vkImageViews;
 	}
 
+	VkImage getImage(uint32_t imageIndex)const
+	{
+		return m_vkImages[imageIndex];
+	}
+
 private:
 	void querySwapChainInfo(HelloTriangleApplication* pApp);
+	void createSwapChain(VkSwapchainKHR oldSwapChain);
 	void getImages();
 	void createImageViews();
 private:
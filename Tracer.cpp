@@ -0,0 +1,130 @@
+#include "Tracer.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+
+// events per thread, the oldest are overwritten once the ring is full
+static constexpr uint32_t RingSize = 1 << 16;
+
+struct TraceThreadBuffer
+{
+	uint32_t                   threadId = 0;
+	std::string                name;
+	std::vector<Tracer::Event> events;
+	std::atomic<uint64_t>      eventCnt{ 0 };
+};
+
+struct TraceRegistry
+{
+	std::mutex                                  mutex;
+	// kept alive after their thread exits so its events can still be written
+	std::vector<std::shared_ptr<TraceThreadBuffer>>  buffers;
+};
+
+static TraceRegistry& getRegistry()
+{
+	static TraceRegistry registry;
+	return registry;
+}
+
+static TraceThreadBuffer& getThreadBuffer()
+{
+	thread_local std::shared_ptr<TraceThreadBuffer> pBuffer;
+	if (!pBuffer)
+	{
+		pBuffer = std::make_shared<TraceThreadBuffer>();
+		pBuffer->events.resize(RingSize);
+
+		auto& registry = getRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		pBuffer->threadId = (uint32_t)registry.buffers.size();
+		registry.buffers.push_back(pBuffer);
+	}
+	return *pBuffer;
+}
+
+static void writeString(std::ofstream& file, const char* value)
+{
+	file << '"';
+	for (const char* c = value; *c; ++c)
+	{
+		if (*c == '"' || *c == '\\')
+			file << '\\';
+		file << *c;
+	}
+	file << '"';
+}
+
+std::atomic<bool> Tracer::s_enabled{ false };
+
+void Tracer::setThreadName(const char* name)
+{
+	auto& buffer = getThreadBuffer();
+	std::lock_guard<std::mutex> lock(getRegistry().mutex);
+	buffer.name = name;
+}
+
+uint64_t Tracer::now()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::record(const char* name, uint64_t beginNs, uint64_t endNs)
+{
+	auto& buffer = getThreadBuffer();
+	uint64_t index = buffer.eventCnt.load(std::memory_order_relaxed);
+	buffer.events[index % RingSize] = { name, beginNs, endNs };
+	buffer.eventCnt.store(index + 1, std::memory_order_release);
+}
+
+void Tracer::writeChromeTrace(const std::string& filePath)
+{
+	std::ofstream file(filePath.c_str(), std::ios::trunc);
+	if (!file.is_open())
+		throw std::runtime_error("failed to open:" + filePath);
+
+	auto& registry = getRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	// timestamps are written relative to the first event, in microseconds
+	uint64_t originNs = UINT64_MAX;
+	for (auto& pBuffer : registry.buffers)
+	{
+		uint64_t eventCnt = pBuffer->eventCnt.load(std::memory_order_acquire);
+		uint64_t first = eventCnt > RingSize ? eventCnt - RingSize : 0;
+		for (uint64_t i = first; i < eventCnt; ++i)
+		{
+			originNs = std::min(originNs, pBuffer->events[i % RingSize].beginNs);
+		}
+	}
+
+	file << "{\"traceEvents\":[";
+	bool firstEvent = true;
+	for (auto& pBuffer : registry.buffers)
+	{
+		if (!pBuffer->name.empty())
+		{
+			file << (firstEvent ? "\n" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":" << pBuffer->threadId << ",\"args\":{\"name\":";
+			writeString(file, pBuffer->name.c_str());
+			file << "}}";
+			firstEvent = false;
+		}
+
+		uint64_t eventCnt = pBuffer->eventCnt.load(std::memory_order_acquire);
+		uint64_t first = eventCnt > RingSize ? eventCnt - RingSize : 0;
+		for (uint64_t i = first; i < eventCnt; ++i)
+		{
+			auto& event = pBuffer->events[i % RingSize];
+			file << (firstEvent ? "\n" : ",\n") << "{\"ph\":\"X\",\"name\":";
+			writeString(file, event.name);
+			file << ",\"pid\":0,\"tid\":" << pBuffer->threadId << ",\"ts\":" << (event.beginNs - originNs) / 1000.0
+				<< ",\"dur\":" << (event.endNs - event.beginNs) / 1000.0 << '}';
+			firstEvent = false;
+		}
+	}
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
\ No newline at end of file
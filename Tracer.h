@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <atomic>
+
+// Low overhead CPU zone tracer. TRACE_ZONE("name") records the lifetime of
+// the enclosing scope into a ring buffer owned by the calling thread, so
+// recording takes no lock; writeChromeTrace() dumps every thread's events in
+// the Chrome trace format (chrome://tracing, Perfetto).
+//
+// Zones compile to nothing unless VULKANDEMO_TRACING is defined (CMake option
+// ENABLE_TRACING) and cost a single relaxed load while tracing is disabled at
+// runtime.
+class Tracer
+{
+public:
+	struct Event
+	{
+		const char* name;  // must be a string literal or otherwise outlive the tracer
+		uint64_t    beginNs;
+		uint64_t    endNs;
+	};
+
+	static void setEnabled(bool enabled)
+	{
+		s_enabled.store(enabled, std::memory_order_relaxed);
+	}
+
+	static bool isEnabled()
+	{
+		return s_enabled.load(std::memory_order_relaxed);
+	}
+
+	// names the calling thread in the exported trace
+	static void setThreadName(const char* name);
+
+	static uint64_t now();
+	static void record(const char* name, uint64_t beginNs, uint64_t endNs);
+
+	// the traced threads should be idle, events recorded while writing may be torn
+	static void writeChromeTrace(const std::string& filePath);
+
+private:
+	static std::atomic<bool> s_enabled;
+};
+
+class TraceZone final
+{
+public:
+	explicit TraceZone(const char* name) :m_name(name), m_beginNs(Tracer::isEnabled() ? Tracer::now() : 0)
+	{
+	}
+
+	~TraceZone()
+	{
+		if (m_beginNs != 0)
+		{
+			Tracer::record(m_name, m_beginNs, Tracer::now());
+		}
+	}
+
+	TraceZone(const TraceZone&) = delete;
+	TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+	const char* m_name;
+	uint64_t    m_beginNs;
+};
+
+#ifdef VULKANDEMO_TRACING
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) Tracer::setThreadName(name)
+#else
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "HashCombine.h"
+#include <cstdint>
+#include <vector>
+#include <functional>
+
+struct VertexBinding final
+{
+	uint32_t          binding = 0;
+	uint32_t          stride = 0;
+	VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	bool operator==(const VertexBinding& other)const = default;
+};
+
+struct VertexAttribute final
+{
+	uint32_t location = 0;
+	uint32_t binding = 0;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t offset = 0;
+
+	bool operator==(const VertexAttribute& other)const = default;
+};
+
+// Vertex buffer bindings and the attributes read from them, turned into the
+// pipeline's vertex input state by GraphicsPipeLine::compile(). An empty
+// layout means the vertex shader generates its own positions.
+struct VertexLayout final
+{
+	std::vector<VertexBinding>   bindings;
+	std::vector<VertexAttribute> attributes;
+
+	VertexLayout& addBinding(uint32_t binding, uint32_t stride, VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX)
+	{
+		bindings.push_back({ binding, stride, inputRate });
+		return *this;
+	}
+
+	VertexLayout& addAttribute(uint32_t location, uint32_t binding, VkFormat format, uint32_t offset)
+	{
+		attributes.push_back({ location, binding, format, offset });
+		return *this;
+	}
+
+	bool operator==(const VertexLayout& other)const = default;
+
+	std::size_t hash()const
+	{
+		std::size_t seed = bindings.size();
+		for (auto& binding : bindings)
+		{
+			hashCombine(seed, binding.binding);
+			hashCombine(seed, binding.stride);
+			hashCombine(seed, (uint32_t)binding.inputRate);
+		}
+		for (auto& attribute : attributes)
+		{
+			hashCombine(seed, attribute.location);
+			hashCombine(seed, attribute.binding);
+			hashCombine(seed, (uint32_t)attribute.format);
+			hashCombine(seed, attribute.offset);
+		}
+		return seed;
+	}
+};
\ No newline at end of file
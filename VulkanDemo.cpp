@@ -1,9 +1,147 @@
 ﻿#include "Application.h"
 #include <iostream>
-int main() {
-    HelloTriangleApplication app;
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
 
+// std::sto* throws for bad input without naming the flag, and accepts trailing garbage
+static unsigned long long parseUnsigned(const char* flag, const char* value, unsigned long long maxValue)
+{
+    try
+    {
+        std::size_t end = 0;
+        unsigned long long result = std::stoull(value, &end);
+        if (value[end] == '\0' && value[0] != '-' && result <= maxValue)
+            return result;
+    }
+    catch (const std::logic_error&)
+    {
+    }
+    throw std::runtime_error(std::string("invalid value ") + value + " for " + flag);
+}
+
+static float parseFloat(const char* flag, const char* value)
+{
+    try
+    {
+        std::size_t end = 0;
+        float result = std::stof(value, &end);
+        if (value[end] == '\0')
+            return result;
+    }
+    catch (const std::logic_error&)
+    {
+    }
+    throw std::runtime_error(std::string("invalid value ") + value + " for " + flag);
+}
+
+static HelloTriangleApplication::Settings parseSettings(int argc, char** argv)
+{
+    HelloTriangleApplication::Settings settings;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* flag = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--frames-in-flight") == 0 && hasValue)
+        {
+            settings.framesInFlight = (uint32_t)parseUnsigned(flag, argv[++i], UINT32_MAX);
+        }
+        else if (std::strcmp(argv[i], "--max-frames") == 0 && hasValue)
+        {
+            settings.maxFrames = parseUnsigned(flag, argv[++i], UINT64_MAX);
+        }
+        else if (std::strcmp(argv[i], "--record-threads") == 0 && hasValue)
+        {
+            settings.recordThreads = (uint32_t)parseUnsigned(flag, argv[++i], UINT32_MAX);
+        }
+        else if (std::strcmp(argv[i], "--pipeline-threads") == 0 && hasValue)
+        {
+            settings.pipelineCompileThreads = (uint32_t)parseUnsigned(flag, argv[++i], UINT32_MAX);
+        }
+        else if (std::strcmp(argv[i], "--pipeline-cache") == 0 && hasValue)
+        {
+            settings.pipelineCachePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--headless") == 0)
+        {
+            settings.headless = true;
+        }
+        else if (std::strcmp(argv[i], "--output-dir") == 0 && hasValue)
+        {
+            settings.outputDir = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--shader-dir") == 0 && hasValue)
+        {
+            settings.shaderDir = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--width") == 0 && hasValue)
+        {
+            settings.width = (uint32_t)parseUnsigned(flag, argv[++i], UINT32_MAX);
+        }
+        else if (std::strcmp(argv[i], "--height") == 0 && hasValue)
+        {
+            settings.height = (uint32_t)parseUnsigned(flag, argv[++i], UINT32_MAX);
+        }
+        else if (std::strcmp(argv[i], "--profile-gpu") == 0)
+        {
+            settings.profileGpu = true;
+        }
+        else if (std::strcmp(argv[i], "--gpu-profile-json") == 0 && hasValue)
+        {
+            settings.gpuProfilePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--trace") == 0 && hasValue)
+        {
+            settings.tracePath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--mesh-grid") == 0 && hasValue)
+        {
+            settings.meshGridSize = (uint32_t)parseUnsigned(flag, argv[++i], UINT32_MAX);
+        }
+        else if (std::strcmp(argv[i], "--descriptor-stress") == 0 && hasValue)
+        {
+            settings.descriptorStressSets = (uint32_t)parseUnsigned(flag, argv[++i], UINT32_MAX);
+        }
+        else if (std::strcmp(argv[i], "--instances") == 0 && hasValue)
+        {
+            settings.instanceCount = (uint32_t)parseUnsigned(flag, argv[++i], UINT32_MAX);
+        }
+        else if (std::strcmp(argv[i], "--gpu-driven") == 0)
+        {
+            settings.gpuDriven = true;
+        }
+        else if (std::strcmp(argv[i], "--zoom") == 0 && hasValue)
+        {
+            settings.viewScale = parseFloat(flag, argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--cpu-cull") == 0)
+        {
+            settings.cpuCulling = true;
+        }
+        else if (std::strcmp(argv[i], "--cull-threads") == 0 && hasValue)
+        {
+            settings.cullThreads = (uint32_t)parseUnsigned(flag, argv[++i], UINT32_MAX);
+        }
+        else if (std::strcmp(argv[i], "--dynamic-rendering") == 0)
+        {
+            settings.dynamicRendering = true;
+        }
+        else if (std::strcmp(argv[i], "--no-timeline") == 0)
+        {
+            settings.timelineSemaphores = false;
+        }
+        else if (std::strcmp(argv[i], "--no-command-cache") == 0)
+        {
+            settings.cacheCommandBuffers = false;
+        }
+    }
+    return settings;
+}
+
+int main(int argc, char** argv) {
     try {
+        HelloTriangleApplication app(parseSettings(argc, argv));
         app.run();
     }
     catch (const std::exception& e) {
@@ -0,0 +1,274 @@
+// Random allocate/free churn against MemoryAllocator. Every live allocation is
+// checked against its neighbours in the same VkDeviceMemory, host visible ones
+// carry a fill pattern that is verified on free, and the allocator stats are
+// printed along the way to watch utilization and fragmentation develop.
+#include "BenchContext.h"
+#include <iostream>
+#include <map>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <stdexcept>
+
+struct LiveAllocation final
+{
+	MemoryAllocation allocation;
+	VkDeviceSize     requestedSize = 0;
+	ResourceTiling   tiling = ResourceTiling::Linear;
+	uint32_t         pattern = 0;
+};
+
+struct StressSettings final
+{
+	uint32_t     iterations = 200000;
+	uint32_t     maxLive = 2000;
+	VkDeviceSize blockSize = 64ull * 1024 * 1024;
+	VkDeviceSize minSize = 64;
+	VkDeviceSize maxSize = 4ull * 1024 * 1024;
+	uint32_t     reportInterval = 20000;
+	uint32_t     seed = 1;
+};
+
+static StressSettings parseSettings(int argc, char** argv)
+{
+	StressSettings settings;
+	for (int i = 1; i < argc; ++i)
+	{
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--iterations") == 0 && hasValue)
+		{
+			settings.iterations = (uint32_t)std::stoul(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--max-live") == 0 && hasValue)
+		{
+			settings.maxLive = (uint32_t)std::stoul(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--block-mib") == 0 && hasValue)
+		{
+			settings.blockSize = std::stoull(argv[++i]) * 1024 * 1024;
+		}
+		else if (std::strcmp(argv[i], "--max-size") == 0 && hasValue)
+		{
+			settings.maxSize = std::stoull(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+		{
+			settings.seed = (uint32_t)std::stoul(argv[++i]);
+		}
+	}
+	return settings;
+}
+
+// ranges per VkDeviceMemory, keyed by offset, with the tiling each memory object was first used for
+class OverlapChecker
+{
+public:
+	void insert(const LiveAllocation& live)
+	{
+		const MemoryAllocation& allocation = live.allocation;
+		auto& memory = m_memories[allocation.memory];
+		if (memory.ranges.empty())
+		{
+			memory.tiling = live.tiling;
+		}
+		else if (memory.tiling != live.tiling)
+		{
+			throw std::runtime_error("allocator stress: linear and optimal resources share a VkDeviceMemory");
+		}
+
+		VkDeviceSize end = allocation.offset + allocation.size;
+		auto next = memory.ranges.lower_bound(allocation.offset);
+		if (next != memory.ranges.end() && next->first < end)
+		{
+			throw std::runtime_error("allocator stress: allocation overlaps the one after it");
+		}
+		if (next != memory.ranges.begin() && std::prev(next)->second > allocation.offset)
+		{
+			throw std::runtime_error("allocator stress: allocation overlaps the one before it");
+		}
+		memory.ranges.emplace(allocation.offset, end);
+	}
+
+	void erase(const MemoryAllocation& allocation)
+	{
+		auto it = m_memories.find(allocation.memory);
+		if (it == m_memories.end() || it->second.ranges.erase(allocation.offset) != 1)
+		{
+			throw std::runtime_error("allocator stress: freed allocation was never tracked");
+		}
+		// the allocator may hand the memory object back to the driver and a new one can reuse the handle
+		if (it->second.ranges.empty())
+		{
+			m_memories.erase(it);
+		}
+	}
+
+private:
+	struct Memory
+	{
+		ResourceTiling                       tiling = ResourceTiling::Linear;
+		std::map<VkDeviceSize, VkDeviceSize> ranges;
+	};
+
+	std::map<VkDeviceMemory, Memory> m_memories;
+};
+
+static void writePattern(const LiveAllocation& live)
+{
+	if (!live.allocation.pMapped)
+		return;
+
+	// the first and last words are enough to catch a neighbour that overlaps either end
+	auto pBytes = (uint8_t*)live.allocation.pMapped;
+	std::memcpy(pBytes, &live.pattern, sizeof(uint32_t));
+	std::memcpy(pBytes + live.requestedSize - sizeof(uint32_t), &live.pattern, sizeof(uint32_t));
+}
+
+static void checkPattern(const LiveAllocation& live)
+{
+	if (!live.allocation.pMapped)
+		return;
+
+	auto pBytes = (const uint8_t*)live.allocation.pMapped;
+	uint32_t first, last;
+	std::memcpy(&first, pBytes, sizeof(uint32_t));
+	std::memcpy(&last, pBytes + live.requestedSize - sizeof(uint32_t), sizeof(uint32_t));
+	if (first != live.pattern || last != live.pattern)
+	{
+		throw std::runtime_error("allocator stress: mapped memory was overwritten by another allocation");
+	}
+}
+
+static void printStats(const char* pLabel, size_t liveCnt, const MemoryAllocator::Stats& stats)
+{
+	std::cout << pLabel << ": " << liveCnt << " live, " << stats.allocationCnt << " allocations in " << stats.blockCnt << " blocks ("
+		<< stats.blockBytes / (1024 * 1024) << " MiB) + " << stats.dedicatedCnt << " dedicated ("
+		<< stats.dedicatedBytes / (1024 * 1024) << " MiB), utilization " << stats.getUtilization() * 100.0
+		<< "%, fragmentation " << stats.getFragmentation() * 100.0 << "%, largest free range "
+		<< stats.largestFreeRange / 1024 << " KiB\n";
+}
+
+static void runStress(Device& device, const StressSettings& settings)
+{
+	MemoryAllocator allocator(device, device.getPhysicalDevice(), settings.blockSize);
+	const auto& memoryProperties = allocator.getMemoryProperties();
+	uint32_t allMemoryTypes = (memoryProperties.memoryTypeCount >= 32) ? UINT32_MAX : ((1u << memoryProperties.memoryTypeCount) - 1);
+
+	std::mt19937 rng(settings.seed);
+	// sizes are log-uniform so small and large requests are equally common
+	std::uniform_real_distribution<double> logSize(std::log2((double)settings.minSize), std::log2((double)settings.maxSize));
+	std::uniform_int_distribution<uint32_t> alignmentShift(4, 16);
+	std::uniform_int_distribution<uint32_t> coin(0, 1);
+	std::uniform_int_distribution<uint32_t> percent(0, 99);
+
+	std::vector<LiveAllocation> live;
+	live.reserve(settings.maxLive);
+	OverlapChecker checker;
+	uint32_t nextPattern = 1;
+	uint64_t allocateCnt = 0, freeCnt = 0;
+	double allocateMs = 0.0, freeMs = 0.0;
+
+	auto freeAt = [&](size_t index)
+	{
+		LiveAllocation& victim = live[index];
+		checkPattern(victim);
+		checker.erase(victim.allocation);
+
+		auto start = std::chrono::steady_clock::now();
+		allocator.free(victim.allocation);
+		freeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		++freeCnt;
+
+		victim = live.back();
+		live.pop_back();
+	};
+
+	for (uint32_t i = 0; i < settings.iterations; ++i)
+	{
+		// allocating gets less likely as the live set fills up, so it hovers around maxLive / 2
+		bool doAllocate = std::uniform_int_distribution<uint32_t>(0, settings.maxLive)(rng) >= live.size();
+		if (doAllocate)
+		{
+			LiveAllocation entry;
+			entry.requestedSize = std::max<VkDeviceSize>((VkDeviceSize)std::exp2(logSize(rng)), sizeof(uint32_t));
+			entry.tiling = coin(rng) ? ResourceTiling::Linear : ResourceTiling::Optimal;
+			entry.pattern = nextPattern++;
+
+			VkMemoryRequirements requirements{};
+			requirements.size = entry.requestedSize;
+			requirements.alignment = 1ull << alignmentShift(rng);
+			requirements.memoryTypeBits = allMemoryTypes;
+			// a quarter of the requests want mappable memory so the fill pattern runs on real allocations
+			bool hostVisible = percent(rng) < 25;
+			VkMemoryPropertyFlags required = hostVisible ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT : 0;
+			VkMemoryPropertyFlags preferred = hostVisible ? 0 : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+			auto start = std::chrono::steady_clock::now();
+			entry.allocation = allocator.allocate(requirements, required, preferred, entry.tiling);
+			allocateMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			++allocateCnt;
+
+			if (!entry.allocation)
+			{
+				throw std::runtime_error("allocator stress: allocation failed");
+			}
+			if (entry.allocation.size < entry.requestedSize || entry.allocation.offset % requirements.alignment != 0)
+			{
+				throw std::runtime_error("allocator stress: allocation is too small or misaligned");
+			}
+			if (hostVisible && !entry.allocation.pMapped)
+			{
+				throw std::runtime_error("allocator stress: host visible allocation is not mapped");
+			}
+			checker.insert(entry);
+			writePattern(entry);
+			live.push_back(entry);
+		}
+		else
+		{
+			freeAt(std::uniform_int_distribution<size_t>(0, live.size() - 1)(rng));
+		}
+
+		if (settings.reportInterval != 0 && (i + 1) % settings.reportInterval == 0)
+		{
+			printStats(("iteration " + std::to_string(i + 1)).c_str(), live.size(), allocator.getStats());
+		}
+	}
+
+	printStats("end of churn", live.size(), allocator.getStats());
+	while (!live.empty())
+	{
+		freeAt(live.size() - 1);
+	}
+
+	auto stats = allocator.getStats();
+	printStats("drained", live.size(), stats);
+	if (stats.allocationCnt != 0 || stats.allocatedBytes != 0)
+	{
+		throw std::runtime_error("allocator stress: allocations left behind after freeing everything");
+	}
+
+	std::cout << allocateCnt << " allocations, " << allocateMs * 1e6 / std::max<uint64_t>(allocateCnt, 1) << " ns avg\n"
+		<< freeCnt << " frees, " << freeMs * 1e6 / std::max<uint64_t>(freeCnt, 1) << " ns avg\n";
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		BenchContext context;
+		runStress(context.getDevice(), parseSettings(argc, argv));
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "no overlapping allocations\n";
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+class BenchContext;
+
+#ifndef VULKANDEMO_SHADER_DIR
+#define VULKANDEMO_SHADER_DIR "shaders"
+#endif
+
+struct BenchSettings final
+{
+	std::string shaderDir = VULKANDEMO_SHADER_DIR;
+	// every measurement reports the best of this many runs
+	uint32_t    repeats = 5;
+	// drops the largest problem sizes for a quick run
+	bool        quick = false;
+};
+
+// runs fn repeats times and returns the fastest run in milliseconds, the best
+// run is the one least disturbed by the scheduler and cold caches
+template<typename F>
+double measureBestMs(uint32_t repeats, F&& fn)
+{
+	double bestMs = 0.0;
+	for (uint32_t i = 0; i < std::max(repeats, 1u); ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		fn();
+		double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		bestMs = (i == 0) ? elapsedMs : std::min(bestMs, elapsedMs);
+	}
+	return bestMs;
+}
+
+// items per second given the milliseconds they took
+inline double perSecond(double itemCnt, double ms)
+{
+	return ms > 0.0 ? itemCnt * 1000.0 / ms : 0.0;
+}
+
+// one per benchmark, registered in VulkanDemoBench.cpp
+void benchCommandStream(BenchContext& context, const BenchSettings& settings);
+void benchUpload(BenchContext& context, const BenchSettings& settings);
+void benchDrawCalls(BenchContext& context, const BenchSettings& settings);
+void benchDescriptors(BenchContext& context, const BenchSettings& settings);
+void benchInstancing(BenchContext& context, const BenchSettings& settings);
+void benchCulling(BenchContext& context, const BenchSettings& settings);
+void benchRenderGraph(BenchContext& context, const BenchSettings& settings);
+void benchFramesInFlight(BenchContext& context, const BenchSettings& settings);
\ No newline at end of file
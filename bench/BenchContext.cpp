@@ -0,0 +1,143 @@
+#include "BenchContext.h"
+#include <stdexcept>
+#include <cstring>
+#include <iostream>
+#include <chrono>
+
+static bool isDeviceExtensionSupported(VkPhysicalDevice physicalDevice, const char* pExtensionName)
+{
+	uint32_t extensionCnt = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCnt, nullptr);
+	std::vector<VkExtensionProperties> extensions(extensionCnt);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCnt, extensions.data());
+	for (auto& extension : extensions)
+	{
+		if (std::strcmp(extension.extensionName, pExtensionName) == 0)
+			return true;
+	}
+	return false;
+}
+
+BenchContext::BenchContext(const std::vector<const char*>& optionalExtensions)
+{
+	VkApplicationInfo appInfo{};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "VulkanDemoBench";
+	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.pEngineName = "No Engine";
+	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+	appInfo.apiVersion = VK_API_VERSION_1_0;
+
+	VkInstanceCreateInfo instanceCreateInfo{};
+	instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	instanceCreateInfo.pApplicationInfo = &appInfo;
+	if (vkCreateInstance(&instanceCreateInfo, nullptr, &m_vkInstance) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create instance!");
+	}
+
+	uint32_t physicalDeviceCnt = 0;
+	vkEnumeratePhysicalDevices(m_vkInstance, &physicalDeviceCnt, nullptr);
+	if (physicalDeviceCnt == 0)
+	{
+		vkDestroyInstance(m_vkInstance, nullptr);
+		throw std::runtime_error("failed to find GPUs with Vulkan support!");
+	}
+	std::vector<VkPhysicalDevice> physicalDevices(physicalDeviceCnt);
+	vkEnumeratePhysicalDevices(m_vkInstance, &physicalDeviceCnt, physicalDevices.data());
+	m_vkPhysicalDevice = physicalDevices[0];
+
+	uint32_t queueFamilyCnt = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(m_vkPhysicalDevice, &queueFamilyCnt, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCnt);
+	vkGetPhysicalDeviceQueueFamilyProperties(m_vkPhysicalDevice, &queueFamilyCnt, queueFamilies.data());
+	m_queueFamilyIndex = UINT32_MAX;
+	for (uint32_t i = 0; i < queueFamilyCnt; ++i)
+	{
+		if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		{
+			m_queueFamilyIndex = i;
+			break;
+		}
+	}
+	if (m_queueFamilyIndex == UINT32_MAX)
+	{
+		vkDestroyInstance(m_vkInstance, nullptr);
+		throw std::runtime_error("failed to find a graphics queue family!");
+	}
+
+	float priority = 1.0f;
+	VkDeviceQueueCreateInfo queueCreateInfo{};
+	queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueCreateInfo.queueFamilyIndex = m_queueFamilyIndex;
+	queueCreateInfo.queueCount = 1;
+	queueCreateInfo.pQueuePriorities = &priority;
+
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_vkPhysicalDevice, &supportedFeatures);
+	VkPhysicalDeviceFeatures enabledFeatures{};
+	enabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	enabledFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+	std::vector<const char*> extensionNames;
+	for (auto pExtensionName : optionalExtensions)
+	{
+		if (isDeviceExtensionSupported(m_vkPhysicalDevice, pExtensionName))
+		{
+			extensionNames.push_back(pExtensionName);
+		}
+	}
+
+	VkDeviceCreateInfo deviceCreateInfo{};
+	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceCreateInfo.queueCreateInfoCount = 1;
+	deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+	deviceCreateInfo.pEnabledFeatures = &enabledFeatures;
+	deviceCreateInfo.enabledExtensionCount = (uint32_t)extensionNames.size();
+	deviceCreateInfo.ppEnabledExtensionNames = extensionNames.empty() ? nullptr : extensionNames.data();
+	if (vkCreateDevice(m_vkPhysicalDevice, &deviceCreateInfo, nullptr, &m_vkDevice) != VK_SUCCESS)
+	{
+		vkDestroyInstance(m_vkInstance, nullptr);
+		throw std::runtime_error("failed to create logical device!");
+	}
+	vkGetDeviceQueue(m_vkDevice, m_queueFamilyIndex, 0, &m_vkQueue);
+	m_pDevice = new Device(m_vkDevice, m_vkPhysicalDevice, extensionNames, &enabledFeatures);
+	m_pCommandPool = new CommandPool(m_vkDevice, m_queueFamilyIndex);
+
+	VkFenceCreateInfo fenceCreateInfo{};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	if (vkCreateFence(m_vkDevice, &fenceCreateInfo, nullptr, &m_vkFence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create fence!");
+	}
+
+	std::cout << "device: " << m_pDevice->getProperties().deviceName << '\n';
+}
+
+BenchContext::~BenchContext()
+{
+	vkDeviceWaitIdle(m_vkDevice);
+	vkDestroyFence(m_vkDevice, m_vkFence, nullptr);
+	delete m_pCommandPool;
+	delete m_pDevice;
+	vkDestroyDevice(m_vkDevice, nullptr);
+	vkDestroyInstance(m_vkInstance, nullptr);
+}
+
+double BenchContext::submitAndWait(VkCommandBuffer cmdBuffer)
+{
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &cmdBuffer;
+
+	auto start = std::chrono::steady_clock::now();
+	if (vkQueueSubmit(m_vkQueue, 1, &submitInfo, m_vkFence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to submit command buffer!");
+	}
+	vkWaitForFences(m_vkDevice, 1, &m_vkFence, VK_TRUE, UINT64_MAX);
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	vkResetFences(m_vkDevice, 1, &m_vkFence);
+	return elapsedMs;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "vulkan/Device.h"
+#include "CommandPool.h"
+#include <vector>
+
+// Headless device for the benchmarks: the first physical device and its first
+// graphics queue family, no window, surface or validation layers. Optional
+// device extensions are enabled when the device supports them.
+class BenchContext
+{
+public:
+	explicit BenchContext(const std::vector<const char*>& optionalExtensions = {});
+	~BenchContext();
+
+	BenchContext(const BenchContext&) = delete;
+	BenchContext& operator=(const BenchContext&) = delete;
+
+	Device& getDevice()
+	{
+		return *m_pDevice;
+	}
+
+	VkQueue getQueue()const
+	{
+		return m_vkQueue;
+	}
+
+	uint32_t getQueueFamilyIndex()const
+	{
+		return m_queueFamilyIndex;
+	}
+
+	// for the queue family of getQueue(), command buffers can be reset individually
+	CommandPool& getCommandPool()
+	{
+		return *m_pCommandPool;
+	}
+
+	// submits cmdBuffer to the queue and blocks until it has executed, returns the elapsed milliseconds
+	double submitAndWait(VkCommandBuffer cmdBuffer);
+
+private:
+	VkInstance       m_vkInstance = VK_NULL_HANDLE;
+	VkPhysicalDevice m_vkPhysicalDevice = VK_NULL_HANDLE;
+	VkDevice         m_vkDevice = VK_NULL_HANDLE;
+	VkQueue          m_vkQueue = VK_NULL_HANDLE;
+	uint32_t         m_queueFamilyIndex = 0;
+	Device*          m_pDevice = nullptr;
+	CommandPool*     m_pCommandPool = nullptr;
+	VkFence          m_vkFence = VK_NULL_HANDLE;
+};
\ No newline at end of file
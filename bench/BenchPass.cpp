@@ -0,0 +1,340 @@
+#include "BenchPass.h"
+#include "BenchContext.h"
+#include "Mesh.h"
+#include "commands/CommandStream.h"
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <random>
+
+static VkShaderModule loadShaderModule(VkDevice device, const std::string& filePath)
+{
+	std::ifstream file(filePath.c_str(), std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+		throw std::runtime_error("failed to open:" + filePath);
+
+	std::vector<char> byteCode((std::size_t)file.tellg());
+	file.seekg(0);
+	file.read(byteCode.data(), byteCode.size());
+
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = byteCode.size();
+	createInfo.pCode = (const uint32_t*)byteCode.data();
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create shader module");
+	}
+	return shaderModule;
+}
+
+BenchPass::BenchPass(BenchContext& context, const std::string& shaderDir, VkExtent2D extent)
+	:m_device(context.getDevice()), m_extent(extent)
+{
+	m_pTarget = std::make_unique<OffscreenTarget>(m_device, m_extent, VK_FORMAT_R8G8B8A8_UNORM, 1);
+	createRenderPass();
+	createDescriptorSet();
+	createPipeline(shaderDir);
+	createGeometry();
+	setInstanceCount(1);
+}
+
+BenchPass::~BenchPass()
+{
+	m_device.destroyBuffer(m_instanceBuffer);
+	m_device.destroyBuffer(m_indexBuffer);
+	m_device.destroyBuffer(m_vertexBuffer);
+	m_device.destroyBuffer(m_uniformBuffer);
+	vkDestroyDescriptorPool(m_device, m_vkDescriptorPool, nullptr);
+	vkDestroyPipeline(m_device, m_vkPipeline, nullptr);
+	vkDestroyPipelineLayout(m_device, m_vkPipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_device, m_vkSetLayout, nullptr);
+	vkDestroyFramebuffer(m_device, m_vkFramebuffer, nullptr);
+	vkDestroyRenderPass(m_device, m_vkRenderPass, nullptr);
+}
+
+void BenchPass::createRenderPass()
+{
+	VkAttachmentDescription colorAttachment{};
+	colorAttachment.format = m_pTarget->getFormat();
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference attachmentRef{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &attachmentRef;
+
+	// the previous run's writes to the image finish before this one clears it
+	VkSubpassDependency dependency{};
+	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.dstSubpass = 0;
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	VkRenderPassCreateInfo renderPassCreateInfo{};
+	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassCreateInfo.attachmentCount = 1;
+	renderPassCreateInfo.pAttachments = &colorAttachment;
+	renderPassCreateInfo.subpassCount = 1;
+	renderPassCreateInfo.pSubpasses = &subpass;
+	renderPassCreateInfo.dependencyCount = 1;
+	renderPassCreateInfo.pDependencies = &dependency;
+	if (vkCreateRenderPass(m_device, &renderPassCreateInfo, nullptr, &m_vkRenderPass) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create render pass!");
+	}
+
+	VkFramebufferCreateInfo framebufferCreateInfo{};
+	framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferCreateInfo.renderPass = m_vkRenderPass;
+	framebufferCreateInfo.attachmentCount = 1;
+	framebufferCreateInfo.pAttachments = &m_pTarget->getImageViews()[0];
+	framebufferCreateInfo.width = m_extent.width;
+	framebufferCreateInfo.height = m_extent.height;
+	framebufferCreateInfo.layers = 1;
+	if (vkCreateFramebuffer(m_device, &framebufferCreateInfo, nullptr, &m_vkFramebuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create framebuffer!");
+	}
+}
+
+void BenchPass::createDescriptorSet()
+{
+	VkDescriptorSetLayoutBinding binding{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr };
+	VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo{};
+	setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutCreateInfo.bindingCount = 1;
+	setLayoutCreateInfo.pBindings = &binding;
+	if (vkCreateDescriptorSetLayout(m_device, &setLayoutCreateInfo, nullptr, &m_vkSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 };
+	VkDescriptorPoolCreateInfo poolCreateInfo{};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = 1;
+	poolCreateInfo.poolSizeCount = 1;
+	poolCreateInfo.pPoolSizes = &poolSize;
+	if (vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &m_vkDescriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = m_vkDescriptorPool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &m_vkSetLayout;
+	if (vkAllocateDescriptorSets(m_device, &allocateInfo, &m_vkDescriptorSet) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate descriptor set!");
+	}
+
+	// FrameUniforms in shader.vert, an unrotated scene
+	const float rotation[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+	m_uniformBuffer = m_device.createBuffer(sizeof(rotation), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	std::memcpy(m_uniformBuffer.allocation.pMapped, rotation, sizeof(rotation));
+
+	VkDescriptorBufferInfo bufferInfo{ m_uniformBuffer.buffer, 0, sizeof(rotation) };
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_vkDescriptorSet;
+	write.dstBinding = 0;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+}
+
+void BenchPass::createPipeline(const std::string& shaderDir)
+{
+	VkPushConstantRange pushConstantRange{ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawConstants) };
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &m_vkSetLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+	if (vkCreatePipelineLayout(m_device, &pipelineLayoutCreateInfo, nullptr, &m_vkPipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+
+	VkShaderModule vsModule = loadShaderModule(m_device, shaderDir + "/vert.spv");
+	VkShaderModule fsModule = loadShaderModule(m_device, shaderDir + "/frag.spv");
+	VkPipelineShaderStageCreateInfo stages[2]{};
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].module = vsModule;
+	stages[0].pName = "main";
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].module = fsModule;
+	stages[1].pName = "main";
+
+	// the same vertex input as the demo's pipeline
+	VertexLayout vertexLayout = Mesh::getVertexLayout();
+	InstanceBatcher::addInstanceAttributes(vertexLayout, 2);
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+	for (auto& binding : vertexLayout.bindings)
+	{
+		bindingDescriptions.push_back({ binding.binding, binding.stride, binding.inputRate });
+	}
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+	for (auto& attribute : vertexLayout.attributes)
+	{
+		attributeDescriptions.push_back({ attribute.location, attribute.binding, attribute.format, attribute.offset });
+	}
+
+	VkPipelineVertexInputStateCreateInfo vertexInputState{};
+	vertexInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertexInputState.vertexBindingDescriptionCount = (uint32_t)bindingDescriptions.size();
+	vertexInputState.pVertexBindingDescriptions = bindingDescriptions.data();
+	vertexInputState.vertexAttributeDescriptionCount = (uint32_t)attributeDescriptions.size();
+	vertexInputState.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyState{};
+	inputAssemblyState.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkPipelineViewportStateCreateInfo viewportState{};
+	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportState.viewportCount = 1;
+	viewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rasterizationState{};
+	rasterizationState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizationState.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizationState.cullMode = VK_CULL_MODE_NONE;
+	rasterizationState.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizationState.lineWidth = 1.0f;
+
+	VkPipelineMultisampleStateCreateInfo multisampleState{};
+	multisampleState.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampleState.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampleState.minSampleShading = 1.0f;
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	VkPipelineColorBlendStateCreateInfo colorBlendState{};
+	colorBlendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colorBlendState.logicOp = VK_LOGIC_OP_COPY;
+	colorBlendState.attachmentCount = 1;
+	colorBlendState.pAttachments = &colorBlendAttachment;
+
+	VkDynamicState dynamicStates[2]{ VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicState{};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
+
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo{};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stageCount = 2;
+	pipelineCreateInfo.pStages = stages;
+	pipelineCreateInfo.pVertexInputState = &vertexInputState;
+	pipelineCreateInfo.pInputAssemblyState = &inputAssemblyState;
+	pipelineCreateInfo.pViewportState = &viewportState;
+	pipelineCreateInfo.pRasterizationState = &rasterizationState;
+	pipelineCreateInfo.pMultisampleState = &multisampleState;
+	pipelineCreateInfo.pColorBlendState = &colorBlendState;
+	pipelineCreateInfo.pDynamicState = &dynamicState;
+	pipelineCreateInfo.layout = m_vkPipelineLayout;
+	pipelineCreateInfo.renderPass = m_vkRenderPass;
+	pipelineCreateInfo.subpass = 0;
+	pipelineCreateInfo.basePipelineIndex = -1;
+	VkResult result = vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &m_vkPipeline);
+
+	vkDestroyShaderModule(m_device, vsModule, nullptr);
+	vkDestroyShaderModule(m_device, fsModule, nullptr);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create graphics pipeline!");
+	}
+}
+
+void BenchPass::createGeometry()
+{
+	std::vector<Mesh::Vertex> vertices;
+	std::vector<uint32_t> indices;
+	Mesh::createTriangle(vertices, indices);
+	m_indexCnt = (uint32_t)indices.size();
+
+	VkDeviceSize vertexBytes = sizeof(Mesh::Vertex) * vertices.size();
+	m_vertexBuffer = m_device.createBuffer(vertexBytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	std::memcpy(m_vertexBuffer.allocation.pMapped, vertices.data(), vertexBytes);
+
+	VkDeviceSize indexBytes = sizeof(uint32_t) * indices.size();
+	m_indexBuffer = m_device.createBuffer(indexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	std::memcpy(m_indexBuffer.allocation.pMapped, indices.data(), indexBytes);
+}
+
+void BenchPass::setInstanceCount(uint32_t instanceCnt)
+{
+	if (instanceCnt <= m_instanceCnt)
+		return;
+
+	if (m_instanceBuffer.buffer != VK_NULL_HANDLE)
+	{
+		m_device.destroyBuffer(m_instanceBuffer);
+	}
+	m_instanceBuffer = m_device.createBuffer(sizeof(InstanceData) * instanceCnt, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	m_instanceCnt = instanceCnt;
+
+	// a fixed seed keeps the image, and with it the fill cost, identical between runs
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> position(-0.9f, 0.9f);
+	auto pInstances = static_cast<InstanceData*>(m_instanceBuffer.allocation.pMapped);
+	for (uint32_t i = 0; i < instanceCnt; ++i)
+	{
+		pInstances[i] = InstanceData{ { position(rng), position(rng), 0.02f, 0.0f } };
+	}
+}
+
+void BenchPass::begin(VkCommandBuffer cmdBuffer)
+{
+	VkClearValue clearValue{};
+	VkRenderPassBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	beginInfo.renderPass = m_vkRenderPass;
+	beginInfo.framebuffer = m_vkFramebuffer;
+	beginInfo.renderArea.extent = m_extent;
+	beginInfo.clearValueCount = 1;
+	beginInfo.pClearValues = &clearValue;
+	vkCmdBeginRenderPass(cmdBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+void BenchPass::end(VkCommandBuffer cmdBuffer)
+{
+	vkCmdEndRenderPass(cmdBuffer);
+}
+
+void BenchPass::bindState(CommandStream& stream)const
+{
+	VkViewport viewport{ 0.0f, 0.0f, (float)m_extent.width, (float)m_extent.height, 0.0f, 1.0f };
+	VkRect2D scissor{ { 0, 0 }, m_extent };
+	stream.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipeline);
+	stream.setViewport(&viewport, 1);
+	stream.setScissor(&scissor, 1);
+	stream.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, m_vkPipelineLayout, 0, &m_vkDescriptorSet, 1);
+
+	VkBuffer vertexBuffers[2]{ m_vertexBuffer.buffer, m_instanceBuffer.buffer };
+	static_assert(InstanceBatcher::InstanceBinding == 1, "the instance buffer is bound right after the vertex buffer");
+	stream.bindVertexBuffers(vertexBuffers, nullptr, 2);
+	stream.bindIndexBuffer(m_indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include "vulkan/Device.h"
+#include "OffscreenTarget.h"
+#include "InstanceBatcher.h"
+#include <string>
+#include <memory>
+class BenchContext;
+class CommandStream;
+
+// A render pass into a small offscreen image with the demo's pipeline
+// (shader.vert/shader.frag, the triangle at binding 0, InstanceData at
+// InstanceBinding, a 16 byte push constant), so benchmarks can record and
+// execute real draws without a window. Everything lives in host visible
+// memory, which keeps the setup free of uploads.
+class BenchPass
+{
+public:
+	// matches DrawConstants in shader.vert
+	struct DrawConstants final
+	{
+		float offsetScale[4];
+	};
+
+	BenchPass(BenchContext& context, const std::string& shaderDir, VkExtent2D extent = { 256, 256 });
+	~BenchPass();
+
+	BenchPass(const BenchPass&) = delete;
+	BenchPass& operator=(const BenchPass&) = delete;
+
+	void begin(VkCommandBuffer cmdBuffer);
+	void end(VkCommandBuffer cmdBuffer);
+
+	// pipeline, viewport, scissor, the uniform set and the triangle's buffers with the instance buffer
+	void bindState(CommandStream& stream)const;
+
+	// grows the instance buffer to instanceCnt instances scattered over the image,
+	// small enough that the draws cost vertex work rather than fill rate. Replaces
+	// the buffer, so nothing recorded with the old one may still be executing
+	void setInstanceCount(uint32_t instanceCnt);
+
+	VkPipeline getPipeline()const
+	{
+		return m_vkPipeline;
+	}
+
+	VkPipelineLayout getPipelineLayout()const
+	{
+		return m_vkPipelineLayout;
+	}
+
+	VkDescriptorSet getDescriptorSet()const
+	{
+		return m_vkDescriptorSet;
+	}
+
+	VkBuffer getVertexBuffer()const
+	{
+		return m_vertexBuffer.buffer;
+	}
+
+	VkBuffer getIndexBuffer()const
+	{
+		return m_indexBuffer.buffer;
+	}
+
+	VkBuffer getInstanceBuffer()const
+	{
+		return m_instanceBuffer.buffer;
+	}
+
+	uint32_t getIndexCount()const
+	{
+		return m_indexCnt;
+	}
+
+	VkExtent2D getExtent()const
+	{
+		return m_extent;
+	}
+
+private:
+	void createRenderPass();
+	void createPipeline(const std::string& shaderDir);
+	void createDescriptorSet();
+	void createGeometry();
+
+private:
+	Device&               m_device;
+	VkExtent2D            m_extent;
+	std::unique_ptr<OffscreenTarget> m_pTarget;
+	VkRenderPass          m_vkRenderPass = VK_NULL_HANDLE;
+	VkFramebuffer         m_vkFramebuffer = VK_NULL_HANDLE;
+	VkDescriptorSetLayout m_vkSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout      m_vkPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline            m_vkPipeline = VK_NULL_HANDLE;
+	VkDescriptorPool      m_vkDescriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet       m_vkDescriptorSet = VK_NULL_HANDLE;
+	AllocatedBuffer       m_uniformBuffer;
+	AllocatedBuffer       m_vertexBuffer;
+	AllocatedBuffer       m_indexBuffer;
+	AllocatedBuffer       m_instanceBuffer;
+	uint32_t              m_indexCnt = 0;
+	uint32_t              m_instanceCnt = 0;
+};
\ No newline at end of file
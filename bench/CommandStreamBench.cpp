@@ -0,0 +1,148 @@
+// CommandStream against the virtual Command objects the demo recorded before,
+// for the same command mix: the pass state once, then a push constant and an
+// indexed draw per object. Build is encoding the frame's commands, record is
+// replaying them into a command buffer inside a render pass. The command
+// buffer is never submitted, so only the CPU side is measured.
+#include "Bench.h"
+#include "BenchContext.h"
+#include "BenchPass.h"
+#include "CommandBuffer.h"
+#include "commands/CommandStream.h"
+#include "commands/SetViewport.h"
+#include "commands/SetScissor.h"
+#include "commands/BindDescriptorSets.h"
+#include "commands/BindVertexBuffers.h"
+#include "commands/BindIndexBuffer.h"
+#include "commands/DrawIndexed.h"
+#include "commands/PushConstants.h"
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+// the split ParallelCommandRecorder would make with this many workers
+static const uint32_t s_rangeCnt = 8;
+
+static BenchPass::DrawConstants getDrawConstants(uint32_t objectIndex)
+{
+	// a different value per object, so neither path can skip redundant pushes
+	float offset = (float)(objectIndex % 64) / 64.0f - 0.5f;
+	return BenchPass::DrawConstants{ { offset, -offset, 1.0f, 0.0f } };
+}
+
+static void buildStream(CommandStream& stream, const BenchPass& pass, uint32_t objectCnt)
+{
+	stream.reset();
+	pass.bindState(stream);
+	for (uint32_t i = 0; i < objectCnt; ++i)
+	{
+		stream.pushConstants(pass.getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, getDrawConstants(i));
+		stream.drawIndexed(pass.getIndexCount(), 0, 0, 1, i);
+	}
+}
+
+static void buildCommands(std::vector<std::shared_ptr<Command>>& commands, const BenchPass& pass, uint32_t objectCnt)
+{
+	commands.clear();
+	VkExtent2D extent = pass.getExtent();
+	commands.push_back(std::make_shared<SetViewport>(std::vector<VkViewport>{ { 0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f } }));
+	commands.push_back(std::make_shared<SetScissor>(std::vector<VkRect2D>{ { { 0, 0 }, extent } }));
+	commands.push_back(std::make_shared<BindDescriptorSets>(VK_PIPELINE_BIND_POINT_GRAPHICS, pass.getPipelineLayout(),
+		std::vector<VkDescriptorSet>{ pass.getDescriptorSet() }));
+	commands.push_back(std::make_shared<BindVertexBuffers>(std::vector<VkBuffer>{ pass.getVertexBuffer(), pass.getInstanceBuffer() },
+		std::vector<VkDeviceSize>{ 0, 0 }));
+	commands.push_back(std::make_shared<BindIndexBuffer>(pass.getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32));
+	for (uint32_t i = 0; i < objectCnt; ++i)
+	{
+		commands.push_back(std::make_shared<PushConstants<BenchPass::DrawConstants>>(pass.getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, getDrawConstants(i)));
+		commands.push_back(std::make_shared<DrawIndexed>(pass.getIndexCount(), 0, 0, 1, i));
+	}
+}
+
+static void beginCommandBuffer(VkCommandBuffer cmdBuffer)
+{
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (vkBeginCommandBuffer(cmdBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to begin recording command buffer!");
+	}
+}
+
+static void report(const char* pLabel, uint32_t commandCnt, double ms)
+{
+	std::cout << "\t" << pLabel << ms << " ms, " << perSecond(commandCnt, ms) / 1e6 << " M commands/s\n";
+}
+
+void benchCommandStream(BenchContext& context, const BenchSettings& settings)
+{
+	BenchPass pass(context, settings.shaderDir);
+	auto cmdBuffer = context.getCommandPool().allocate();
+
+	CommandStream stream;
+	std::vector<std::shared_ptr<Command>> commands;
+	for (uint32_t commandCnt : { 10000u, 100000u })
+	{
+		// two commands per object, the few state commands in front are noise at these counts
+		uint32_t objectCnt = commandCnt / 2;
+		pass.setInstanceCount(objectCnt);
+
+		double streamBuildMs = measureBestMs(settings.repeats, [&]() { buildStream(stream, pass, objectCnt); });
+		double streamRecordMs = measureBestMs(settings.repeats, [&]()
+		{
+			beginCommandBuffer(*cmdBuffer);
+			pass.begin(*cmdBuffer);
+			stream.record(*cmdBuffer);
+			pass.end(*cmdBuffer);
+			vkEndCommandBuffer(*cmdBuffer);
+		});
+
+		// what ParallelCommandRecorder does per frame, serialized: one snapshot pass, then every
+		// range replays its snapshot's state and its own draws instead of the whole prefix
+		uint32_t firstDraws[s_rangeCnt];
+		CommandStream::StateSnapshot snapshots[s_rangeCnt];
+		double rangeRecordMs = measureBestMs(settings.repeats, [&]()
+		{
+			for (uint32_t i = 0; i < s_rangeCnt; ++i)
+			{
+				firstDraws[i] = stream.getDrawCount() * i / s_rangeCnt;
+			}
+			stream.takeSnapshots(firstDraws, s_rangeCnt, snapshots);
+			beginCommandBuffer(*cmdBuffer);
+			pass.begin(*cmdBuffer);
+			for (uint32_t i = 0; i < s_rangeCnt; ++i)
+			{
+				uint32_t endDraw = (i + 1 < s_rangeCnt) ? firstDraws[i + 1] : stream.getDrawCount();
+				stream.record(*cmdBuffer, snapshots[i], endDraw - firstDraws[i]);
+			}
+			pass.end(*cmdBuffer);
+			vkEndCommandBuffer(*cmdBuffer);
+		});
+
+		double virtualBuildMs = measureBestMs(settings.repeats, [&]() { buildCommands(commands, pass, objectCnt); });
+		double virtualRecordMs = measureBestMs(settings.repeats, [&]()
+		{
+			beginCommandBuffer(*cmdBuffer);
+			pass.begin(*cmdBuffer);
+			// the virtual path has no bind pipeline command, the pipeline is bound directly as the demo used to
+			vkCmdBindPipeline(*cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pass.getPipeline());
+			for (auto& command : commands)
+			{
+				command->record(*cmdBuffer);
+			}
+			pass.end(*cmdBuffer);
+			vkEndCommandBuffer(*cmdBuffer);
+		});
+
+		std::cout << commandCnt << " commands (" << stream.getByteSize() / 1024 << " KiB stream)\n";
+		report("stream build:    ", commandCnt, streamBuildMs);
+		report("stream record:   ", commandCnt, streamRecordMs);
+		report("stream ranges:   ", commandCnt, rangeRecordMs);
+		std::cout << "\t\t" << s_rangeCnt << " ranges, " << snapshots[s_rangeCnt - 1].stateOffsets.size() << " state commands replayed in front of the last\n";
+		report("virtual build:   ", commandCnt, virtualBuildMs);
+		report("virtual record:  ", commandCnt, virtualRecordMs);
+		std::cout << "\tbuild + record speedup " << (virtualBuildMs + virtualRecordMs) / (streamBuildMs + streamRecordMs) << "x\n";
+	}
+	commands.clear();
+	cmdBuffer->reset();
+}
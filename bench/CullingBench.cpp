@@ -0,0 +1,65 @@
+// SceneBvh culling of 1M small boxes scattered like the demo's instances,
+// against views covering a growing share of the scene, on the calling thread
+// and with worker threads. A linear scan over every box is the baseline the
+// hierarchy has to beat.
+#include "Bench.h"
+#include "SceneBvh.h"
+#include <iostream>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+void benchCulling(BenchContext& /*context*/, const BenchSettings& settings)
+{
+	const uint32_t boxCnt = settings.quick ? 100000 : 1000000;
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+	std::vector<Aabb2D> bounds(boxCnt);
+	for (auto& box : bounds)
+	{
+		float x = position(rng);
+		float y = position(rng);
+		box = Aabb2D{ { x - 0.002f, y - 0.002f }, { x + 0.002f, y + 0.002f } };
+	}
+
+	uint32_t threadCnt = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	std::unique_ptr<SceneBvh> pSingle;
+	double buildMs = measureBestMs(1, [&]() { pSingle = std::make_unique<SceneBvh>(bounds); });
+	SceneBvh parallel(bounds, threadCnt);
+	std::cout << boxCnt << " boxes, " << pSingle->getNodeCount() << " nodes built in " << buildMs << " ms, box test "
+		<< SceneBvh::getSimdName() << '\n';
+
+	std::vector<uint32_t> visible;
+	visible.reserve(boxCnt);
+	for (float extent : { 0.1f, 0.5f, 1.0f })
+	{
+		Aabb2D view{ { -extent, -extent }, { extent, extent } };
+		double linearMs = measureBestMs(settings.repeats, [&]()
+		{
+			visible.clear();
+			for (uint32_t i = 0; i < boxCnt; ++i)
+			{
+				auto& box = bounds[i];
+				if (box.min[0] <= view.max[0] && box.max[0] >= view.min[0] && box.min[1] <= view.max[1] && box.max[1] >= view.min[1])
+				{
+					visible.push_back(i);
+				}
+			}
+		});
+		std::size_t expectedCnt = visible.size();
+		double singleMs = measureBestMs(settings.repeats, [&]() { pSingle->cull(view, visible); });
+		std::size_t singleCnt = visible.size();
+		double parallelMs = measureBestMs(settings.repeats, [&]() { parallel.cull(view, visible); });
+		if (singleCnt != expectedCnt || visible.size() != expectedCnt)
+		{
+			throw std::runtime_error("culling bench: SceneBvh disagrees with the linear scan!");
+		}
+
+		std::cout << "view " << extent * extent * 100.0f << "% of the scene, " << expectedCnt << " visible: linear "
+			<< linearMs << " ms, bvh " << singleMs << " ms (" << perSecond(boxCnt, singleMs) / 1e6 << " M boxes/s), "
+			<< parallel.getThreadCount() + 1 << " threads " << parallelMs << " ms (" << perSecond(boxCnt, parallelMs) / 1e6
+			<< " M boxes/s)\n";
+	}
+}
@@ -0,0 +1,98 @@
+// DescriptorAllocator under 100k transient sets per frame: the allocation
+// rate once the frame pools have grown, the cost of resetting them in
+// beginFrame(), and lookups of persistent sets by content. Nothing is
+// submitted, the sets are allocated and written but never bound.
+#include "Bench.h"
+#include "BenchContext.h"
+#include "DescriptorAllocator.h"
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+
+void benchDescriptors(BenchContext& context, const BenchSettings& settings)
+{
+	VkDevice device = context.getDevice();
+	const uint32_t framesInFlight = 2;
+	const uint32_t setsPerFrame = settings.quick ? 10000 : 100000;
+
+	VkDescriptorSetLayoutBinding binding{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr };
+	VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo{};
+	setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutCreateInfo.bindingCount = 1;
+	setLayoutCreateInfo.pBindings = &binding;
+	VkDescriptorSetLayout setLayout;
+	if (vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr, &setLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor set layout!");
+	}
+
+	// one uniform buffer, each set points at its own 256 byte slice like per object uniforms would
+	const VkDeviceSize sliceSize = 256;
+	const uint32_t sliceCnt = 1024;
+	AllocatedBuffer uniforms = context.getDevice().createBuffer(sliceSize * sliceCnt, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+	std::vector<VkDescriptorSet> sets(setsPerFrame);
+	std::vector<DescriptorWrite> writes(1);
+	{
+		DescriptorAllocator allocator(device, framesInFlight);
+		// the first frame of each slot grows its pool chain, measure the frames after that
+		for (uint32_t frame = 0; frame < framesInFlight; ++frame)
+		{
+			allocator.beginFrame(frame);
+			allocator.allocateTransient(setLayout, setsPerFrame, sets.data());
+		}
+
+		uint32_t frame = 0;
+		double batchMs = measureBestMs(settings.repeats, [&]()
+		{
+			allocator.beginFrame(frame++ % framesInFlight);
+			allocator.allocateTransient(setLayout, setsPerFrame, sets.data());
+		});
+		double singleMs = measureBestMs(settings.repeats, [&]()
+		{
+			allocator.beginFrame(frame++ % framesInFlight);
+			for (uint32_t i = 0; i < setsPerFrame; ++i)
+			{
+				sets[i] = allocator.allocateTransient(setLayout);
+			}
+		});
+		double writeMs = measureBestMs(settings.repeats, [&]()
+		{
+			allocator.beginFrame(frame++ % framesInFlight);
+			allocator.allocateTransient(setLayout, setsPerFrame, sets.data());
+			for (uint32_t i = 0; i < setsPerFrame; ++i)
+			{
+				writes[0] = DescriptorWrite::makeBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniforms.buffer, (i % sliceCnt) * sliceSize, sliceSize);
+				DescriptorAllocator::write(device, sets[i], writes);
+			}
+		});
+
+		auto& stats = allocator.getStats();
+		std::cout << setsPerFrame << " transient sets per frame, " << stats.poolCnt << " pools\n"
+			<< "\tone call per frame:  " << batchMs << " ms, " << perSecond(setsPerFrame, batchMs) / 1e6 << " M sets/s\n"
+			<< "\tone call per set:    " << singleMs << " ms, " << perSecond(setsPerFrame, singleMs) / 1e6 << " M sets/s\n"
+			<< "\tallocate and write:  " << writeMs << " ms, " << perSecond(setsPerFrame, writeMs) / 1e6 << " M sets/s\n"
+			<< "\tpool reset:          " << stats.resetMs / std::max<uint64_t>(stats.resetCnt, 1) << " ms avg over " << stats.resetCnt << " frames\n";
+	}
+
+	{
+		// the same sliceCnt distinct contents asked for over and over, all but the first round hit the cache
+		DescriptorAllocator allocator(device, framesInFlight);
+		double persistentMs = measureBestMs(settings.repeats, [&]()
+		{
+			for (uint32_t i = 0; i < setsPerFrame; ++i)
+			{
+				writes[0] = DescriptorWrite::makeBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniforms.buffer, (i % sliceCnt) * sliceSize, sliceSize);
+				sets[i] = allocator.getPersistent(setLayout, writes);
+			}
+		});
+		auto& stats = allocator.getStats();
+		std::cout << "\tpersistent lookups:  " << persistentMs << " ms, " << perSecond(setsPerFrame, persistentMs) / 1e6 << " M lookups/s, "
+			<< stats.persistentHits << " hits, " << stats.persistentMisses << " misses\n";
+	}
+
+	context.getDevice().destroyBuffer(uniforms);
+	vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+}
@@ -0,0 +1,60 @@
+// Throughput of individual indexed draws, each its own vkCmdDrawIndexed of the
+// demo's triangle with a push constant in front, recorded through a
+// CommandStream and executed. Recording and execution are reported separately,
+// draws/s is over both since that is what a frame pays.
+#include "Bench.h"
+#include "BenchContext.h"
+#include "BenchPass.h"
+#include "CommandBuffer.h"
+#include "commands/CommandStream.h"
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+
+void benchDrawCalls(BenchContext& context, const BenchSettings& settings)
+{
+	BenchPass pass(context, settings.shaderDir);
+	auto cmdBuffer = context.getCommandPool().allocate();
+	CommandStream stream;
+
+	for (uint32_t drawCnt : { 1000u, 10000u, 100000u })
+	{
+		if (settings.quick && drawCnt > 10000)
+			break;
+
+		pass.setInstanceCount(drawCnt);
+		stream.reset();
+		pass.bindState(stream);
+		for (uint32_t i = 0; i < drawCnt; ++i)
+		{
+			// each draw picks its own instance, so every triangle lands somewhere else
+			stream.pushConstants(pass.getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, BenchPass::DrawConstants{ { 0.0f, 0.0f, 1.0f, 0.0f } });
+			stream.drawIndexed(pass.getIndexCount(), 0, 0, 1, i);
+		}
+
+		// best of the runs for each half separately
+		double recordMs = 0.0, executeMs = 0.0;
+		for (uint32_t run = 0; run < std::max(settings.repeats, 1u); ++run)
+		{
+			double runRecordMs = measureBestMs(1, [&]()
+			{
+				VkCommandBufferBeginInfo beginInfo{};
+				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+				if (vkBeginCommandBuffer(*cmdBuffer, &beginInfo) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to begin recording command buffer!");
+				}
+				pass.begin(*cmdBuffer);
+				stream.record(*cmdBuffer);
+				pass.end(*cmdBuffer);
+				vkEndCommandBuffer(*cmdBuffer);
+			});
+			double runExecuteMs = context.submitAndWait(*cmdBuffer);
+			recordMs = (run == 0) ? runRecordMs : std::min(recordMs, runRecordMs);
+			executeMs = (run == 0) ? runExecuteMs : std::min(executeMs, runExecuteMs);
+		}
+		std::cout << drawCnt << " draws: " << recordMs << " ms recording, " << executeMs << " ms executing, "
+			<< perSecond(drawCnt, recordMs + executeMs) / 1e6 << " M draws/s\n";
+	}
+}
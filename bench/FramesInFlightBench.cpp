@@ -0,0 +1,92 @@
+// Frame time with 1, 2 and 3 frames in flight, the way the demo's frame loop
+// runs them: each frame builds its CommandStream on the CPU, waits for the
+// submission that last used its slot, records the slot's command buffer and
+// submits it. With one slot the CPU builds the next frame only after the GPU
+// has finished the previous one; more slots let the two overlap, which shows
+// up as less time blocked in the wait.
+#include "Bench.h"
+#include "BenchContext.h"
+#include "BenchPass.h"
+#include "CommandBuffer.h"
+#include "FrameScheduler.h"
+#include "commands/CommandStream.h"
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <algorithm>
+
+void benchFramesInFlight(BenchContext& context, const BenchSettings& settings)
+{
+	const uint32_t drawCnt = settings.quick ? 2000 : 20000;
+	const uint32_t frameCnt = settings.quick ? 20 : 100;
+
+	BenchPass pass(context, settings.shaderDir);
+	pass.setInstanceCount(drawCnt);
+	FrameScheduler scheduler(context.getDevice());
+	FrameScheduler::QueueId queue = scheduler.addQueue(context.getQueue());
+	CommandStream stream;
+
+	double singleFrameMs = 0.0;
+	for (uint32_t slotCnt = 1; slotCnt <= 3; ++slotCnt)
+	{
+		std::vector<std::shared_ptr<CommandBuffer>> cmdBuffers;
+		for (uint32_t i = 0; i < slotCnt; ++i)
+		{
+			cmdBuffers.push_back(context.getCommandPool().allocate());
+		}
+		std::vector<uint64_t> slotValues(slotCnt, 0);
+
+		// best of the runs, each a sequence of frameCnt frames drained at the end
+		double frameMs = 0.0, waitMs = 0.0;
+		for (uint32_t run = 0; run < std::max(settings.repeats, 1u); ++run)
+		{
+			double runWaitMs = 0.0;
+			double runMs = measureBestMs(1, [&]()
+			{
+				for (uint32_t frame = 0; frame < frameCnt; ++frame)
+				{
+					stream.reset();
+					pass.bindState(stream);
+					for (uint32_t i = 0; i < drawCnt; ++i)
+					{
+						stream.pushConstants(pass.getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, BenchPass::DrawConstants{ { 0.0f, 0.0f, 1.0f, 0.0f } });
+						stream.drawIndexed(pass.getIndexCount(), 0, 0, 1, i);
+					}
+
+					uint32_t slot = frame % slotCnt;
+					runWaitMs += measureBestMs(1, [&]() { scheduler.wait(queue, slotValues[slot]); });
+
+					CommandBuffer& cmdBuffer = *cmdBuffers[slot];
+					VkCommandBufferBeginInfo beginInfo{};
+					beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+					beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+					if (vkBeginCommandBuffer(cmdBuffer, &beginInfo) != VK_SUCCESS)
+					{
+						throw std::runtime_error("failed to begin recording command buffer!");
+					}
+					pass.begin(cmdBuffer);
+					stream.record(cmdBuffer);
+					pass.end(cmdBuffer);
+					vkEndCommandBuffer(cmdBuffer);
+
+					VkCommandBuffer vkCmdBuffer = cmdBuffer;
+					FrameScheduler::Submit submit{};
+					submit.pCmdBuffers = &vkCmdBuffer;
+					submit.cmdBufferCnt = 1;
+					slotValues[slot] = scheduler.submit(queue, submit);
+				}
+				scheduler.waitIdle();
+			});
+			frameMs = (run == 0) ? runMs / frameCnt : std::min(frameMs, runMs / frameCnt);
+			waitMs = (run == 0) ? runWaitMs / frameCnt : std::min(waitMs, runWaitMs / frameCnt);
+		}
+
+		if (slotCnt == 1)
+		{
+			singleFrameMs = frameMs;
+		}
+		std::cout << slotCnt << " frames in flight, " << drawCnt << " draws: " << frameMs << " ms per frame, "
+			<< waitMs << " ms of it waiting for the GPU, " << perSecond(1.0, frameMs) << " frames/s, "
+			<< (frameMs > 0.0 ? singleFrameMs / frameMs : 0.0) << "x the single slot\n";
+	}
+}
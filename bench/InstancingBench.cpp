@@ -0,0 +1,90 @@
+// InstanceBatcher throughput from 1k to 1M instances of the demo's triangle:
+// the instances are added, flushed into the frame ring as one instanced draw,
+// recorded and executed. Reports the CPU side (add, flush and record) and the
+// execution separately, instances/s is over both.
+#include "Bench.h"
+#include "BenchContext.h"
+#include "BenchPass.h"
+#include "CommandBuffer.h"
+#include "FrameScheduler.h"
+#include "StagingUploader.h"
+#include "FrameRingBuffer.h"
+#include "InstanceBatcher.h"
+#include "Mesh.h"
+#include "commands/CommandStream.h"
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <algorithm>
+
+void benchInstancing(BenchContext& context, const BenchSettings& settings)
+{
+	Device& device = context.getDevice();
+	const uint32_t maxInstanceCnt = settings.quick ? 100000 : 1000000;
+
+	BenchPass pass(context, settings.shaderDir);
+	FrameScheduler scheduler(device);
+	scheduler.addQueue(context.getQueue());
+	StagingUploader uploader(device, scheduler, context.getQueue(), context.getQueueFamilyIndex(),
+		context.getQueue(), context.getQueueFamilyIndex());
+	std::vector<Mesh::Vertex> vertices;
+	std::vector<uint32_t> indices;
+	Mesh::createTriangle(vertices, indices);
+	Mesh mesh(device, uploader, vertices, indices);
+	uploader.waitIdle();
+
+	// a single frame slot, every run waits for its submission before the next beginFrame()
+	FrameRingBuffer frameRing(device, 1, sizeof(InstanceData) * maxInstanceCnt + 4096, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	InstanceBatcher batcher(frameRing);
+
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> position(-0.9f, 0.9f);
+	std::vector<InstanceData> instances(maxInstanceCnt);
+	for (auto& instance : instances)
+	{
+		instance = InstanceData{ { position(rng), position(rng), 0.02f, 0.0f } };
+	}
+
+	auto cmdBuffer = context.getCommandPool().allocate();
+	CommandStream stream;
+	for (uint32_t instanceCnt = 1000; instanceCnt <= maxInstanceCnt; instanceCnt *= 10)
+	{
+		double cpuMs = 0.0, executeMs = 0.0;
+		for (uint32_t run = 0; run < std::max(settings.repeats, 1u); ++run)
+		{
+			double runCpuMs = measureBestMs(1, [&]()
+			{
+				frameRing.beginFrame(0);
+				stream.reset();
+				pass.bindState(stream);
+				stream.pushConstants(pass.getPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, BenchPass::DrawConstants{ { 0.0f, 0.0f, 1.0f, 0.0f } });
+				batcher.add(mesh, instances.data(), instanceCnt);
+				batcher.flush(stream);
+				frameRing.flush();
+
+				VkCommandBufferBeginInfo beginInfo{};
+				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+				if (vkBeginCommandBuffer(*cmdBuffer, &beginInfo) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to begin recording command buffer!");
+				}
+				pass.begin(*cmdBuffer);
+				stream.record(*cmdBuffer);
+				pass.end(*cmdBuffer);
+				vkEndCommandBuffer(*cmdBuffer);
+			});
+			double runExecuteMs = context.submitAndWait(*cmdBuffer);
+			cpuMs = (run == 0) ? runCpuMs : std::min(cpuMs, runCpuMs);
+			executeMs = (run == 0) ? runExecuteMs : std::min(executeMs, runExecuteMs);
+		}
+		std::cout << instanceCnt << " instances in " << stream.getDrawCount() << " draw: " << cpuMs << " ms batching and recording, "
+			<< executeMs << " ms executing, " << perSecond(instanceCnt, cpuMs + executeMs) / 1e6 << " M instances/s\n";
+	}
+
+	auto& stats = batcher.getStats();
+	if (stats.droppedCnt != 0)
+	{
+		std::cout << "\t" << stats.droppedCnt << " instances dropped, the frame ring was too small\n";
+	}
+}
@@ -0,0 +1,147 @@
+// RenderGraph compile and execute cost, and a check of what compile() makes of
+// a graph with transients: a chain of transfer passes where the first and the
+// third transient never live at the same time and have to share a heap, plus
+// a debug pass nothing consumes. The aliased memory is verified by reading
+// the output back after the graph ran.
+#include "Bench.h"
+#include "BenchContext.h"
+#include "RenderGraph.h"
+#include "CommandBuffer.h"
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <cstring>
+
+static const VkDeviceSize s_transientSize = 256 * 1024;
+static const uint32_t s_firstValue = 0x11111111;
+static const uint32_t s_secondValue = 0x22222222;
+
+static void check(bool condition, const char* pMessage)
+{
+	if (!condition)
+		throw std::runtime_error(std::string("render graph check: ") + pMessage);
+}
+
+// Fill writes A, CopyAB reads A into B, FillC writes C once A is dead, the two copies
+// put B and C side by side into the output. Debug writes a transient nobody reads.
+static std::unique_ptr<RenderGraph> buildGraph(Device& device, VkBuffer output)
+{
+	auto pGraph = std::make_unique<RenderGraph>(device);
+	RenderGraph& graph = *pGraph;
+	ResourceAccess transferRead{ VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT };
+	ResourceAccess transferWrite{ VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT };
+	VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	auto a = graph.createBuffer("A", s_transientSize, usage);
+	auto b = graph.createBuffer("B", s_transientSize, usage);
+	auto c = graph.createBuffer("C", s_transientSize, usage);
+	auto debug = graph.createBuffer("Debug", s_transientSize, usage);
+	auto out = graph.importBuffer("Output", output);
+	graph.markOutput(out, { VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT });
+
+	auto fill = [&graph](RenderGraphResource resource, uint32_t value) {
+		return [&graph, resource, value](CommandBuffer& cmdBuffer) {
+			vkCmdFillBuffer(cmdBuffer, graph.getBuffer(resource), 0, VK_WHOLE_SIZE, value);
+		};
+	};
+	auto copy = [&graph](RenderGraphResource src, RenderGraphResource dst, VkDeviceSize dstOffset) {
+		return [&graph, src, dst, dstOffset](CommandBuffer& cmdBuffer) {
+			VkBufferCopy region{ 0, dstOffset, s_transientSize };
+			vkCmdCopyBuffer(cmdBuffer, graph.getBuffer(src), graph.getBuffer(dst), 1, &region);
+		};
+	};
+	graph.addPass("FillA", [&](RenderGraph::PassBuilder& builder) {
+		builder.write(a, transferWrite);
+	}, fill(a, s_firstValue));
+	graph.addPass("CopyAB", [&](RenderGraph::PassBuilder& builder) {
+		builder.read(a, transferRead);
+		builder.write(b, transferWrite);
+	}, copy(a, b, 0));
+	graph.addPass("FillC", [&](RenderGraph::PassBuilder& builder) {
+		builder.write(c, transferWrite);
+	}, fill(c, s_secondValue));
+	graph.addPass("Debug", [&](RenderGraph::PassBuilder& builder) {
+		builder.read(c, transferRead);
+		builder.write(debug, transferWrite);
+	}, copy(c, debug, 0));
+	graph.addPass("CopyB", [&](RenderGraph::PassBuilder& builder) {
+		builder.read(b, transferRead);
+		builder.write(out, transferWrite);
+	}, copy(b, out, 0));
+	graph.addPass("CopyC", [&](RenderGraph::PassBuilder& builder) {
+		builder.read(c, transferRead);
+		builder.write(out, transferWrite);
+	}, copy(c, out, s_transientSize));
+	graph.compile();
+	check(graph.getBuffer(debug) == VK_NULL_HANDLE, "the culled pass's transient was created");
+	return pGraph;
+}
+
+static void recordGraph(const RenderGraph& graph, CommandBuffer& cmdBuffer)
+{
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (vkBeginCommandBuffer(cmdBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to begin recording command buffer!");
+	}
+	graph.execute(cmdBuffer);
+	vkEndCommandBuffer(cmdBuffer);
+}
+
+void benchRenderGraph(BenchContext& context, const BenchSettings& settings)
+{
+	Device& device = context.getDevice();
+	auto output = device.createBuffer(2 * s_transientSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0);
+	auto cmdBuffer = context.getCommandPool().allocate();
+
+	std::unique_ptr<RenderGraph> pGraph;
+	double compileMs = measureBestMs(settings.repeats, [&]()
+	{
+		pGraph.reset();
+		pGraph = buildGraph(device, output.buffer);
+	});
+	const uint32_t executeCnt = 1000;
+	double executeMs = measureBestMs(settings.repeats, [&]()
+	{
+		for (uint32_t i = 0; i < executeCnt; ++i)
+		{
+			recordGraph(*pGraph, *cmdBuffer);
+		}
+	});
+
+	// A and C share a heap, so the memory saved is one transient's worth
+	VkMemoryRequirements requirements{};
+	{
+		auto probe = device.createBuffer(s_transientSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0);
+		vkGetBufferMemoryRequirements(device, probe.buffer, &requirements);
+		device.destroyBuffer(probe);
+	}
+	auto& stats = pGraph->getStats();
+	check(stats.passCnt == 5 && stats.culledPassCnt == 1, "expected 5 passes and the debug pass culled");
+	check(stats.transientCnt == 3 && stats.heapCnt == 2, "expected 3 transients in 2 heaps");
+	check(stats.aliasedBytes == requirements.size, "expected one transient's memory saved by aliasing");
+	// one call in front of each pass and one for the host read, the copy from B
+	// waits for B only, the copy from C for C and the first write to the output
+	check(stats.barrierCallCnt == 6 && stats.barrierCnt == 8, "expected 8 barriers in 6 calls");
+
+	// the fill overwrites any earlier run, C's must survive sharing memory with A
+	std::memset(output.allocation.pMapped, 0, 2 * s_transientSize);
+	recordGraph(*pGraph, *cmdBuffer);
+	context.submitAndWait(*cmdBuffer);
+	auto pValues = (const uint32_t*)output.allocation.pMapped;
+	const uint32_t valueCnt = (uint32_t)(s_transientSize / sizeof(uint32_t));
+	for (uint32_t i = 0; i < 2 * valueCnt; ++i)
+	{
+		check(pValues[i] == (i < valueCnt ? s_firstValue : s_secondValue), "output doesn't match what the passes wrote");
+	}
+
+	std::cout << stats.passCnt << " passes, " << stats.culledPassCnt << " culled, " << stats.transientCnt << " transients in "
+		<< stats.heapCnt << " heaps, " << stats.aliasedBytes / 1024 << " KiB aliased, " << stats.barrierCnt << " barriers in "
+		<< stats.barrierCallCnt << " calls: build and compile " << compileMs << " ms, execute "
+		<< executeMs * 1000.0 / executeCnt << " us\n";
+	pGraph.reset();
+	device.destroyBuffer(output);
+}
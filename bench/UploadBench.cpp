@@ -0,0 +1,67 @@
+// StagingUploader bandwidth for a range of upload sizes into a device local
+// buffer, and the time to build and upload a grid mesh of millions of
+// triangles. Uploads go through the graphics queue, the bench device has no
+// separate transfer queue.
+#include "Bench.h"
+#include "BenchContext.h"
+#include "FrameScheduler.h"
+#include "StagingUploader.h"
+#include "Mesh.h"
+#include <iostream>
+#include <vector>
+
+void benchUpload(BenchContext& context, const BenchSettings& settings)
+{
+	Device& device = context.getDevice();
+	FrameScheduler scheduler(device);
+	scheduler.addQueue(context.getQueue());
+	StagingUploader uploader(device, scheduler, context.getQueue(), context.getQueueFamilyIndex(),
+		context.getQueue(), context.getQueueFamilyIndex());
+
+	const VkDeviceSize dstSize = 64ull * 1024 * 1024;
+	const VkDeviceSize totalBytes = settings.quick ? dstSize : 4 * dstSize;
+	AllocatedBuffer dst = device.createBuffer(dstSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	std::vector<uint8_t> source(dstSize, 0x5a);
+
+	std::cout << totalBytes / (1024 * 1024) << " MiB per run through a 32 MiB staging ring\n";
+	for (VkDeviceSize uploadSize : { 4ull * 1024, 64ull * 1024, 1024ull * 1024, 16ull * 1024 * 1024 })
+	{
+		double ms = measureBestMs(settings.repeats, [&]()
+		{
+			for (VkDeviceSize uploaded = 0; uploaded < totalBytes; uploaded += uploadSize)
+			{
+				uploader.upload(dst.buffer, uploaded % dstSize, source.data(), uploadSize,
+					VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+			}
+			uploader.waitIdle();
+		});
+		std::cout << "\t" << uploadSize / 1024 << " KiB uploads: " << ms << " ms, "
+			<< perSecond((double)totalBytes, ms) / (1024.0 * 1024 * 1024) << " GiB/s, "
+			<< perSecond((double)(totalBytes / uploadSize), ms) / 1e3 << " K uploads/s\n";
+	}
+	auto& stats = uploader.getStats();
+	std::cout << "\tall runs: " << stats.submits << " submits, " << stats.copyMs << " ms copying into the ring, "
+		<< stats.stallMs << " ms waiting for ring space\n";
+	device.destroyBuffer(dst);
+
+	// the vertex and index data of a mesh of gridSize^2 quads
+	for (uint32_t gridSize : { 256u, 1024u })
+	{
+		if (settings.quick && gridSize > 256)
+			break;
+
+		std::vector<Mesh::Vertex> vertices;
+		std::vector<uint32_t> indices;
+		Mesh::createGrid(gridSize, vertices, indices);
+		VkDeviceSize byteSize = 0;
+		double ms = measureBestMs(settings.repeats, [&]()
+		{
+			Mesh mesh(device, uploader, vertices, indices);
+			uploader.waitIdle();
+			byteSize = mesh.getByteSize();
+		});
+		std::cout << "\tgrid mesh " << gridSize << "x" << gridSize << ", " << indices.size() / 3 / 1e6 << " M triangles, "
+			<< byteSize / (1024.0 * 1024) << " MiB: " << ms << " ms to create and upload\n";
+	}
+}
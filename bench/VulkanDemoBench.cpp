@@ -0,0 +1,91 @@
+// Headless benchmarks of the engine parts that do not need a window. Runs
+// every benchmark, or the ones named on the command line:
+//   VulkanDemoBench [--shader-dir dir] [--repeats n] [--quick] [name...]
+#include "Bench.h"
+#include "BenchContext.h"
+#include <iostream>
+#include <cstring>
+#include <string>
+#include <algorithm>
+
+struct BenchEntry
+{
+	const char* name;
+	const char* description;
+	void (*run)(BenchContext& context, const BenchSettings& settings);
+};
+
+static const BenchEntry s_benches[] = {
+	{ "command-stream", "CommandStream build and record against the virtual Command path", benchCommandStream },
+	{ "upload", "StagingUploader bandwidth and mesh upload time", benchUpload },
+	{ "draw-calls", "recording and executing one indexed draw per object", benchDrawCalls },
+	{ "descriptors", "DescriptorAllocator transient sets, pool resets and persistent lookups", benchDescriptors },
+	{ "instancing", "InstanceBatcher draws of 1k to 1M instances", benchInstancing },
+	{ "culling", "SceneBvh culling of 1M boxes on one thread and in parallel", benchCulling },
+	{ "render-graph", "RenderGraph compile and execute cost, checks its transient aliasing and barrier plan", benchRenderGraph },
+	{ "frames-in-flight", "frame time and CPU time blocked on the GPU with 1 to 3 frames in flight", benchFramesInFlight },
+};
+
+int main(int argc, char** argv)
+{
+	BenchSettings settings;
+	std::vector<std::string> names;
+	for (int i = 1; i < argc; ++i)
+	{
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--shader-dir") == 0 && hasValue)
+		{
+			settings.shaderDir = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--repeats") == 0 && hasValue)
+		{
+			settings.repeats = (uint32_t)std::stoul(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--quick") == 0)
+		{
+			settings.quick = true;
+		}
+		else if (std::strcmp(argv[i], "--list") == 0)
+		{
+			for (auto& bench : s_benches)
+			{
+				std::cout << bench.name << "\t" << bench.description << '\n';
+			}
+			return EXIT_SUCCESS;
+		}
+		else
+		{
+			names.push_back(argv[i]);
+		}
+	}
+
+	for (auto& name : names)
+	{
+		bool known = std::any_of(std::begin(s_benches), std::end(s_benches), [&](const BenchEntry& bench) { return name == bench.name; });
+		if (!known)
+		{
+			std::cerr << "unknown benchmark " << name << ", --list shows the available ones" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	try
+	{
+		BenchContext context;
+		for (auto& bench : s_benches)
+		{
+			if (!names.empty() && std::find(names.begin(), names.end(), bench.name) == names.end())
+				continue;
+
+			std::cout << "\n== " << bench.name << ": " << bench.description << '\n';
+			bench.run(context, settings);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,38 @@
+#include "BindDescriptorSets.h"
+#include "../CommandBuffer.h"
+#include <typeinfo>
+
+BindDescriptorSets::BindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, const std::vector<VkDescriptorSet>& sets,
+	uint32_t firstSet, const std::vector<uint32_t>& dynamicOffsets)
+	:m_bindPoint(bindPoint), m_layout(layout), m_sets(sets), m_firstSet(firstSet), m_dynamicOffsets(dynamicOffsets)
+{
+
+}
+
+BindDescriptorSets::~BindDescriptorSets()
+{
+
+}
+
+void BindDescriptorSets::record(CommandBuffer& cmdBuffer)
+{
+	vkCmdBindDescriptorSets(cmdBuffer, m_bindPoint, m_layout, m_firstSet, (uint32_t)m_sets.size(), m_sets.data(),
+		(uint32_t)m_dynamicOffsets.size(), m_dynamicOffsets.data());
+}
+
+std::size_t BindDescriptorSets::hash()const
+{
+	std::size_t seed = typeid(BindDescriptorSets).hash_code();
+	hashCombine(seed, (uint32_t)m_bindPoint);
+	hashCombine(seed, m_layout);
+	hashCombine(seed, m_firstSet);
+	for (auto& set : m_sets)
+	{
+		hashCombine(seed, set);
+	}
+	for (auto& offset : m_dynamicOffsets)
+	{
+		hashCombine(seed, offset);
+	}
+	return seed;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "Command.h"
+#include <vector>
+class BindDescriptorSets :public Command
+{
+public:
+	BindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, const std::vector<VkDescriptorSet>& sets,
+		uint32_t firstSet = 0, const std::vector<uint32_t>& dynamicOffsets = {});
+	virtual ~BindDescriptorSets();
+	virtual void record(CommandBuffer& cmdBuffer)override;
+	virtual std::size_t hash()const override;
+private:
+	VkPipelineBindPoint          m_bindPoint;
+	VkPipelineLayout             m_layout;
+	std::vector<VkDescriptorSet> m_sets;
+	uint32_t                     m_firstSet;
+	std::vector<uint32_t>        m_dynamicOffsets;
+};
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "BindIndexBuffer.h"
+#include "../CommandBuffer.h"
+#include <typeinfo>
+
+BindIndexBuffer::BindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+	:m_buffer(buffer), m_offset(offset), m_indexType(indexType)
+{
+
+}
+
+BindIndexBuffer::~BindIndexBuffer()
+{
+
+}
+
+void BindIndexBuffer::record(CommandBuffer& cmdBuffer)
+{
+	vkCmdBindIndexBuffer(cmdBuffer, m_buffer, m_offset, m_indexType);
+}
+
+std::size_t BindIndexBuffer::hash()const
+{
+	std::size_t seed = typeid(BindIndexBuffer).hash_code();
+	hashCombine(seed, m_buffer);
+	hashCombine(seed, m_offset);
+	hashCombine(seed, (uint32_t)m_indexType);
+	return seed;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "Command.h"
+
+class BindIndexBuffer :public Command
+{
+public:
+	BindIndexBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkIndexType indexType = VK_INDEX_TYPE_UINT32);
+	virtual ~BindIndexBuffer();
+	virtual void record(CommandBuffer& cmdBuffer)override;
+	virtual std::size_t hash()const override;
+private:
+	VkBuffer     m_buffer;
+	VkDeviceSize m_offset;
+	VkIndexType  m_indexType;
+};
\ No newline at end of file
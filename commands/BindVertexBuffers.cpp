@@ -0,0 +1,31 @@
+#include "BindVertexBuffers.h"
+#include "../CommandBuffer.h"
+#include <typeinfo>
+
+BindVertexBuffers::BindVertexBuffers(const std::vector<VkBuffer>& buffers, const std::vector<VkDeviceSize>& offsets, uint32_t firstBinding)
+	:m_buffers(buffers), m_offsets(offsets), m_firstBinding(firstBinding)
+{
+	m_offsets.resize(m_buffers.size(), 0);
+}
+
+BindVertexBuffers::~BindVertexBuffers()
+{
+
+}
+
+void BindVertexBuffers::record(CommandBuffer& cmdBuffer)
+{
+	vkCmdBindVertexBuffers(cmdBuffer, m_firstBinding, (uint32_t)m_buffers.size(), m_buffers.data(), m_offsets.data());
+}
+
+std::size_t BindVertexBuffers::hash()const
+{
+	std::size_t seed = typeid(BindVertexBuffers).hash_code();
+	hashCombine(seed, m_firstBinding);
+	for (std::size_t i = 0; i < m_buffers.size(); ++i)
+	{
+		hashCombine(seed, m_buffers[i]);
+		hashCombine(seed, m_offsets[i]);
+	}
+	return seed;
+}
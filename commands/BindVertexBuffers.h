@@ -0,0 +1,15 @@
+#pragma once
+#include "Command.h"
+#include <vector>
+class BindVertexBuffers :public Command
+{
+public:
+	BindVertexBuffers(const std::vector<VkBuffer>& buffers, const std::vector<VkDeviceSize>& offsets, uint32_t firstBinding = 0);
+	virtual ~BindVertexBuffers();
+	virtual void record(CommandBuffer& cmdBuffer)override;
+	virtual std::size_t hash()const override;
+private:
+	std::vector<VkBuffer>     m_buffers;
+	std::vector<VkDeviceSize> m_offsets;
+	uint32_t                  m_firstBinding;
+};
\ No newline at end of file
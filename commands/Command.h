@@ -1,6 +1,8 @@
 #pragma once
 
 #include "vulkan/vulkan.h"
+#include "../HashCombine.h"
+#include <cstddef>
 class CommandBuffer;
 class Command
 {
@@ -9,4 +11,7 @@ public:
 	virtual ~Command();
 public:
 	virtual void record(CommandBuffer&) = 0;
+
+	// content hash, commands with equal hashes record identical vulkan commands
+	virtual std::size_t hash()const = 0;
 };
\ No newline at end of file
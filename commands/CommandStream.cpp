@@ -0,0 +1,474 @@
+#include "CommandStream.h"
+#include "../CommandBuffer.h"
+#include "../GpuProfiler.h"
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+CommandStream::CommandStream(std::size_t initialCapacity)
+{
+	m_data.resize(initialCapacity);
+}
+
+CommandStream::~CommandStream()
+{
+
+}
+
+void CommandStream::reset()
+{
+	m_size = 0;
+	m_commandCnt = 0;
+	m_drawCnt = 0;
+}
+
+void* CommandStream::push(CommandType type, std::size_t payloadSize)
+{
+	std::size_t recordSize = sizeof(RecordHeader) + payloadSize;
+	recordSize = (recordSize + RecordAlignment - 1) & ~(RecordAlignment - 1);
+	if (m_size + recordSize > m_data.size())
+	{
+		m_data.resize(std::max(m_data.size() * 2, m_size + recordSize));
+	}
+
+	uint8_t* pRecord = m_data.data() + m_size;
+	// zero padding as well, hash() reads the raw bytes
+	std::memset(pRecord, 0, recordSize);
+	auto pHeader = reinterpret_cast<RecordHeader*>(pRecord);
+	pHeader->type = type;
+	pHeader->size = (uint32_t)recordSize;
+
+	m_size += recordSize;
+	++m_commandCnt;
+	if (isDraw(type))
+	{
+		++m_drawCnt;
+	}
+	return pRecord + sizeof(RecordHeader);
+}
+
+void CommandStream::bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline)
+{
+	auto pRecord = static_cast<BindPipelineRecord*>(push(CommandType::BindPipeline, sizeof(BindPipelineRecord)));
+	pRecord->bindPoint = bindPoint;
+	pRecord->pipeline = pipeline;
+}
+
+void CommandStream::setViewport(const VkViewport* pViewports, uint32_t viewportCnt, uint32_t firstViewport)
+{
+	auto pRecord = static_cast<SetViewportRecord*>(push(CommandType::SetViewport, sizeof(SetViewportRecord) + sizeof(VkViewport) * viewportCnt));
+	pRecord->firstViewport = firstViewport;
+	pRecord->viewportCnt = viewportCnt;
+	std::memcpy(pRecord + 1, pViewports, sizeof(VkViewport) * viewportCnt);
+}
+
+void CommandStream::setScissor(const VkRect2D* pScissors, uint32_t scissorCnt, uint32_t firstScissor)
+{
+	auto pRecord = static_cast<SetScissorRecord*>(push(CommandType::SetScissor, sizeof(SetScissorRecord) + sizeof(VkRect2D) * scissorCnt));
+	pRecord->firstScissor = firstScissor;
+	pRecord->scissorCnt = scissorCnt;
+	std::memcpy(pRecord + 1, pScissors, sizeof(VkRect2D) * scissorCnt);
+}
+
+void CommandStream::draw(uint32_t vertexCnt, uint32_t firstVertex, uint32_t instanceCnt, uint32_t firstInstance)
+{
+	auto pRecord = static_cast<DrawRecord*>(push(CommandType::Draw, sizeof(DrawRecord)));
+	pRecord->vertexCnt = vertexCnt;
+	pRecord->firstVertex = firstVertex;
+	pRecord->instanceCnt = instanceCnt;
+	pRecord->firstInstance = firstInstance;
+}
+
+void CommandStream::bindVertexBuffers(const VkBuffer* pBuffers, const VkDeviceSize* pOffsets, uint32_t bindingCnt, uint32_t firstBinding)
+{
+	auto pRecord = static_cast<BindVertexBuffersRecord*>(push(CommandType::BindVertexBuffers,
+		sizeof(BindVertexBuffersRecord) + (sizeof(VkBuffer) + sizeof(VkDeviceSize)) * bindingCnt));
+	pRecord->firstBinding = firstBinding;
+	pRecord->bindingCnt = bindingCnt;
+	auto pRecordBuffers = reinterpret_cast<VkBuffer*>(pRecord + 1);
+	std::memcpy(pRecordBuffers, pBuffers, sizeof(VkBuffer) * bindingCnt);
+	// the record is zeroed, so leaving the offsets alone binds from the start
+	if (pOffsets)
+	{
+		std::memcpy(pRecordBuffers + bindingCnt, pOffsets, sizeof(VkDeviceSize) * bindingCnt);
+	}
+}
+
+void CommandStream::bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+{
+	auto pRecord = static_cast<BindIndexBufferRecord*>(push(CommandType::BindIndexBuffer, sizeof(BindIndexBufferRecord)));
+	pRecord->buffer = buffer;
+	pRecord->offset = offset;
+	pRecord->indexType = indexType;
+}
+
+void CommandStream::bindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t firstSet, const VkDescriptorSet* pSets, uint32_t setCnt,
+	const uint32_t* pDynamicOffsets, uint32_t dynamicOffsetCnt)
+{
+	auto pRecord = static_cast<BindDescriptorSetsRecord*>(push(CommandType::BindDescriptorSets,
+		sizeof(BindDescriptorSetsRecord) + sizeof(VkDescriptorSet) * setCnt + sizeof(uint32_t) * dynamicOffsetCnt));
+	pRecord->bindPoint = bindPoint;
+	pRecord->firstSet = firstSet;
+	pRecord->layout = layout;
+	pRecord->setCnt = setCnt;
+	pRecord->dynamicOffsetCnt = dynamicOffsetCnt;
+	auto pRecordSets = reinterpret_cast<VkDescriptorSet*>(pRecord + 1);
+	std::memcpy(pRecordSets, pSets, sizeof(VkDescriptorSet) * setCnt);
+	if (dynamicOffsetCnt > 0)
+	{
+		std::memcpy(pRecordSets + setCnt, pDynamicOffsets, sizeof(uint32_t) * dynamicOffsetCnt);
+	}
+}
+
+void CommandStream::pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* pValues)
+{
+	auto pRecord = static_cast<PushConstantsRecord*>(push(CommandType::PushConstants, sizeof(PushConstantsRecord) + size));
+	pRecord->layout = layout;
+	pRecord->stages = stages;
+	pRecord->offset = offset;
+	pRecord->size = size;
+	std::memcpy(pRecord + 1, pValues, size);
+}
+
+void CommandStream::drawIndexed(uint32_t indexCnt, uint32_t firstIndex, int32_t vertexOffset, uint32_t instanceCnt, uint32_t firstInstance)
+{
+	auto pRecord = static_cast<DrawIndexedRecord*>(push(CommandType::DrawIndexed, sizeof(DrawIndexedRecord)));
+	pRecord->indexCnt = indexCnt;
+	pRecord->firstIndex = firstIndex;
+	pRecord->vertexOffset = vertexOffset;
+	pRecord->instanceCnt = instanceCnt;
+	pRecord->firstInstance = firstInstance;
+}
+
+void CommandStream::drawIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCnt, uint32_t stride)
+{
+	auto pRecord = static_cast<DrawIndirectRecord*>(push(CommandType::DrawIndirect, sizeof(DrawIndirectRecord)));
+	pRecord->buffer = buffer;
+	pRecord->offset = offset;
+	pRecord->drawCnt = drawCnt;
+	pRecord->stride = stride;
+}
+
+void CommandStream::drawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCnt, uint32_t stride)
+{
+	auto pRecord = static_cast<DrawIndirectRecord*>(push(CommandType::DrawIndexedIndirect, sizeof(DrawIndirectRecord)));
+	pRecord->buffer = buffer;
+	pRecord->offset = offset;
+	pRecord->drawCnt = drawCnt;
+	pRecord->stride = stride;
+}
+
+void CommandStream::drawIndexedIndirectCount(PFN_vkCmdDrawIndexedIndirectCountKHR pfnDrawIndexedIndirectCount, VkBuffer buffer, VkDeviceSize offset,
+	VkBuffer countBuffer, VkDeviceSize countOffset, uint32_t maxDrawCnt, uint32_t stride)
+{
+	auto pRecord = static_cast<DrawIndexedIndirectCountRecord*>(push(CommandType::DrawIndexedIndirectCount, sizeof(DrawIndexedIndirectCountRecord)));
+	pRecord->pfnDrawIndexedIndirectCount = pfnDrawIndexedIndirectCount;
+	pRecord->buffer = buffer;
+	pRecord->offset = offset;
+	pRecord->countBuffer = countBuffer;
+	pRecord->countOffset = countOffset;
+	pRecord->maxDrawCnt = maxDrawCnt;
+	pRecord->stride = stride;
+}
+
+void CommandStream::record(CommandBuffer& cmdBuffer, GpuProfiler* pProfiler)const
+{
+	VkCommandBuffer vkCmdBuffer = cmdBuffer;
+	std::size_t offset = 0;
+	while (offset < m_size)
+	{
+		auto pHeader = reinterpret_cast<const RecordHeader*>(m_data.data() + offset);
+		if (pProfiler)
+		{
+			uint32_t scope = pProfiler->beginScope(vkCmdBuffer, getTypeName(pHeader->type));
+			replay(vkCmdBuffer, pHeader->type, pHeader + 1);
+			pProfiler->endScope(vkCmdBuffer, scope);
+		}
+		else
+		{
+			replay(vkCmdBuffer, pHeader->type, pHeader + 1);
+		}
+		offset += pHeader->size;
+	}
+}
+
+static const std::size_t s_noRecord = SIZE_MAX;
+// graphics, compute and everything else
+static const uint32_t s_bindPointSlots = 3;
+// sets per bind point, past maxBoundDescriptorSets on every device
+static const uint32_t s_setSlots = 32;
+
+// the last record setting each piece of state, by slot: bind point, viewport index,
+// vertex binding, set number or push constant word
+struct SnapshotTracker
+{
+	std::vector<std::size_t> pipelines;
+	std::vector<std::size_t> viewports;
+	std::vector<std::size_t> scissors;
+	std::vector<std::size_t> vertexBuffers;
+	std::vector<std::size_t> indexBuffer;
+	std::vector<std::size_t> descriptorSets;
+	std::vector<std::size_t> pushConstantWords;
+};
+
+static uint32_t getBindPointSlot(VkPipelineBindPoint bindPoint)
+{
+	return std::min((uint32_t)bindPoint, s_bindPointSlots - 1);
+}
+
+static void setSlots(std::vector<std::size_t>& slots, uint32_t first, uint32_t cnt, std::size_t offset)
+{
+	if (slots.size() < first + cnt)
+	{
+		slots.resize(first + cnt, s_noRecord);
+	}
+	std::fill(slots.begin() + first, slots.begin() + first + cnt, offset);
+}
+
+// a record partly overridden by a later one is still replayed, before the later one
+static void collectSlots(const SnapshotTracker& tracker, std::vector<std::size_t>& offsets)
+{
+	offsets.clear();
+	for (auto pSlots : { &tracker.pipelines, &tracker.viewports, &tracker.scissors, &tracker.vertexBuffers, &tracker.indexBuffer,
+		&tracker.descriptorSets, &tracker.pushConstantWords })
+	{
+		std::copy_if(pSlots->begin(), pSlots->end(), std::back_inserter(offsets), [](std::size_t offset) { return offset != s_noRecord; });
+	}
+	std::sort(offsets.begin(), offsets.end());
+	offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+}
+
+void CommandStream::takeSnapshots(const uint32_t* pFirstDraws, uint32_t snapshotCnt, StateSnapshot* pSnapshots)const
+{
+	SnapshotTracker tracker;
+	uint32_t drawIndex = 0;
+	uint32_t snapshotIndex = 0;
+	auto takeSnapshot = [&](std::size_t offset) {
+		while (snapshotIndex < snapshotCnt && pFirstDraws[snapshotIndex] == drawIndex)
+		{
+			auto& snapshot = pSnapshots[snapshotIndex++];
+			snapshot.firstDraw = drawIndex;
+			snapshot.offset = offset;
+			collectSlots(tracker, snapshot.stateOffsets);
+		}
+	};
+
+	std::size_t offset = 0;
+	while (offset < m_size && snapshotIndex < snapshotCnt)
+	{
+		auto pHeader = reinterpret_cast<const RecordHeader*>(m_data.data() + offset);
+		const void* pPayload = pHeader + 1;
+		switch (pHeader->type)
+		{
+		case CommandType::BindPipeline:
+			setSlots(tracker.pipelines, getBindPointSlot(static_cast<const BindPipelineRecord*>(pPayload)->bindPoint), 1, offset);
+			break;
+		case CommandType::SetViewport:
+		{
+			auto pRecord = static_cast<const SetViewportRecord*>(pPayload);
+			setSlots(tracker.viewports, pRecord->firstViewport, pRecord->viewportCnt, offset);
+			break;
+		}
+		case CommandType::SetScissor:
+		{
+			auto pRecord = static_cast<const SetScissorRecord*>(pPayload);
+			setSlots(tracker.scissors, pRecord->firstScissor, pRecord->scissorCnt, offset);
+			break;
+		}
+		case CommandType::BindVertexBuffers:
+		{
+			auto pRecord = static_cast<const BindVertexBuffersRecord*>(pPayload);
+			setSlots(tracker.vertexBuffers, pRecord->firstBinding, pRecord->bindingCnt, offset);
+			break;
+		}
+		case CommandType::BindIndexBuffer:
+			setSlots(tracker.indexBuffer, 0, 1, offset);
+			break;
+		case CommandType::BindDescriptorSets:
+		{
+			auto pRecord = static_cast<const BindDescriptorSetsRecord*>(pPayload);
+			uint32_t first = getBindPointSlot(pRecord->bindPoint) * s_setSlots + pRecord->firstSet;
+			setSlots(tracker.descriptorSets, first, pRecord->setCnt, offset);
+			break;
+		}
+		case CommandType::PushConstants:
+		{
+			auto pRecord = static_cast<const PushConstantsRecord*>(pPayload);
+			setSlots(tracker.pushConstantWords, pRecord->offset / 4, (pRecord->size + 3) / 4, offset);
+			break;
+		}
+		default:
+			if (isDraw(pHeader->type))
+			{
+				takeSnapshot(offset);
+				++drawIndex;
+			}
+			break;
+		}
+		offset += pHeader->size;
+	}
+	// snapshots past the last draw record nothing
+	takeSnapshot(m_size);
+	if (snapshotIndex != snapshotCnt)
+		throw std::runtime_error("command stream snapshots must be taken at ascending draws within the stream!");
+}
+
+void CommandStream::record(CommandBuffer& cmdBuffer, const StateSnapshot& snapshot, uint32_t drawCnt)const
+{
+	VkCommandBuffer vkCmdBuffer = cmdBuffer;
+	for (auto stateOffset : snapshot.stateOffsets)
+	{
+		auto pHeader = reinterpret_cast<const RecordHeader*>(m_data.data() + stateOffset);
+		replay(vkCmdBuffer, pHeader->type, pHeader + 1);
+	}
+
+	uint32_t drawIndex = 0;
+	std::size_t offset = snapshot.offset;
+	while (offset < m_size && drawIndex < drawCnt)
+	{
+		auto pHeader = reinterpret_cast<const RecordHeader*>(m_data.data() + offset);
+		replay(vkCmdBuffer, pHeader->type, pHeader + 1);
+		if (isDraw(pHeader->type))
+		{
+			++drawIndex;
+		}
+		offset += pHeader->size;
+	}
+}
+
+void CommandStream::record(CommandBuffer& cmdBuffer, uint32_t firstDraw, uint32_t drawCnt)const
+{
+	StateSnapshot snapshot;
+	takeSnapshots(&firstDraw, 1, &snapshot);
+	record(cmdBuffer, snapshot, drawCnt);
+}
+
+const char* CommandStream::getTypeName(CommandType type)
+{
+	switch (type)
+	{
+	case CommandType::BindPipeline:
+		return "BindPipeline";
+	case CommandType::SetViewport:
+		return "SetViewport";
+	case CommandType::SetScissor:
+		return "SetScissor";
+	case CommandType::Draw:
+		return "Draw";
+	case CommandType::BindVertexBuffers:
+		return "BindVertexBuffers";
+	case CommandType::BindIndexBuffer:
+		return "BindIndexBuffer";
+	case CommandType::DrawIndexed:
+		return "DrawIndexed";
+	case CommandType::BindDescriptorSets:
+		return "BindDescriptorSets";
+	case CommandType::PushConstants:
+		return "PushConstants";
+	case CommandType::DrawIndirect:
+		return "DrawIndirect";
+	case CommandType::DrawIndexedIndirect:
+		return "DrawIndexedIndirect";
+	case CommandType::DrawIndexedIndirectCount:
+		return "DrawIndexedIndirectCount";
+	}
+	return "Unknown";
+}
+
+void CommandStream::replay(VkCommandBuffer vkCmdBuffer, CommandType type, const void* pPayload)const
+{
+	switch (type)
+	{
+	case CommandType::BindPipeline:
+	{
+		auto pRecord = static_cast<const BindPipelineRecord*>(pPayload);
+		vkCmdBindPipeline(vkCmdBuffer, pRecord->bindPoint, pRecord->pipeline);
+		break;
+	}
+	case CommandType::SetViewport:
+	{
+		auto pRecord = static_cast<const SetViewportRecord*>(pPayload);
+		vkCmdSetViewport(vkCmdBuffer, pRecord->firstViewport, pRecord->viewportCnt, reinterpret_cast<const VkViewport*>(pRecord + 1));
+		break;
+	}
+	case CommandType::SetScissor:
+	{
+		auto pRecord = static_cast<const SetScissorRecord*>(pPayload);
+		vkCmdSetScissor(vkCmdBuffer, pRecord->firstScissor, pRecord->scissorCnt, reinterpret_cast<const VkRect2D*>(pRecord + 1));
+		break;
+	}
+	case CommandType::Draw:
+	{
+		auto pRecord = static_cast<const DrawRecord*>(pPayload);
+		vkCmdDraw(vkCmdBuffer, pRecord->vertexCnt, pRecord->instanceCnt, pRecord->firstVertex, pRecord->firstInstance);
+		break;
+	}
+	case CommandType::BindVertexBuffers:
+	{
+		auto pRecord = static_cast<const BindVertexBuffersRecord*>(pPayload);
+		auto pBuffers = reinterpret_cast<const VkBuffer*>(pRecord + 1);
+		auto pOffsets = reinterpret_cast<const VkDeviceSize*>(pBuffers + pRecord->bindingCnt);
+		vkCmdBindVertexBuffers(vkCmdBuffer, pRecord->firstBinding, pRecord->bindingCnt, pBuffers, pOffsets);
+		break;
+	}
+	case CommandType::BindIndexBuffer:
+	{
+		auto pRecord = static_cast<const BindIndexBufferRecord*>(pPayload);
+		vkCmdBindIndexBuffer(vkCmdBuffer, pRecord->buffer, pRecord->offset, pRecord->indexType);
+		break;
+	}
+	case CommandType::DrawIndexed:
+	{
+		auto pRecord = static_cast<const DrawIndexedRecord*>(pPayload);
+		vkCmdDrawIndexed(vkCmdBuffer, pRecord->indexCnt, pRecord->instanceCnt, pRecord->firstIndex, pRecord->vertexOffset, pRecord->firstInstance);
+		break;
+	}
+	case CommandType::BindDescriptorSets:
+	{
+		auto pRecord = static_cast<const BindDescriptorSetsRecord*>(pPayload);
+		auto pSets = reinterpret_cast<const VkDescriptorSet*>(pRecord + 1);
+		auto pDynamicOffsets = reinterpret_cast<const uint32_t*>(pSets + pRecord->setCnt);
+		vkCmdBindDescriptorSets(vkCmdBuffer, pRecord->bindPoint, pRecord->layout, pRecord->firstSet, pRecord->setCnt, pSets,
+			pRecord->dynamicOffsetCnt, pDynamicOffsets);
+		break;
+	}
+	case CommandType::PushConstants:
+	{
+		auto pRecord = static_cast<const PushConstantsRecord*>(pPayload);
+		vkCmdPushConstants(vkCmdBuffer, pRecord->layout, pRecord->stages, pRecord->offset, pRecord->size, pRecord + 1);
+		break;
+	}
+	case CommandType::DrawIndirect:
+	{
+		auto pRecord = static_cast<const DrawIndirectRecord*>(pPayload);
+		vkCmdDrawIndirect(vkCmdBuffer, pRecord->buffer, pRecord->offset, pRecord->drawCnt, pRecord->stride);
+		break;
+	}
+	case CommandType::DrawIndexedIndirect:
+	{
+		auto pRecord = static_cast<const DrawIndirectRecord*>(pPayload);
+		vkCmdDrawIndexedIndirect(vkCmdBuffer, pRecord->buffer, pRecord->offset, pRecord->drawCnt, pRecord->stride);
+		break;
+	}
+	case CommandType::DrawIndexedIndirectCount:
+	{
+		auto pRecord = static_cast<const DrawIndexedIndirectCountRecord*>(pPayload);
+		pRecord->pfnDrawIndexedIndirectCount(vkCmdBuffer, pRecord->buffer, pRecord->offset, pRecord->countBuffer, pRecord->countOffset,
+			pRecord->maxDrawCnt, pRecord->stride);
+		break;
+	}
+	}
+}
+
+std::size_t CommandStream::hash()const
+{
+	// FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (std::size_t i = 0; i < m_size; ++i)
+	{
+		hash ^= m_data[i];
+		hash *= 1099511628211ull;
+	}
+	return (std::size_t)hash;
+}
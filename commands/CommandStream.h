@@ -0,0 +1,226 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "PushConstants.h"
+class CommandBuffer;
+class GpuProfiler;
+
+enum class CommandType : uint32_t
+{
+	BindPipeline,
+	SetViewport,
+	SetScissor,
+	Draw,
+	BindVertexBuffers,
+	BindIndexBuffer,
+	DrawIndexed,
+	BindDescriptorSets,
+	PushConstants,
+	DrawIndirect,
+	DrawIndexedIndirect,
+	DrawIndexedIndirectCount,
+};
+
+// Linear, arena-backed list of commands. Every command is stored as a tagged
+// POD record with its payload inline, and record() replays the records with a
+// switch instead of a virtual call per command. reset() keeps the storage, so
+// once the arena has grown to the size of a frame's commands, building and
+// replaying a frame does not touch the heap.
+class CommandStream
+{
+public:
+	CommandStream(std::size_t initialCapacity = 16 * 1024);
+	~CommandStream();
+
+	void reset();
+
+	void bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline);
+	void setViewport(const VkViewport* pViewports, uint32_t viewportCnt, uint32_t firstViewport = 0);
+	void setScissor(const VkRect2D* pScissors, uint32_t scissorCnt, uint32_t firstScissor = 0);
+	void draw(uint32_t vertexCnt, uint32_t firstVertex = 0, uint32_t instanceCnt = 1, uint32_t firstInstance = 0);
+	// pOffsets may be null when every buffer is bound from its start
+	void bindVertexBuffers(const VkBuffer* pBuffers, const VkDeviceSize* pOffsets, uint32_t bindingCnt, uint32_t firstBinding = 0);
+	void bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+	void bindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t firstSet, const VkDescriptorSet* pSets, uint32_t setCnt,
+		const uint32_t* pDynamicOffsets = nullptr, uint32_t dynamicOffsetCnt = 0);
+	void pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* pValues);
+
+	// size checked at compile time like the PushConstants<T> command
+	template<typename T>
+	void pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, const T& value, uint32_t offset = 0)
+	{
+		static_assert(checkPushConstantsType<T>());
+		pushConstants(layout, stages, offset, sizeof(T), &value);
+	}
+
+	void drawIndexed(uint32_t indexCnt, uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t instanceCnt = 1, uint32_t firstInstance = 0);
+	// the draw parameters are read from buffer when the command executes, each counts as one draw
+	void drawIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCnt = 1, uint32_t stride = sizeof(VkDrawIndirectCommand));
+	void drawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCnt = 1, uint32_t stride = sizeof(VkDrawIndexedIndirectCommand));
+	// pfnDrawIndexedIndirectCount is Device::getCmdDrawIndexedIndirectCount(), the command is an extension on Vulkan 1.0
+	void drawIndexedIndirectCount(PFN_vkCmdDrawIndexedIndirectCountKHR pfnDrawIndexedIndirectCount, VkBuffer buffer, VkDeviceSize offset,
+		VkBuffer countBuffer, VkDeviceSize countOffset, uint32_t maxDrawCnt, uint32_t stride = sizeof(VkDrawIndexedIndirectCommand));
+
+	// with pProfiler every command is bracketed by a timestamp scope named after its type
+	void record(CommandBuffer& cmdBuffer, GpuProfiler* pProfiler = nullptr)const;
+
+	// the state commands still in effect in front of a draw and where that draw's
+	// record starts, so recording from the draw on doesn't replay the whole prefix
+	struct StateSnapshot
+	{
+		uint32_t                 firstDraw = 0;
+		std::size_t              offset = 0;
+		// the records to replay, in stream order
+		std::vector<std::size_t> stateOffsets;
+	};
+
+	// fills pSnapshots[i] for the draw pFirstDraws[i] in one pass over the stream,
+	// pFirstDraws must be ascending and may end with getDrawCount()
+	void takeSnapshots(const uint32_t* pFirstDraws, uint32_t snapshotCnt, StateSnapshot* pSnapshots)const;
+
+	// replays the snapshot's state and then drawCnt draws from its draw on, with the
+	// state commands between them, so a subset of the draws can be recorded into a
+	// secondary command buffer that starts without any bound state
+	void record(CommandBuffer& cmdBuffer, const StateSnapshot& snapshot, uint32_t drawCnt)const;
+	// the same for a single range, taking its snapshot first
+	void record(CommandBuffer& cmdBuffer, uint32_t firstDraw, uint32_t drawCnt)const;
+
+	// content hash over the recorded bytes, equal streams hash equal
+	std::size_t hash()const;
+
+	uint32_t getCommandCount()const
+	{
+		return m_commandCnt;
+	}
+
+	uint32_t getDrawCount()const
+	{
+		return m_drawCnt;
+	}
+
+	std::size_t getByteSize()const
+	{
+		return m_size;
+	}
+
+private:
+	struct RecordHeader
+	{
+		CommandType type;
+		uint32_t    size; // header + payload, aligned to RecordAlignment
+	};
+
+	struct BindPipelineRecord
+	{
+		VkPipelineBindPoint bindPoint;
+		uint32_t            padding;
+		VkPipeline          pipeline;
+	};
+
+	struct SetViewportRecord
+	{
+		uint32_t firstViewport;
+		uint32_t viewportCnt;
+		// VkViewport[viewportCnt] follows
+	};
+
+	struct SetScissorRecord
+	{
+		uint32_t firstScissor;
+		uint32_t scissorCnt;
+		// VkRect2D[scissorCnt] follows
+	};
+
+	struct DrawRecord
+	{
+		uint32_t vertexCnt;
+		uint32_t firstVertex;
+		uint32_t instanceCnt;
+		uint32_t firstInstance;
+	};
+
+	struct BindVertexBuffersRecord
+	{
+		uint32_t firstBinding;
+		uint32_t bindingCnt;
+		// VkBuffer[bindingCnt] followed by VkDeviceSize[bindingCnt]
+	};
+
+	struct BindIndexBufferRecord
+	{
+		VkBuffer     buffer;
+		VkDeviceSize offset;
+		VkIndexType  indexType;
+	};
+
+	struct DrawIndexedRecord
+	{
+		uint32_t indexCnt;
+		uint32_t firstIndex;
+		int32_t  vertexOffset;
+		uint32_t instanceCnt;
+		uint32_t firstInstance;
+	};
+
+	struct BindDescriptorSetsRecord
+	{
+		VkPipelineBindPoint bindPoint;
+		uint32_t            firstSet;
+		VkPipelineLayout    layout;
+		uint32_t            setCnt;
+		uint32_t            dynamicOffsetCnt;
+		// VkDescriptorSet[setCnt] followed by uint32_t[dynamicOffsetCnt]
+	};
+
+	struct PushConstantsRecord
+	{
+		VkPipelineLayout   layout;
+		VkShaderStageFlags stages;
+		uint32_t           offset;
+		uint32_t           size;
+		// size bytes of values follow
+	};
+
+	struct DrawIndirectRecord
+	{
+		VkBuffer     buffer;
+		VkDeviceSize offset;
+		uint32_t     drawCnt;
+		uint32_t     stride;
+	};
+
+	struct DrawIndexedIndirectCountRecord
+	{
+		PFN_vkCmdDrawIndexedIndirectCountKHR pfnDrawIndexedIndirectCount;
+		VkBuffer                             buffer;
+		VkDeviceSize                         offset;
+		VkBuffer                             countBuffer;
+		VkDeviceSize                         countOffset;
+		uint32_t                             maxDrawCnt;
+		uint32_t                             stride;
+	};
+
+	static constexpr std::size_t RecordAlignment = 8;
+
+	// reserves a zeroed record and returns a pointer to its payload
+	void* push(CommandType type, std::size_t payloadSize);
+
+	static bool isDraw(CommandType type)
+	{
+		return type == CommandType::Draw || type == CommandType::DrawIndexed || type == CommandType::DrawIndirect ||
+			type == CommandType::DrawIndexedIndirect || type == CommandType::DrawIndexedIndirectCount;
+	}
+
+	static const char* getTypeName(CommandType type);
+
+	void replay(VkCommandBuffer cmdBuffer, CommandType type, const void* pPayload)const;
+
+private:
+	std::vector<uint8_t> m_data;
+	std::size_t          m_size = 0;
+	uint32_t             m_commandCnt = 0;
+	uint32_t             m_drawCnt = 0;
+};
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "Draw.h"
 #include "../CommandBuffer.h"
+#include <typeinfo>
 Draw::Draw(uint32_t vertexCnt,uint32_t firstVertex,uint32_t instanceCnt,uint32_t firstInstance)
 	:m_vertexCnt(vertexCnt),m_firstVertex(firstVertex),m_instanceCnt(instanceCnt),m_firstInstance(firstInstance)
 {
@@ -15,3 +16,13 @@ void Draw::record(CommandBuffer& cmdBuffer)
 {
 	vkCmdDraw(cmdBuffer,m_vertexCnt,m_instanceCnt,m_firstVertex,m_firstInstance);
 }
+
+std::size_t Draw::hash()const
+{
+	std::size_t seed = typeid(Draw).hash_code();
+	hashCombine(seed, m_vertexCnt);
+	hashCombine(seed, m_firstVertex);
+	hashCombine(seed, m_instanceCnt);
+	hashCombine(seed, m_firstInstance);
+	return seed;
+}
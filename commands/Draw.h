@@ -7,6 +7,7 @@ public:
 	Draw(uint32_t vertexCnt, uint32_t firstVertex=0, uint32_t instanceCnt=1, uint32_t firstInstance=0);
 	virtual ~Draw();
 	virtual void record(CommandBuffer& cmdBuffer)override;
+	virtual std::size_t hash()const override;
 private:
 	uint32_t m_vertexCnt;
 	uint32_t m_firstVertex;
@@ -0,0 +1,30 @@
+#include "DrawIndexed.h"
+#include "../CommandBuffer.h"
+#include <typeinfo>
+
+DrawIndexed::DrawIndexed(uint32_t indexCnt, uint32_t firstIndex, int32_t vertexOffset, uint32_t instanceCnt, uint32_t firstInstance)
+	:m_indexCnt(indexCnt), m_firstIndex(firstIndex), m_vertexOffset(vertexOffset), m_instanceCnt(instanceCnt), m_firstInstance(firstInstance)
+{
+
+}
+
+DrawIndexed::~DrawIndexed()
+{
+
+}
+
+void DrawIndexed::record(CommandBuffer& cmdBuffer)
+{
+	vkCmdDrawIndexed(cmdBuffer, m_indexCnt, m_instanceCnt, m_firstIndex, m_vertexOffset, m_firstInstance);
+}
+
+std::size_t DrawIndexed::hash()const
+{
+	std::size_t seed = typeid(DrawIndexed).hash_code();
+	hashCombine(seed, m_indexCnt);
+	hashCombine(seed, m_firstIndex);
+	hashCombine(seed, m_vertexOffset);
+	hashCombine(seed, m_instanceCnt);
+	hashCombine(seed, m_firstInstance);
+	return seed;
+}
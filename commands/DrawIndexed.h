@@ -0,0 +1,17 @@
+#pragma once
+#include "Command.h"
+
+class DrawIndexed :public Command
+{
+public:
+	DrawIndexed(uint32_t indexCnt, uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t instanceCnt = 1, uint32_t firstInstance = 0);
+	virtual ~DrawIndexed();
+	virtual void record(CommandBuffer& cmdBuffer)override;
+	virtual std::size_t hash()const override;
+private:
+	uint32_t m_indexCnt;
+	uint32_t m_firstIndex;
+	int32_t  m_vertexOffset;
+	uint32_t m_instanceCnt;
+	uint32_t m_firstInstance;
+};
\ No newline at end of file
@@ -0,0 +1,29 @@
+#include "DrawIndexedIndirect.h"
+#include "../CommandBuffer.h"
+#include <typeinfo>
+
+DrawIndexedIndirect::DrawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCnt, uint32_t stride)
+	:m_buffer(buffer), m_offset(offset), m_drawCnt(drawCnt), m_stride(stride)
+{
+
+}
+
+DrawIndexedIndirect::~DrawIndexedIndirect()
+{
+
+}
+
+void DrawIndexedIndirect::record(CommandBuffer& cmdBuffer)
+{
+	vkCmdDrawIndexedIndirect(cmdBuffer, m_buffer, m_offset, m_drawCnt, m_stride);
+}
+
+std::size_t DrawIndexedIndirect::hash()const
+{
+	std::size_t seed = typeid(DrawIndexedIndirect).hash_code();
+	hashCombine(seed, m_buffer);
+	hashCombine(seed, m_offset);
+	hashCombine(seed, m_drawCnt);
+	hashCombine(seed, m_stride);
+	return seed;
+}
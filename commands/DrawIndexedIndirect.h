@@ -0,0 +1,17 @@
+#pragma once
+#include "Command.h"
+
+// reads drawCnt VkDrawIndexedIndirectCommand structures from buffer, written by the device
+class DrawIndexedIndirect :public Command
+{
+public:
+	DrawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCnt = 1, uint32_t stride = sizeof(VkDrawIndexedIndirectCommand));
+	virtual ~DrawIndexedIndirect();
+	virtual void record(CommandBuffer& cmdBuffer)override;
+	virtual std::size_t hash()const override;
+private:
+	VkBuffer     m_buffer;
+	VkDeviceSize m_offset;
+	uint32_t     m_drawCnt;
+	uint32_t     m_stride;
+};
\ No newline at end of file
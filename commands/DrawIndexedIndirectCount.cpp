@@ -0,0 +1,33 @@
+#include "DrawIndexedIndirectCount.h"
+#include "../CommandBuffer.h"
+#include <typeinfo>
+
+DrawIndexedIndirectCount::DrawIndexedIndirectCount(PFN_vkCmdDrawIndexedIndirectCountKHR pfnDrawIndexedIndirectCount, VkBuffer buffer, VkDeviceSize offset,
+	VkBuffer countBuffer, VkDeviceSize countOffset, uint32_t maxDrawCnt, uint32_t stride)
+	:m_pfnDrawIndexedIndirectCount(pfnDrawIndexedIndirectCount), m_buffer(buffer), m_offset(offset),
+	m_countBuffer(countBuffer), m_countOffset(countOffset), m_maxDrawCnt(maxDrawCnt), m_stride(stride)
+{
+
+}
+
+DrawIndexedIndirectCount::~DrawIndexedIndirectCount()
+{
+
+}
+
+void DrawIndexedIndirectCount::record(CommandBuffer& cmdBuffer)
+{
+	m_pfnDrawIndexedIndirectCount(cmdBuffer, m_buffer, m_offset, m_countBuffer, m_countOffset, m_maxDrawCnt, m_stride);
+}
+
+std::size_t DrawIndexedIndirectCount::hash()const
+{
+	std::size_t seed = typeid(DrawIndexedIndirectCount).hash_code();
+	hashCombine(seed, m_buffer);
+	hashCombine(seed, m_offset);
+	hashCombine(seed, m_countBuffer);
+	hashCombine(seed, m_countOffset);
+	hashCombine(seed, m_maxDrawCnt);
+	hashCombine(seed, m_stride);
+	return seed;
+}
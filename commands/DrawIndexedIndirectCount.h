@@ -0,0 +1,23 @@
+#pragma once
+#include "Command.h"
+
+// like DrawIndexedIndirect, but the draw count is read from countBuffer and
+// clamped to maxDrawCnt. vkCmdDrawIndexedIndirectCountKHR is an extension
+// command on Vulkan 1.0, so its entry point comes from Device.
+class DrawIndexedIndirectCount :public Command
+{
+public:
+	DrawIndexedIndirectCount(PFN_vkCmdDrawIndexedIndirectCountKHR pfnDrawIndexedIndirectCount, VkBuffer buffer, VkDeviceSize offset,
+		VkBuffer countBuffer, VkDeviceSize countOffset, uint32_t maxDrawCnt, uint32_t stride = sizeof(VkDrawIndexedIndirectCommand));
+	virtual ~DrawIndexedIndirectCount();
+	virtual void record(CommandBuffer& cmdBuffer)override;
+	virtual std::size_t hash()const override;
+private:
+	PFN_vkCmdDrawIndexedIndirectCountKHR m_pfnDrawIndexedIndirectCount;
+	VkBuffer                             m_buffer;
+	VkDeviceSize                         m_offset;
+	VkBuffer                             m_countBuffer;
+	VkDeviceSize                         m_countOffset;
+	uint32_t                             m_maxDrawCnt;
+	uint32_t                             m_stride;
+};
\ No newline at end of file
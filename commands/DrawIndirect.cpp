@@ -0,0 +1,29 @@
+#include "DrawIndirect.h"
+#include "../CommandBuffer.h"
+#include <typeinfo>
+
+DrawIndirect::DrawIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCnt, uint32_t stride)
+	:m_buffer(buffer), m_offset(offset), m_drawCnt(drawCnt), m_stride(stride)
+{
+
+}
+
+DrawIndirect::~DrawIndirect()
+{
+
+}
+
+void DrawIndirect::record(CommandBuffer& cmdBuffer)
+{
+	vkCmdDrawIndirect(cmdBuffer, m_buffer, m_offset, m_drawCnt, m_stride);
+}
+
+std::size_t DrawIndirect::hash()const
+{
+	std::size_t seed = typeid(DrawIndirect).hash_code();
+	hashCombine(seed, m_buffer);
+	hashCombine(seed, m_offset);
+	hashCombine(seed, m_drawCnt);
+	hashCombine(seed, m_stride);
+	return seed;
+}
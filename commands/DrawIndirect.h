@@ -0,0 +1,17 @@
+#pragma once
+#include "Command.h"
+
+// reads drawCnt VkDrawIndirectCommand structures from buffer, written by the device
+class DrawIndirect :public Command
+{
+public:
+	DrawIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCnt = 1, uint32_t stride = sizeof(VkDrawIndirectCommand));
+	virtual ~DrawIndirect();
+	virtual void record(CommandBuffer& cmdBuffer)override;
+	virtual std::size_t hash()const override;
+private:
+	VkBuffer     m_buffer;
+	VkDeviceSize m_offset;
+	uint32_t     m_drawCnt;
+	uint32_t     m_stride;
+};
\ No newline at end of file
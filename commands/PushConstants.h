@@ -0,0 +1,68 @@
+#pragma once
+#include "Command.h"
+#include "../CommandBuffer.h"
+#include <typeinfo>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// the smallest maxPushConstantsSize the spec allows, every device supports at least this much
+constexpr uint32_t GuaranteedPushConstantsSize = 128;
+
+// fails to compile for a T that can't be pushed as is, shared by PushConstants<T>
+// and CommandStream::pushConstants<T>()
+template<typename T>
+constexpr bool checkPushConstantsType()
+{
+	static_assert(std::is_trivially_copyable_v<T>, "push constants are copied as raw bytes");
+	static_assert(sizeof(T) % 4 == 0, "push constant sizes must be a multiple of 4");
+	static_assert(sizeof(T) <= GuaranteedPushConstantsSize, "push constants larger than 128 bytes are not supported by every device");
+	return true;
+}
+
+// Records vkCmdPushConstants with a value of T. T is checked at compile time
+// against the guaranteed push constant size, larger ranges have to be checked
+// against the device limit, which GraphicsPipeLine does for the ranges in its
+// pipeline layout.
+template<typename T>
+class PushConstants :public Command
+{
+	static_assert(checkPushConstantsType<T>());
+public:
+	PushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, const T& value, uint32_t offset = 0)
+		:m_layout(layout), m_stages(stages), m_value(value), m_offset(offset)
+	{
+
+	}
+
+	virtual ~PushConstants()
+	{
+
+	}
+
+	virtual void record(CommandBuffer& cmdBuffer)override
+	{
+		vkCmdPushConstants(cmdBuffer, m_layout, m_stages, m_offset, sizeof(T), &m_value);
+	}
+
+	virtual std::size_t hash()const override
+	{
+		std::size_t seed = typeid(PushConstants<T>).hash_code();
+		hashCombine(seed, m_layout);
+		hashCombine(seed, (uint32_t)m_stages);
+		hashCombine(seed, m_offset);
+		uint32_t words[sizeof(T) / 4];
+		std::memcpy(words, &m_value, sizeof(T));
+		for (auto word : words)
+		{
+			hashCombine(seed, word);
+		}
+		return seed;
+	}
+
+private:
+	VkPipelineLayout   m_layout;
+	VkShaderStageFlags m_stages;
+	T                  m_value;
+	uint32_t           m_offset;
+};
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "SetScissor.h"
 #include "../CommandBuffer.h"
+#include <typeinfo>
 
 SetScissor::SetScissor(const std::vector<VkRect2D>& scissors, uint32_t firstScissor):m_scissors(scissors),m_firstScissor(firstScissor)
 {
@@ -14,4 +15,18 @@ SetScissor::~SetScissor()
 void SetScissor::record(CommandBuffer& cmdBuffer)
 {
 	vkCmdSetScissor(cmdBuffer, m_firstScissor, m_scissors.size(), m_scissors.data());
+}
+
+std::size_t SetScissor::hash()const
+{
+	std::size_t seed = typeid(SetScissor).hash_code();
+	hashCombine(seed, m_firstScissor);
+	for (auto& scissor : m_scissors)
+	{
+		hashCombine(seed, scissor.offset.x);
+		hashCombine(seed, scissor.offset.y);
+		hashCombine(seed, scissor.extent.width);
+		hashCombine(seed, scissor.extent.height);
+	}
+	return seed;
 }
\ No newline at end of file
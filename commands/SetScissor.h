@@ -8,6 +8,7 @@ public:
 	virtual ~SetScissor();
 public:
 	virtual void record(CommandBuffer& cmdBuffer)override;
+	virtual std::size_t hash()const override;
 private:
 	std::vector<VkRect2D> m_scissors;
 	uint32_t              m_firstScissor;
@@ -1,5 +1,6 @@
 #include "SetViewport.h"
 #include "../CommandBuffer.h"
+#include <typeinfo>
 SetViewport::SetViewport(const std::vector<VkViewport>& viewports, uint32_t firstViewport):m_viewports(viewports), m_firstViewport(firstViewport)
 {
 
@@ -13,4 +14,20 @@ SetViewport::~SetViewport()
 void SetViewport::record(CommandBuffer& cmdBuffer)
 {
 	vkCmdSetViewport(cmdBuffer, m_firstViewport, m_viewports.size(), m_viewports.data());
+}
+
+std::size_t SetViewport::hash()const
+{
+	std::size_t seed = typeid(SetViewport).hash_code();
+	hashCombine(seed, m_firstViewport);
+	for (auto& viewport : m_viewports)
+	{
+		hashCombine(seed, viewport.x);
+		hashCombine(seed, viewport.y);
+		hashCombine(seed, viewport.width);
+		hashCombine(seed, viewport.height);
+		hashCombine(seed, viewport.minDepth);
+		hashCombine(seed, viewport.maxDepth);
+	}
+	return seed;
 }
\ No newline at end of file
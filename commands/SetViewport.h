@@ -6,6 +6,7 @@ public:
 	SetViewport(const std::vector<VkViewport>& viewpots, uint32_t firstViewport = 0);
 	virtual ~SetViewport();
 	virtual void record(CommandBuffer& cmdBuffer)override;
+	virtual std::size_t hash()const override;
 private:
 	std::vector<VkViewport>   m_viewports;
 	uint32_t                  m_firstViewport;
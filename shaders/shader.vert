@@ -1,21 +1,28 @@
 #version 450
 
-vec2 vertices[3]=vec2[](
-    vec2(-0.5,-0.5),
-    vec2(0.5,-0.5),
-    vec2(0.0,0.5)
-);
+layout(location=0) in vec2 inPosition;
+layout(location=1) in vec3 inColor;
+// per instance, translation in xy, uniform scale in z
+layout(location=2) in vec4 inInstance;
 
-vec3 colors[3]=vec3[](
-    vec3(1.0,0.0,0.0),
-    vec3(0.0,1.0,0.0),
-    vec3(0.0,0.0,1.0)
-);
+layout(set=0,binding=0) uniform FrameUniforms
+{
+    // cos and sin of the rotation angle in xy
+    vec4 rotation;
+} frame;
+
+layout(push_constant) uniform DrawConstants
+{
+    // translation in xy, uniform scale in z
+    vec4 offsetScale;
+} draw;
 
 layout(location=0) out vec3 vertexColor;
 
 void main()
 {
-    gl_Position=vec4(vertices[gl_VertexIndex],0.0,1.0);
-    vertexColor=colors[gl_VertexIndex];
+    mat2 rotation=mat2(frame.rotation.x,frame.rotation.y,-frame.rotation.y,frame.rotation.x);
+    vec2 position=rotation*inPosition*inInstance.z+inInstance.xy;
+    gl_Position=vec4(position*draw.offsetScale.z+draw.offsetScale.xy,0.0,1.0);
+    vertexColor=inColor;
 }
\ No newline at end of file
@@ -1,11 +1,121 @@
 #include "Device.h"
+#include <stdexcept>
+#include <algorithm>
 
-Device::Device()
+Device::Device(VkDevice device, VkPhysicalDevice physicalDevice, const std::vector<const char*>& enabledExtensions,
+	const VkPhysicalDeviceFeatures* pEnabledFeatures)
+	:m_vkDevice(device), m_vkPhysicalDevice(physicalDevice), m_enabledExtensions(enabledExtensions.begin(), enabledExtensions.end()),
+	m_enabledFeatures(pEnabledFeatures ? *pEnabledFeatures : VkPhysicalDeviceFeatures{})
 {
-	//vkCreateDevice();
+	vkGetPhysicalDeviceProperties(m_vkPhysicalDevice, &m_properties);
+	m_pAllocator = std::make_unique<MemoryAllocator>(m_vkDevice, m_vkPhysicalDevice);
+
+	if (isExtensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+	{
+		m_pfnCmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(m_vkDevice, "vkCmdDrawIndexedIndirectCountKHR");
+	}
+	if (isExtensionEnabled(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+	{
+		m_pfnCmdBeginRendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(m_vkDevice, "vkCmdBeginRenderingKHR");
+		m_pfnCmdEndRendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(m_vkDevice, "vkCmdEndRenderingKHR");
+	}
+	if (isExtensionEnabled(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+	{
+		m_pfnWaitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(m_vkDevice, "vkWaitSemaphoresKHR");
+		m_pfnGetSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(m_vkDevice, "vkGetSemaphoreCounterValueKHR");
+	}
+	if (isExtensionEnabled(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME))
+	{
+		m_pfnQueueSubmit2 = (PFN_vkQueueSubmit2KHR)vkGetDeviceProcAddr(m_vkDevice, "vkQueueSubmit2KHR");
+	}
 }
 
 Device::~Device()
 {
+	m_pAllocator.reset();
+}
+
+bool Device::isExtensionEnabled(const char* pExtensionName)const
+{
+	return std::find(m_enabledExtensions.begin(), m_enabledExtensions.end(), pExtensionName) != m_enabledExtensions.end();
+}
+
+AllocatedBuffer Device::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred)
+{
+	VkBufferCreateInfo bufferCreateInfo{};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.pNext = nullptr;
+	bufferCreateInfo.flags = 0;
+	bufferCreateInfo.size = size;
+	bufferCreateInfo.usage = usage;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	bufferCreateInfo.queueFamilyIndexCount = 0;
+	bufferCreateInfo.pQueueFamilyIndices = nullptr;
+
+	AllocatedBuffer buffer;
+	if (vkCreateBuffer(m_vkDevice, &bufferCreateInfo, nullptr, &buffer.buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create buffer!");
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(m_vkDevice, buffer.buffer, &requirements);
+	buffer.allocation = m_pAllocator->allocate(requirements, required, preferred, ResourceTiling::Linear);
+	vkBindBufferMemory(m_vkDevice, buffer.buffer, buffer.allocation.memory, buffer.allocation.offset);
+	return buffer;
+}
+
+void Device::destroyBuffer(AllocatedBuffer& buffer)
+{
+	vkDestroyBuffer(m_vkDevice, buffer.buffer, nullptr);
+	m_pAllocator->free(buffer.allocation);
+	buffer.buffer = VK_NULL_HANDLE;
+}
+
+AllocatedImage Device::createImage(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, bool dedicated)
+{
+	AllocatedImage image;
+	if (vkCreateImage(m_vkDevice, &createInfo, nullptr, &image.image) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create image!");
+	}
 
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(m_vkDevice, image.image, &requirements);
+	auto tiling = createInfo.tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceTiling::Optimal : ResourceTiling::Linear;
+	image.allocation = m_pAllocator->allocate(requirements, required, preferred, tiling, dedicated);
+	vkBindImageMemory(m_vkDevice, image.image, image.allocation.memory, image.allocation.offset);
+	return image;
 }
+
+void Device::destroyImage(AllocatedImage& image)
+{
+	vkDestroyImage(m_vkDevice, image.image, nullptr);
+	m_pAllocator->free(image.allocation);
+	image.image = VK_NULL_HANDLE;
+}
+
+void Device::flush(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+	auto propertyFlags = m_pAllocator->getMemoryProperties().memoryTypes[allocation.memoryTypeIndex].propertyFlags;
+	if (propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+		return;
+
+	// the range has to cover whole nonCoherentAtomSize units
+	VkDeviceSize atomSize = m_properties.limits.nonCoherentAtomSize;
+	if (size == VK_WHOLE_SIZE)
+	{
+		size = allocation.size - offset;
+	}
+	VkDeviceSize begin = (allocation.offset + offset) / atomSize * atomSize;
+	VkDeviceSize end = (allocation.offset + offset + size + atomSize - 1) / atomSize * atomSize;
+
+	VkMappedMemoryRange range{};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.pNext = nullptr;
+	range.memory = allocation.memory;
+	range.offset = begin;
+	// a dedicated allocation may end inside an atom, buddy ranges never do
+	range.size = allocation.isDedicated() && end > allocation.size ? VK_WHOLE_SIZE : end - begin;
+	vkFlushMappedMemoryRanges(m_vkDevice, 1, &range);
+}
\ No newline at end of file
@@ -1,16 +1,113 @@
 #pragma once
 #include "vulkan/vulkan.h"
+#include "MemoryAllocator.h"
+#include <vector>
+#include <string>
 
+struct AllocatedBuffer final
+{
+	VkBuffer         buffer = VK_NULL_HANDLE;
+	MemoryAllocation allocation;
+};
+
+struct AllocatedImage final
+{
+	VkImage          image = VK_NULL_HANDLE;
+	MemoryAllocation allocation;
+};
+
+// Wraps a logical device created elsewhere and owns the memory allocator
+// every buffer and image should be created through, so resources share a
+// few large vkAllocateMemory blocks instead of one allocation each.
 class Device
 {
 public:
-	Device();
+	// enabledExtensions and pEnabledFeatures are what the device was created with
+	Device(VkDevice device, VkPhysicalDevice physicalDevice, const std::vector<const char*>& enabledExtensions = {},
+		const VkPhysicalDeviceFeatures* pEnabledFeatures = nullptr);
 	~Device();
 
 	operator VkDevice()const {
 		return m_vkDevice;
 	}
 
+	VkPhysicalDevice getPhysicalDevice()const
+	{
+		return m_vkPhysicalDevice;
+	}
+
+	const VkPhysicalDeviceProperties& getProperties()const
+	{
+		return m_properties;
+	}
+
+	bool isExtensionEnabled(const char* pExtensionName)const;
+
+	const VkPhysicalDeviceFeatures& getEnabledFeatures()const
+	{
+		return m_enabledFeatures;
+	}
+
+	// null unless VK_KHR_draw_indirect_count is enabled
+	PFN_vkCmdDrawIndexedIndirectCountKHR getCmdDrawIndexedIndirectCount()const
+	{
+		return m_pfnCmdDrawIndexedIndirectCount;
+	}
+
+	// null unless VK_KHR_dynamic_rendering is enabled
+	PFN_vkCmdBeginRenderingKHR getCmdBeginRendering()const
+	{
+		return m_pfnCmdBeginRendering;
+	}
+
+	PFN_vkCmdEndRenderingKHR getCmdEndRendering()const
+	{
+		return m_pfnCmdEndRendering;
+	}
+
+	// null unless VK_KHR_timeline_semaphore is enabled
+	PFN_vkWaitSemaphoresKHR getWaitSemaphores()const
+	{
+		return m_pfnWaitSemaphores;
+	}
+
+	PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue()const
+	{
+		return m_pfnGetSemaphoreCounterValue;
+	}
+
+	// null unless VK_KHR_synchronization2 is enabled
+	PFN_vkQueueSubmit2KHR getQueueSubmit2()const
+	{
+		return m_pfnQueueSubmit2;
+	}
+
+	MemoryAllocator& getAllocator()
+	{
+		return *m_pAllocator;
+	}
+
+	AllocatedBuffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+	void destroyBuffer(AllocatedBuffer& buffer);
+
+	// dedicated forces a memory allocation of its own, e.g. for large render targets
+	AllocatedImage createImage(const VkImageCreateInfo& createInfo, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0, bool dedicated = false);
+	void destroyImage(AllocatedImage& image);
+
+	// makes host writes to non coherent memory visible to the device
+	void flush(const MemoryAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+
 private:
-	VkDevice m_vkDevice;
+	VkDevice                         m_vkDevice;
+	VkPhysicalDevice                 m_vkPhysicalDevice;
+	VkPhysicalDeviceProperties       m_properties;
+	std::vector<std::string>         m_enabledExtensions;
+	VkPhysicalDeviceFeatures         m_enabledFeatures;
+	PFN_vkCmdDrawIndexedIndirectCountKHR m_pfnCmdDrawIndexedIndirectCount = nullptr;
+	PFN_vkCmdBeginRenderingKHR       m_pfnCmdBeginRendering = nullptr;
+	PFN_vkCmdEndRenderingKHR         m_pfnCmdEndRendering = nullptr;
+	PFN_vkWaitSemaphoresKHR          m_pfnWaitSemaphores = nullptr;
+	PFN_vkGetSemaphoreCounterValueKHR m_pfnGetSemaphoreCounterValue = nullptr;
+	PFN_vkQueueSubmit2KHR            m_pfnQueueSubmit2 = nullptr;
+	std::unique_ptr<MemoryAllocator> m_pAllocator;
 };
\ No newline at end of file
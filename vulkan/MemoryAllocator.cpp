@@ -0,0 +1,327 @@
+#include "MemoryAllocator.h"
+#include <stdexcept>
+#include <algorithm>
+
+static VkDeviceSize floorPowerOfTwo(VkDeviceSize value)
+{
+	VkDeviceSize result = 1;
+	while (result <= value / 2)
+	{
+		result <<= 1;
+	}
+	return result;
+}
+
+MemoryAllocator::MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize preferredBlockSize) :m_vkDevice(device)
+{
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	m_bufferImageGranularity = properties.limits.bufferImageGranularity;
+	m_maxAllocationCnt = properties.limits.maxMemoryAllocationCount;
+
+	// small heaps such as the host visible device local window get smaller blocks
+	for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; ++i)
+	{
+		VkDeviceSize blockSize = std::min(preferredBlockSize, m_memoryProperties.memoryHeaps[i].size / 8);
+		m_blockSizes.push_back(floorPowerOfTwo(std::max(blockSize, MinAllocation)));
+	}
+
+	m_pools.resize(m_memoryProperties.memoryTypeCount * 2);
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+	for (auto& pool : m_pools)
+	{
+		for (auto& pBlock : pool.blocks)
+		{
+			if (pBlock)
+			{
+				destroyBlock(*pBlock);
+			}
+		}
+	}
+}
+
+MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred,
+	ResourceTiling tiling, bool dedicated)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// memory types with the preferred properties first, falling back to any with the required ones
+	MemoryAllocation allocation;
+	for (VkMemoryPropertyFlags flags : { required | preferred, required })
+	{
+		for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i)
+		{
+			if ((requirements.memoryTypeBits & (1u << i)) == 0 || (m_memoryProperties.memoryTypes[i].propertyFlags & flags) != flags)
+				continue;
+
+			if (tryAllocate(i, requirements, tiling, dedicated, allocation))
+				return allocation;
+		}
+	}
+
+	throw std::runtime_error("failed to allocate device memory!");
+}
+
+void MemoryAllocator::free(MemoryAllocation& allocation)
+{
+	if (!allocation)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (allocation.blockIndex == MemoryAllocation::Dedicated)
+	{
+		vkFreeMemory(m_vkDevice, allocation.memory, nullptr);
+		--m_deviceAllocationCnt;
+		--m_dedicatedCnt;
+		m_dedicatedBytes -= allocation.size;
+	}
+	else
+	{
+		auto& pool = m_pools[allocation.poolIndex];
+		auto& block = *pool.blocks[allocation.blockIndex];
+		freeToBlock(block, allocation.offset, allocation.order);
+		block.allocatedBytes -= MinAllocation << allocation.order;
+		block.requestedBytes -= allocation.size;
+		--block.allocationCnt;
+
+		// keep one empty block around so a pool doesn't thrash between allocating and freeing it
+		if (block.allocationCnt == 0)
+		{
+			auto emptyCnt = std::count_if(pool.blocks.begin(), pool.blocks.end(), [](const std::unique_ptr<Block>& pBlock) {
+				return pBlock && pBlock->allocationCnt == 0;
+			});
+			if (emptyCnt > 1)
+			{
+				destroyBlock(block);
+				pool.blocks[allocation.blockIndex].reset();
+			}
+		}
+	}
+	allocation = MemoryAllocation();
+}
+
+bool MemoryAllocator::tryAllocate(uint32_t memoryTypeIndex, const VkMemoryRequirements& requirements, ResourceTiling tiling, bool dedicated, MemoryAllocation& allocation)
+{
+	VkDeviceSize blockSize = m_blockSizes[m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+	VkDeviceSize rangeSize = std::max(requirements.size, requirements.alignment);
+	if (dedicated || rangeSize > blockSize / 2)
+		return allocateDedicated(memoryTypeIndex, requirements.size, allocation);
+
+	// without a granularity conflict linear and optimal resources can share blocks
+	if (m_bufferImageGranularity <= MinAllocation)
+	{
+		tiling = ResourceTiling::Linear;
+	}
+	uint32_t poolIndex = memoryTypeIndex * 2 + (uint32_t)tiling;
+	auto& pool = m_pools[poolIndex];
+	uint32_t order = getOrder(rangeSize);
+
+	VkDeviceSize offset = 0;
+	uint32_t blockIndex = 0;
+	for (; blockIndex < pool.blocks.size(); ++blockIndex)
+	{
+		if (pool.blocks[blockIndex] && allocateFromBlock(*pool.blocks[blockIndex], order, offset))
+			break;
+	}
+
+	if (blockIndex == pool.blocks.size())
+	{
+		auto pBlock = createBlock(memoryTypeIndex, blockSize);
+		if (!pBlock)
+			return false;
+
+		// reuse the slot of a freed block
+		auto it = std::find(pool.blocks.begin(), pool.blocks.end(), nullptr);
+		blockIndex = (uint32_t)(it - pool.blocks.begin());
+		if (it == pool.blocks.end())
+		{
+			pool.blocks.push_back(std::move(pBlock));
+		}
+		else
+		{
+			*it = std::move(pBlock);
+		}
+		allocateFromBlock(*pool.blocks[blockIndex], order, offset);
+	}
+
+	auto& block = *pool.blocks[blockIndex];
+	block.allocatedBytes += MinAllocation << order;
+	block.requestedBytes += requirements.size;
+	++block.allocationCnt;
+
+	allocation.memory = block.memory;
+	allocation.offset = offset;
+	allocation.size = requirements.size;
+	allocation.pMapped = block.pMapped ? block.pMapped + offset : nullptr;
+	allocation.memoryTypeIndex = memoryTypeIndex;
+	allocation.poolIndex = poolIndex;
+	allocation.blockIndex = blockIndex;
+	allocation.order = order;
+	return true;
+}
+
+bool MemoryAllocator::allocateDedicated(uint32_t memoryTypeIndex, VkDeviceSize size, MemoryAllocation& allocation)
+{
+	uint8_t* pMapped = nullptr;
+	VkDeviceMemory memory = allocateMemory(memoryTypeIndex, size, &pMapped);
+	if (memory == VK_NULL_HANDLE)
+		return false;
+
+	++m_dedicatedCnt;
+	m_dedicatedBytes += size;
+
+	allocation.memory = memory;
+	allocation.offset = 0;
+	allocation.size = size;
+	allocation.pMapped = pMapped;
+	allocation.memoryTypeIndex = memoryTypeIndex;
+	allocation.blockIndex = MemoryAllocation::Dedicated;
+	return true;
+}
+
+bool MemoryAllocator::allocateFromBlock(Block& block, uint32_t order, VkDeviceSize& offset)
+{
+	if (order > block.maxOrder)
+		return false;
+
+	uint32_t freeOrder = order;
+	while (freeOrder <= block.maxOrder && block.freeLists[freeOrder].empty())
+	{
+		++freeOrder;
+	}
+	if (freeOrder > block.maxOrder)
+		return false;
+
+	auto it = block.freeLists[freeOrder].begin();
+	offset = *it;
+	block.freeLists[freeOrder].erase(it);
+
+	// split down to the requested size, keeping the upper halves free
+	while (freeOrder > order)
+	{
+		--freeOrder;
+		block.freeLists[freeOrder].insert(offset + (MinAllocation << freeOrder));
+	}
+	return true;
+}
+
+void MemoryAllocator::freeToBlock(Block& block, VkDeviceSize offset, uint32_t order)
+{
+	// merge with the buddy for as long as it is free as well
+	while (order < block.maxOrder)
+	{
+		VkDeviceSize buddy = offset ^ (MinAllocation << order);
+		auto it = block.freeLists[order].find(buddy);
+		if (it == block.freeLists[order].end())
+			break;
+
+		block.freeLists[order].erase(it);
+		offset = std::min(offset, buddy);
+		++order;
+	}
+	block.freeLists[order].insert(offset);
+}
+
+std::unique_ptr<MemoryAllocator::Block> MemoryAllocator::createBlock(uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+	auto pBlock = std::make_unique<Block>();
+	pBlock->memory = allocateMemory(memoryTypeIndex, size, &pBlock->pMapped);
+	if (pBlock->memory == VK_NULL_HANDLE)
+		return nullptr;
+
+	pBlock->size = size;
+	pBlock->maxOrder = getOrder(size);
+	pBlock->freeLists.resize(pBlock->maxOrder + 1);
+	pBlock->freeLists[pBlock->maxOrder].insert(0);
+	return pBlock;
+}
+
+void MemoryAllocator::destroyBlock(Block& block)
+{
+	vkFreeMemory(m_vkDevice, block.memory, nullptr);
+	block.memory = VK_NULL_HANDLE;
+	--m_deviceAllocationCnt;
+}
+
+VkDeviceMemory MemoryAllocator::allocateMemory(uint32_t memoryTypeIndex, VkDeviceSize size, uint8_t** ppMapped)
+{
+	if (m_deviceAllocationCnt >= m_maxAllocationCnt)
+	{
+		throw std::runtime_error("failed to allocate device memory, maxMemoryAllocationCount reached!");
+	}
+
+	VkMemoryAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.pNext = nullptr;
+	allocateInfo.allocationSize = size;
+	allocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	// running out of one heap is not fatal, the caller falls back to the next memory type
+	if (vkAllocateMemory(m_vkDevice, &allocateInfo, nullptr, &memory) != VK_SUCCESS)
+		return VK_NULL_HANDLE;
+	++m_deviceAllocationCnt;
+
+	*ppMapped = nullptr;
+	if (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		void* pData = nullptr;
+		if (vkMapMemory(m_vkDevice, memory, 0, VK_WHOLE_SIZE, 0, &pData) != VK_SUCCESS)
+		{
+			vkFreeMemory(m_vkDevice, memory, nullptr);
+			--m_deviceAllocationCnt;
+			throw std::runtime_error("failed to map device memory!");
+		}
+		*ppMapped = static_cast<uint8_t*>(pData);
+	}
+	return memory;
+}
+
+uint32_t MemoryAllocator::getOrder(VkDeviceSize size)
+{
+	uint32_t order = 0;
+	while ((MinAllocation << order) < size)
+	{
+		++order;
+	}
+	return order;
+}
+
+MemoryAllocator::Stats MemoryAllocator::getStats()const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	Stats stats;
+	stats.dedicatedCnt = m_dedicatedCnt;
+	stats.dedicatedBytes = m_dedicatedBytes;
+	stats.allocationCnt = m_dedicatedCnt;
+	for (auto& pool : m_pools)
+	{
+		for (auto& pBlock : pool.blocks)
+		{
+			if (!pBlock)
+				continue;
+
+			++stats.blockCnt;
+			stats.blockBytes += pBlock->size;
+			stats.allocationCnt += pBlock->allocationCnt;
+			stats.allocatedBytes += pBlock->allocatedBytes;
+			stats.requestedBytes += pBlock->requestedBytes;
+			for (uint32_t order = pBlock->maxOrder + 1; order-- > 0;)
+			{
+				if (!pBlock->freeLists[order].empty())
+				{
+					stats.largestFreeRange = std::max(stats.largestFreeRange, MinAllocation << order);
+					break;
+				}
+			}
+		}
+	}
+	stats.requestedBytes += m_dedicatedBytes;
+	return stats;
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#pragma once
+#include "vulkan/vulkan.h"
+#include <vector>
+#include <set>
+#include <memory>
+#include <mutex>
+
+// Optimal tiling images and linear resources (buffers, linear images) closer
+// than bufferImageGranularity alias each other, so they live in separate blocks.
+enum class ResourceTiling : uint32_t
+{
+	Linear,
+	Optimal,
+};
+
+struct MemoryAllocation final
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize   offset = 0;
+	VkDeviceSize   size = 0;
+	// points at offset when the memory is host visible, null otherwise
+	void*          pMapped = nullptr;
+	uint32_t       memoryTypeIndex = 0;
+
+	explicit operator bool()const
+	{
+		return memory != VK_NULL_HANDLE;
+	}
+
+	bool isDedicated()const
+	{
+		return blockIndex == Dedicated;
+	}
+
+private:
+	friend class MemoryAllocator;
+	static constexpr uint32_t Dedicated = UINT32_MAX;
+
+	uint32_t       poolIndex = 0;
+	uint32_t       blockIndex = Dedicated;
+	uint32_t       order = 0;
+};
+
+// Sub-allocates device memory out of large blocks, one set of blocks per
+// memory type and tiling, with a buddy allocator per block. Buddy ranges are
+// aligned to their own size, which covers any alignment not larger than the
+// allocation itself. Requests of more than half a block get a dedicated
+// vkAllocateMemory. Host visible blocks stay mapped for their whole lifetime.
+class MemoryAllocator
+{
+public:
+	struct Stats final
+	{
+		uint32_t     blockCnt = 0;
+		uint32_t     dedicatedCnt = 0;
+		uint32_t     allocationCnt = 0;
+		VkDeviceSize blockBytes = 0;
+		VkDeviceSize dedicatedBytes = 0;
+		// bytes the callers asked for
+		VkDeviceSize requestedBytes = 0;
+		// bytes taken out of the blocks, requests rounded up to buddy sizes
+		VkDeviceSize allocatedBytes = 0;
+		VkDeviceSize largestFreeRange = 0;
+
+		// share of the block memory handed out to allocations
+		double getUtilization()const
+		{
+			return blockBytes == 0 ? 0.0 : (double)allocatedBytes / blockBytes;
+		}
+
+		// 0 when all free block memory is one contiguous range, towards 1 when it is scattered
+		double getFragmentation()const
+		{
+			VkDeviceSize freeBytes = blockBytes - allocatedBytes;
+			return freeBytes == 0 ? 0.0 : 1.0 - (double)largestFreeRange / freeBytes;
+		}
+	};
+
+	MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize preferredBlockSize = 64ull * 1024 * 1024);
+	~MemoryAllocator();
+
+	// picks a memory type with all of required and as many of preferred as possible
+	MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred,
+		ResourceTiling tiling, bool dedicated = false);
+	void free(MemoryAllocation& allocation);
+
+	Stats getStats()const;
+
+	const VkPhysicalDeviceMemoryProperties& getMemoryProperties()const
+	{
+		return m_memoryProperties;
+	}
+
+private:
+	static constexpr VkDeviceSize MinAllocation = 256;
+
+	struct Block
+	{
+		VkDeviceMemory                      memory = VK_NULL_HANDLE;
+		VkDeviceSize                        size = 0;
+		uint32_t                            maxOrder = 0;
+		uint8_t*                            pMapped = nullptr;
+		// free range offsets per order, order n ranges are MinAllocation << n bytes
+		std::vector<std::set<VkDeviceSize>> freeLists;
+		VkDeviceSize                        allocatedBytes = 0;
+		VkDeviceSize                        requestedBytes = 0;
+		uint32_t                            allocationCnt = 0;
+	};
+
+	struct Pool
+	{
+		// freed blocks leave a null slot so the indices held by allocations stay valid
+		std::vector<std::unique_ptr<Block>> blocks;
+	};
+
+	bool tryAllocate(uint32_t memoryTypeIndex, const VkMemoryRequirements& requirements, ResourceTiling tiling, bool dedicated, MemoryAllocation& allocation);
+	bool allocateDedicated(uint32_t memoryTypeIndex, VkDeviceSize size, MemoryAllocation& allocation);
+	bool allocateFromBlock(Block& block, uint32_t order, VkDeviceSize& offset);
+	void freeToBlock(Block& block, VkDeviceSize offset, uint32_t order);
+	std::unique_ptr<Block> createBlock(uint32_t memoryTypeIndex, VkDeviceSize size);
+	void destroyBlock(Block& block);
+	VkDeviceMemory allocateMemory(uint32_t memoryTypeIndex, VkDeviceSize size, uint8_t** ppMapped);
+
+	static uint32_t getOrder(VkDeviceSize size);
+
+private:
+	VkDevice                         m_vkDevice;
+	VkPhysicalDeviceMemoryProperties m_memoryProperties;
+	VkDeviceSize                     m_bufferImageGranularity;
+	uint32_t                         m_maxAllocationCnt;
+	// per memory heap, rounded down to a power of two
+	std::vector<VkDeviceSize>        m_blockSizes;
+
+	mutable std::mutex               m_mutex;
+	// indexed by memoryTypeIndex * 2 + tiling
+	std::vector<Pool>                m_pools;
+	uint32_t                         m_deviceAllocationCnt = 0;
+	uint32_t                         m_dedicatedCnt = 0;
+	VkDeviceSize                     m_dedicatedBytes = 0;
+};
\ No newline at end of file